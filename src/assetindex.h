@@ -0,0 +1,232 @@
+// Copyright (c) 2019 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_ASSETINDEX_H
+#define BITCOIN_ASSETINDEX_H
+
+#include "uint256.h"
+#include "amount.h"
+#include "primitives/transaction.h"
+
+#include <vector>
+
+/**
+ * Everything the asset index knows about one unspent output of an assets CC transaction. An output
+ * holding token units is a balance of its CC address, and an output on the assets contract address
+ * is an open order. A sell order is both.
+ */
+struct CAssetOutputValue {
+    enum {
+        IS_BALANCE = 1,
+        IS_ORDER = 2
+    };
+
+    uint8_t flags;
+    uint8_t funcid;                     // asset opret function of the transaction
+    uint256 tokenid;
+    uint256 otherid;                    // second token of a swap
+    uint160 hashBytes;                  // index hash of the output's CC address
+    int64_t price;                      // total price in the asset opret
+    CAmount satoshis;                   // value of this output
+    CAmount orderSatoshis;              // value of output 0 of the order transaction
+    std::vector<uint8_t> origpubkey;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(flags);
+        READWRITE(funcid);
+        READWRITE(tokenid);
+        READWRITE(otherid);
+        READWRITE(hashBytes);
+        READWRITE(price);
+        READWRITE(satoshis);
+        READWRITE(orderSatoshis);
+        READWRITE(origpubkey);
+    }
+
+    CAssetOutputValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        flags = 0;
+        funcid = 0;
+        tokenid.SetNull();
+        otherid.SetNull();
+        hashBytes.SetNull();
+        price = 0;
+        satoshis = 0;
+        orderSatoshis = 0;
+        origpubkey.clear();
+    }
+
+    bool IsNull() const {
+        return flags == 0;
+    }
+
+    bool IsBalance() const { return flags & IS_BALANCE; }
+    bool IsOrder() const { return flags & IS_ORDER; }
+
+    // bids, asks and swaps, with fills sorted together with the orders they fill
+    uint8_t OrderSide() const {
+        return (funcid >= 'A' && funcid <= 'Z') ? funcid - 'A' + 'a' : funcid;
+    }
+};
+
+typedef std::pair<COutPoint, CAssetOutputValue> CAssetIndexDbEntry;
+typedef std::pair<COutPoint, CAmount> CAssetBalanceDbEntry;
+
+/** Balance entries are sorted by token, then holder address */
+struct CAssetBalanceKey {
+    uint256 tokenid;
+    uint160 hashBytes;
+    uint256 txhash;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 88;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        tokenid.Serialize(s);
+        hashBytes.Serialize(s);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        tokenid.Unserialize(s);
+        hashBytes.Unserialize(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+
+    CAssetBalanceKey(const uint256 &token, const uint160 &addressHash, const COutPoint &output) {
+        tokenid = token;
+        hashBytes = addressHash;
+        txhash = output.hash;
+        index = output.n;
+    }
+
+    CAssetBalanceKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        tokenid.SetNull();
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+    }
+};
+
+struct CAssetBalanceIteratorKey {
+    uint256 tokenid;
+    uint160 hashBytes;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 52;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        tokenid.Serialize(s);
+        hashBytes.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        tokenid.Unserialize(s);
+        hashBytes.Unserialize(s);
+    }
+
+    CAssetBalanceIteratorKey(const uint256 &token, const uint160 &addressHash) {
+        tokenid = token;
+        hashBytes = addressHash;
+    }
+
+    CAssetBalanceIteratorKey() {
+        tokenid.SetNull();
+        hashBytes.SetNull();
+    }
+};
+
+/** Order entries are sorted by token, then side, then ascending price */
+struct CAssetOrderKey {
+    uint256 tokenid;
+    uint8_t side;
+    int64_t price;
+    uint256 txhash;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 77;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        tokenid.Serialize(s);
+        ser_writedata8(s, side);
+        // Prices are stored big-endian for key sorting in LevelDB
+        ser_writedata64be(s, price);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        tokenid.Unserialize(s);
+        side = ser_readdata8(s);
+        price = ser_readdata64be(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+
+    CAssetOrderKey(const COutPoint &output, const CAssetOutputValue &value) {
+        tokenid = value.tokenid;
+        side = value.OrderSide();
+        price = value.price;
+        txhash = output.hash;
+        index = output.n;
+    }
+
+    CAssetOrderKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        tokenid.SetNull();
+        side = 0;
+        price = 0;
+        txhash.SetNull();
+        index = 0;
+    }
+};
+
+struct CAssetOrderIteratorKey {
+    uint256 tokenid;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        tokenid.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        tokenid.Unserialize(s);
+    }
+
+    CAssetOrderIteratorKey(const uint256 &token) {
+        tokenid = token;
+    }
+
+    CAssetOrderIteratorKey() {
+        tokenid.SetNull();
+    }
+};
+
+/** Get the asset index entries for the outputs of an assets CC transaction, implemented in cc/CCassetsCore.cpp */
+void GetAssetIndexOutputs(const CTransaction &tx, std::vector<CAssetIndexDbEntry> &outputs);
+
+#endif // BITCOIN_ASSETINDEX_H
@@ -482,3 +482,48 @@ bool AssetExactAmounts(struct CCcontract_info *cp,int64_t &inputs,int32_t starti
     }
     else return(true);
 }
+
+bool GetAssetIndexHash(uint160 &hashBytes,const char *coinaddr)
+{
+    int32_t type = 0;
+    return(CBitcoinAddress(std::string(coinaddr)).GetIndexKey(hashBytes,type));
+}
+
+void GetAssetIndexOutputs(const CTransaction &tx,std::vector<CAssetIndexDbEntry> &outputs)
+{
+    uint256 assetid,assetid2,tokenid; int64_t price,tmpprice; std::vector<uint8_t> origpubkey,tmporigpubkey; uint8_t funcid; int32_t v,numvouts; char destaddr[64]; struct CCcontract_info *cp,C;
+    numvouts = tx.vout.size();
+    if ( numvouts < 2 || tx.vout[numvouts-1].scriptPubKey.IsPayToCryptoCondition() != 0 )
+        return;
+    if ( (funcid= DecodeAssetOpRet(tx.vout[numvouts-1].scriptPubKey,assetid,assetid2,price,origpubkey)) == 0 )
+        return;
+    cp = CCinit(&C,EVAL_ASSETS);
+    for (v=0; v<numvouts-1; v++)
+    {
+        if ( tx.vout[v].scriptPubKey.IsPayToCryptoCondition() == 0 || Getscriptaddress(destaddr,tx.vout[v].scriptPubKey) == 0 )
+            continue;
+        // the same token choice IsAssetvout makes for each output
+        if ( funcid == 'c' )
+            tokenid = tx.GetHash();
+        else if ( funcid == 'E' && v == 2 )
+            tokenid = assetid2;
+        else tokenid = assetid;
+        CAssetOutputValue value;
+        if ( IsAssetvout(tmpprice,tmporigpubkey,tx,v,tokenid) > 0 )
+            value.flags |= CAssetOutputValue::IS_BALANCE;
+        else tokenid = assetid;
+        // every funded output on the contract address is an open order, as AssetOrders lists them
+        if ( strcmp(destaddr,cp->unspendableCCaddr) == 0 && tx.vout[v].nValue != 0 )
+            value.flags |= CAssetOutputValue::IS_ORDER;
+        if ( value.IsNull() || GetAssetIndexHash(value.hashBytes,destaddr) == 0 )
+            continue;
+        value.funcid = funcid;
+        value.tokenid = tokenid;
+        value.otherid = assetid2;
+        value.price = price;
+        value.satoshis = tx.vout[v].nValue;
+        value.orderSatoshis = tx.vout[0].nValue;
+        value.origpubkey = origpubkey;
+        outputs.push_back(std::make_pair(COutPoint(tx.GetHash(),v),value));
+    }
+}
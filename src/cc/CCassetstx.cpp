@@ -20,6 +20,30 @@ int64_t AddAssetInputs(struct CCcontract_info *cp,CMutableTransaction &mtx,CPubK
     char coinaddr[64],destaddr[64]; int64_t nValue,price,totalinputs = 0; uint256 txid,hashBlock; std::vector<uint8_t> origpubkey; CTransaction vintx; int32_t j,vout,n = 0;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
     GetCCaddress(cp,coinaddr,pk);
+    if ( fAssetIndex != 0 )
+    {
+        // the index only holds outputs of this token, so no transactions need to be loaded
+        std::vector<CAssetBalanceDbEntry> assetOutputs; uint160 hashBytes;
+        if ( GetAssetIndexHash(hashBytes,coinaddr) == 0 || GetAssetBalanceOutputs(assetid,hashBytes,assetOutputs) == 0 )
+            return(0);
+        for (std::vector<CAssetBalanceDbEntry>::const_iterator it=assetOutputs.begin(); it!=assetOutputs.end(); it++)
+        {
+            txid = it->first.hash;
+            vout = (int32_t)it->first.n;
+            for (j=0; j<mtx.vin.size(); j++)
+                if ( txid == mtx.vin[j].prevout.hash && vout == mtx.vin[j].prevout.n )
+                    break;
+            if ( j != mtx.vin.size() || myIsutxo_spentinmempool(txid,vout) != 0 )
+                continue;
+            if ( total != 0 && maxinputs != 0 )
+                mtx.vin.push_back(CTxIn(txid,vout,CScript()));
+            totalinputs += it->second;
+            n++;
+            if ( (total > 0 && totalinputs >= total) || (maxinputs > 0 && n >= maxinputs) )
+                break;
+        }
+        return(totalinputs);
+    }
     SetCCunspents(unspentOutputs,coinaddr);
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
@@ -103,11 +127,75 @@ UniValue AssetList()
     return(result);
 }
 
+static UniValue AssetOrderItem(struct CCcontract_info *cp,uint8_t funcid,uint256 txid,int32_t vout,int64_t nValue,int64_t orderValue,uint256 assetid,uint256 assetid2,int64_t price,const std::vector<uint8_t> &origpubkey)
+{
+    UniValue item(UniValue::VOBJ); char numstr[32],funcidstr[16],origaddr[64],assetidstr[65];
+    funcidstr[0] = funcid;
+    funcidstr[1] = 0;
+    item.push_back(Pair("funcid", funcidstr));
+    item.push_back(Pair("txid", uint256_str(assetidstr,txid)));
+    item.push_back(Pair("vout", (int64_t)vout));
+    if ( funcid == 'b' || funcid == 'B' )
+    {
+        sprintf(numstr,"%.8f",(double)nValue/COIN);
+        item.push_back(Pair("amount",numstr));
+        sprintf(numstr,"%.8f",(double)orderValue/COIN);
+        item.push_back(Pair("bidamount",numstr));
+    }
+    else
+    {
+        sprintf(numstr,"%llu",(long long)nValue);
+        item.push_back(Pair("amount",numstr));
+        sprintf(numstr,"%llu",(long long)orderValue);
+        item.push_back(Pair("askamount",numstr));
+    }
+    if ( origpubkey.size() == 33 )
+    {
+        GetCCaddress(cp,origaddr,pubkey2pk(origpubkey));
+        item.push_back(Pair("origaddress",origaddr));
+    }
+    if ( assetid != zeroid )
+        item.push_back(Pair("tokenid",uint256_str(assetidstr,assetid)));
+    if ( assetid2 != zeroid )
+        item.push_back(Pair("otherid",uint256_str(assetidstr,assetid2)));
+    if ( price > 0 )
+    {
+        if ( funcid == 's' || funcid == 'S' || funcid == 'e' || funcid == 'e' )
+        {
+            sprintf(numstr,"%.8f",(double)price / COIN);
+            item.push_back(Pair("totalrequired", numstr));
+            sprintf(numstr,"%.8f",(double)price / (COIN * orderValue));
+            item.push_back(Pair("price", numstr));
+        }
+        else
+        {
+            item.push_back(Pair("totalrequired", (int64_t)price));
+            sprintf(numstr,"%.8f",(double)orderValue / (price * COIN));
+            item.push_back(Pair("price",numstr));
+        }
+    }
+    return(item);
+}
+
 UniValue AssetOrders(uint256 refassetid)
 {
     static uint256 zero;
-    int64_t price; uint256 txid,hashBlock,assetid,assetid2; std::vector<uint8_t> origpubkey; CTransaction vintx; UniValue result(UniValue::VARR);  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; uint8_t funcid; char numstr[32],funcidstr[16],origaddr[64],assetidstr[65]; struct CCcontract_info *cp,C;
+    int64_t price; uint256 txid,hashBlock,assetid,assetid2; std::vector<uint8_t> origpubkey; CTransaction vintx; UniValue result(UniValue::VARR);  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs; uint8_t funcid; struct CCcontract_info *cp,C;
     cp = CCinit(&C,EVAL_ASSETS);
+    if ( fAssetIndex != 0 )
+    {
+        // orders come back sorted by token, side and price
+        std::vector<CAssetIndexDbEntry> orders;
+        if ( GetAssetOrders(refassetid,orders) != 0 )
+        {
+            for (std::vector<CAssetIndexDbEntry>::iterator it=orders.begin(); it!=orders.end(); it++)
+            {
+                const CAssetOutputValue &order = it->second;
+                result.push_back(AssetOrderItem(cp,order.funcid,it->first.hash,(int32_t)it->first.n,order.satoshis,order.orderSatoshis,order.tokenid,order.otherid,order.price,order.origpubkey));
+            }
+        }
+        return(result);
+    }
     SetCCunspents(unspentOutputs,(char *)cp->unspendableCCaddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
@@ -129,52 +217,7 @@ UniValue AssetOrders(uint256 refassetid)
                 }
                 if ( vintx.vout[it->first.index].nValue == 0 )
                     continue;
-                UniValue item(UniValue::VOBJ);
-                funcidstr[0] = funcid;
-                funcidstr[1] = 0;
-                item.push_back(Pair("funcid", funcidstr));
-                item.push_back(Pair("txid", uint256_str(assetidstr,txid)));
-                item.push_back(Pair("vout", (int64_t)it->first.index));
-                if ( funcid == 'b' || funcid == 'B' )
-                {
-                    sprintf(numstr,"%.8f",(double)vintx.vout[it->first.index].nValue/COIN);
-                    item.push_back(Pair("amount",numstr));
-                    sprintf(numstr,"%.8f",(double)vintx.vout[0].nValue/COIN);
-                    item.push_back(Pair("bidamount",numstr));
-                }
-                else
-                {
-                    sprintf(numstr,"%llu",(long long)vintx.vout[it->first.index].nValue);
-                    item.push_back(Pair("amount",numstr));
-                    sprintf(numstr,"%llu",(long long)vintx.vout[0].nValue);
-                    item.push_back(Pair("askamount",numstr));
-                }
-                if ( origpubkey.size() == 33 )
-                {
-                    GetCCaddress(cp,origaddr,pubkey2pk(origpubkey));
-                    item.push_back(Pair("origaddress",origaddr));
-                }
-                if ( assetid != zeroid )
-                    item.push_back(Pair("tokenid",uint256_str(assetidstr,assetid)));
-                if ( assetid2 != zeroid )
-                    item.push_back(Pair("otherid",uint256_str(assetidstr,assetid2)));
-                if ( price > 0 )
-                {
-                    if ( funcid == 's' || funcid == 'S' || funcid == 'e' || funcid == 'e' )
-                    {
-                        sprintf(numstr,"%.8f",(double)price / COIN);
-                        item.push_back(Pair("totalrequired", numstr));
-                        sprintf(numstr,"%.8f",(double)price / (COIN * vintx.vout[0].nValue));
-                        item.push_back(Pair("price", numstr));
-                    }
-                    else
-                    {
-                        item.push_back(Pair("totalrequired", (int64_t)price));
-                        sprintf(numstr,"%.8f",(double)vintx.vout[0].nValue / (price * COIN));
-                        item.push_back(Pair("price",numstr));
-                    }
-                }
-                result.push_back(item);
+                result.push_back(AssetOrderItem(cp,funcid,txid,(int32_t)it->first.index,vintx.vout[it->first.index].nValue,vintx.vout[0].nValue,assetid,assetid2,price,origpubkey));
                 //fprintf(stderr,"func.(%c) %s/v%d %.8f\n",funcid,uint256_str(assetidstr,txid),(int32_t)it->first.index,(double)vintx.vout[it->first.index].nValue/COIN);
             }
         }
@@ -256,6 +256,16 @@ int64_t CCfullsupply(uint256 tokenid)
 int64_t CCtoken_balance(char *coinaddr,uint256 tokenid)
 {
     int64_t price,sum = 0; int32_t numvouts; CTransaction tx; uint256 assetid,assetid2,txid,hashBlock; std::vector<uint8_t> origpubkey; std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    if ( fAssetIndex != 0 )
+    {
+        std::vector<CAssetBalanceDbEntry> assetOutputs; uint160 hashBytes;
+        if ( GetAssetIndexHash(hashBytes,coinaddr) != 0 && GetAssetBalanceOutputs(tokenid,hashBytes,assetOutputs) != 0 )
+        {
+            for (std::vector<CAssetBalanceDbEntry>::const_iterator it=assetOutputs.begin(); it!=assetOutputs.end(); it++)
+                sum += it->second;
+        }
+        return(sum);
+    }
     SetCCunspents(unspentOutputs,coinaddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
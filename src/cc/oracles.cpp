@@ -250,7 +250,7 @@ static uint256 myIs_baton_spentinmempool(uint256 batontxid,int32_t batonvout)
     return(batontxid);
 }
 
-uint256 OracleBatonUtxo(uint64_t txfee,struct CCcontract_info *cp,uint256 reforacletxid,char *batonaddr,CPubKey publisher,std::vector <uint8_t> &dataarg)
+uint256 OracleBatonUtxo(uint64_t txfee,struct CCcontract_info *cp,uint256 reforacletxid,char *batonaddr,CPubKey publisher,std::vector <uint8_t> &dataarg,int32_t *batonheightp=0)
 {
     uint256 txid,oracletxid,hashBlock,btxid,batontxid = zeroid; int64_t dfee; int32_t dheight=0,vout,height,numvouts; CTransaction tx; CPubKey pk; uint8_t *ptr; std::vector<uint8_t> vopret,data;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
@@ -290,6 +290,8 @@ uint256 OracleBatonUtxo(uint64_t txfee,struct CCcontract_info *cp,uint256 refora
     }
     while ( myIsutxo_spentinmempool(batontxid,1) != 0 )
         batontxid = myIs_baton_spentinmempool(batontxid,1);
+    if ( batonheightp != 0 )
+        *batonheightp = dheight;
     return(batontxid);
 }
 
@@ -450,7 +452,7 @@ int64_t OracleCorrelatedPrice(int32_t height,std::vector <int64_t> origprices)
     std::sort(origprices.begin(), origprices.end());
     prices = (int64_t *)calloc(n,sizeof(*prices));
     i = 0;
-    for (std::vector<int64_t>::const_iterator it=sorted.begin(); it!=sorted.end(); it++)
+    for (std::vector<int64_t>::const_iterator it=origprices.begin(); it!=origprices.end(); it++)
         prices[i++] = *it;
     price = correlate_price(height,prices,i);
     free(prices);
@@ -483,12 +485,108 @@ int32_t oracleprice_add(std::vector<struct oracleprice_info> &publishers,CPubKey
     } else return(0);
 }
 
+/*
+ With -oracleindex, every data sample is indexed by oracletxid, publisher and height as its block connects. The latest sample of each publisher is cached per oracle, so a price read is a pass over the publishers, without fetching the registrations or walking the baton chains. A disconnected block drops the cache of the oracles it touched, which is reloaded from the index on the next read.
+ */
+
+struct oracleprice_cache
+{
+    std::map<uint160,std::pair<COracleSampleKey,int64_t> > latest;
+    int32_t maxheight;
+    int32_t correlatedheight; // height of the cached correlated price, -1 if none
+    int64_t correlatedprice;
+    oracleprice_cache() : maxheight(0),correlatedheight(-1),correlatedprice(0) {}
+};
+
+static CCriticalSection cs_oracleprices;
+static std::map<uint256,struct oracleprice_cache> OraclePriceCache;
+
+void GetOracleIndexSamples(const CTransaction &tx,int height,unsigned int txindex,std::vector<COracleSampleDbEntry> &samples)
+{
+    uint256 oracletxid,batontxid; CPubKey pk; std::vector<uint8_t> data; int32_t i,numvouts; struct CCcontract_info *cp,C;
+    if ( (numvouts= tx.vout.size()) < 3 || tx.vin.size() < 2 )
+        return;
+    if ( DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,oracletxid,batontxid,pk,data) != 'D' )
+        return;
+    // only a data tx that spends oracles CC inputs has been through OraclesDataValidate
+    cp = CCinit(&C,EVAL_ORACLES);
+    for (i=1; i<tx.vin.size(); i++)
+        if ( (*cp->ismyvin)(tx.vin[i].scriptSig) != 0 )
+            break;
+    if ( i == tx.vin.size() )
+        return;
+    samples.push_back(std::make_pair(COracleSampleKey(oracletxid,pk,height,txindex,tx.GetHash()),COracleSampleValue(pk,data)));
+}
+
+static void oracleprice_cacheadd(struct oracleprice_cache &cache,const COracleSampleDbEntry &sample)
+{
+    uint256 hash; int64_t price = 0;
+    std::map<uint160,std::pair<COracleSampleKey,int64_t> >::iterator it = cache.latest.find(sample.first.publisher);
+    if ( it != cache.latest.end() && sample.first.IsNewerThan(it->second.first) == 0 )
+        return;
+    oracle_format(&hash,&price,0,'L',(uint8_t *)sample.second.data.data(),0,(int32_t)sample.second.data.size());
+    cache.latest[sample.first.publisher] = std::make_pair(sample.first,price);
+    if ( sample.first.blockHeight > cache.maxheight )
+        cache.maxheight = sample.first.blockHeight;
+    cache.correlatedheight = -1;
+}
+
+void OracleIndexBlockConnected(const std::vector<COracleSampleDbEntry> &samples)
+{
+    LOCK(cs_oracleprices);
+    for (std::vector<COracleSampleDbEntry>::const_iterator it=samples.begin(); it!=samples.end(); it++)
+    {
+        std::map<uint256,struct oracleprice_cache>::iterator cit = OraclePriceCache.find(it->first.oracletxid);
+        if ( cit != OraclePriceCache.end() )
+            oracleprice_cacheadd(cit->second,*it);
+    }
+}
+
+void OracleIndexBlockDisconnected(const std::vector<COracleSampleDbEntry> &samples)
+{
+    LOCK(cs_oracleprices);
+    for (std::vector<COracleSampleDbEntry>::const_iterator it=samples.begin(); it!=samples.end(); it++)
+        OraclePriceCache.erase(it->first.oracletxid);
+}
+
+static int64_t OracleIndexedPrice(int32_t height,uint256 reforacletxid)
+{
+    std::vector <int64_t> prices;
+    LOCK(cs_oracleprices);
+    std::map<uint256,struct oracleprice_cache>::iterator it = OraclePriceCache.find(reforacletxid);
+    if ( it == OraclePriceCache.end() )
+    {
+        std::vector<COracleSampleDbEntry> samples; struct oracleprice_cache cache;
+        if ( GetOracleSamples(reforacletxid,samples) == 0 )
+            return(0);
+        for (std::vector<COracleSampleDbEntry>::const_iterator sit=samples.begin(); sit!=samples.end(); sit++)
+            oracleprice_cacheadd(cache,*sit);
+        it = OraclePriceCache.insert(std::make_pair(reforacletxid,cache)).first;
+    }
+    struct oracleprice_cache &cache = it->second;
+    if ( cache.maxheight <= 10 )
+        return(0);
+    if ( cache.correlatedheight != height )
+    {
+        for (std::map<uint160,std::pair<COracleSampleKey,int64_t> >::const_iterator pit=cache.latest.begin(); pit!=cache.latest.end(); pit++)
+        {
+            if ( pit->second.first.blockHeight >= cache.maxheight-10 && pit->second.second != 0 )
+                prices.push_back(pit->second.second);
+        }
+        cache.correlatedprice = prices.size() > 0 ? OracleCorrelatedPrice(height,prices) : 0;
+        cache.correlatedheight = height;
+    }
+    return(cache.correlatedprice);
+}
+
 int64_t OraclePrice(int32_t height,uint256 reforacletxid,char *markeraddr,char *format)
 {
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
     CTransaction regtx; uint256 hash,txid,oracletxid,batontxid; CPubKey pk; int32_t i,ht,maxheight=0; int64_t datafee,price; char batonaddr[64]; std::vector <uint8_t> data; struct CCcontract_info *cp,C; std::vector <struct oracleprice_info> publishers; std::vector <int64_t> prices;
     if ( format[0] != 'L' )
         return(0);
+    if ( fOracleIndex != 0 )
+        return(OracleIndexedPrice(height,reforacletxid));
     cp = CCinit(&C,EVAL_ORACLES);
     SetCCunspents(unspentOutputs,markeraddr);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
@@ -500,8 +598,10 @@ int64_t OraclePrice(int32_t height,uint256 reforacletxid,char *markeraddr,char *
             if ( regtx.vout.size() > 0 && DecodeOraclesOpRet(regtx.vout[regtx.vout.size()-1].scriptPubKey,oracletxid,pk,datafee) == 'R' && oracletxid == reforacletxid )
             {
                 Getscriptaddress(batonaddr,regtx.vout[1].scriptPubKey);
-                batontxid = OracleBatonUtxo(10000,cp,oracletxid,batonaddr,pk,data);
-                if ( batontxid != zeroid && (ht= oracleprice_add(publishers,pk,ht,data,maxheight)) > maxheight )
+                // a publisher is recent by the height of its latest sample, as with -oracleindex
+                data.clear();
+                batontxid = OracleBatonUtxo(10000,cp,oracletxid,batonaddr,pk,data,&ht);
+                if ( batontxid != zeroid && data.size() > 0 && (ht= oracleprice_add(publishers,pk,ht,data,maxheight)) > maxheight )
                     maxheight = ht;
             }
         }
@@ -868,6 +968,11 @@ UniValue OracleInfo(uint256 origtxid)
             result.push_back(Pair("description",description));
             result.push_back(Pair("format",format));
             result.push_back(Pair("marker",markeraddr));
+            if ( format.size() > 0 && format[0] == 'L' )
+            {
+                sprintf(numstr,"%lld",(long long)OraclePrice(chainActive.Height(),origtxid,markeraddr,(char *)format.c_str()));
+                result.push_back(Pair("price",numstr));
+            }
             SetCCunspents(unspentOutputs,markeraddr);
             for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
             {
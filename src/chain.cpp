@@ -4,6 +4,8 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "chain.h"
+#include "main.h"
+#include "txdb.h"
 
 using namespace std;
 
@@ -32,6 +34,70 @@ void CChain::SetTip(CBlockIndex *pindex) {
     }
 }
 
+/**
+ * Solutions most recently read back for trimmed block index entries. The same headers tend to be asked for again
+ * soon, by peers syncing the same range and by REST, RPC and wallet lookups, so they are kept rather than read from
+ * the block tree database each time.
+ */
+class CSolutionCache
+{
+    static const size_t MAX_ENTRIES = 4096;
+
+    CCriticalSection cs;
+    std::map<uint256, std::vector<unsigned char>> mapSolutions;
+    std::deque<uint256> insertOrder;
+
+public:
+    bool Get(const uint256 &hash, std::vector<unsigned char> &solution)
+    {
+        LOCK(cs);
+        auto it = mapSolutions.find(hash);
+        if (it == mapSolutions.end())
+        {
+            return false;
+        }
+        solution = it->second;
+        return true;
+    }
+
+    void Add(const uint256 &hash, const std::vector<unsigned char> &solution)
+    {
+        LOCK(cs);
+        if (mapSolutions.insert(std::make_pair(hash, solution)).second)
+        {
+            insertOrder.push_back(hash);
+            while (insertOrder.size() > MAX_ENTRIES)
+            {
+                mapSolutions.erase(insertOrder.front());
+                insertOrder.pop_front();
+            }
+        }
+    }
+};
+
+static CSolutionCache solutionCache;
+
+std::vector<unsigned char> CBlockIndex::GetSolution() const
+{
+    if (!fSolutionTrimmed)
+    {
+        return nSolution;
+    }
+    std::vector<unsigned char> solution;
+    if (solutionCache.Get(GetBlockHash(), solution))
+    {
+        return solution;
+    }
+    CDiskBlockIndex dbindex;
+    if (!pblocktree || !pblocktree->ReadDiskBlockIndex(GetBlockHash(), dbindex))
+    {
+        LogPrintf("%s: failed to read solution for block index %s\n", __func__, GetBlockHash().GetHex());
+        throw std::runtime_error("Failed to read block index solution from database");
+    }
+    solutionCache.Add(GetBlockHash(), dbindex.GetDiskSolution());
+    return dbindex.GetDiskSolution();
+}
+
 // returns false if unable to fast calculate the VerusPOSHash from the header. 
 // if it returns false, value is set to 0, but it can still be calculated from the full block
 // in that case. the only difference between this and the POS hash for the contest is that it is not divided by the value out
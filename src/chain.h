@@ -277,6 +277,9 @@ public:
 
     int8_t segid; // jl777 fields
 
+    //! (memory only) true once nSolution has been released from memory after the index entry was written to disk
+    bool fSolutionTrimmed;
+
     //! Which # file this block is stored in (blk?????.dat)
     int nFile;
 
@@ -337,11 +340,35 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     uint256 nNonce;
-    std::vector<unsigned char> nSolution;
+
+    //! (memory only) MMR roots from the PBaaS solution descriptor, kept so that the MMR can be
+    //! built and proven without the solution in memory. null if the solution has no descriptor.
+    uint256 hashBlockMMRRoot;
+    uint256 hashPrevMMRRoot;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId;
-    
+
+protected:
+    //! the block solution, which is by far the largest part of a block index entry. once the entry has
+    //! been written to the block tree database, TrimSolution() releases it, and GetSolution() reads it back
+    std::vector<unsigned char> nSolution;
+
+    void CacheSolutionDescriptor()
+    {
+        hashBlockMMRRoot = hashPrevMMRRoot = uint256();
+        if (nVersion == CBlockHeader::VERUS_V2)
+        {
+            CPBaaSSolutionDescriptor descr = CConstVerusSolutionVector::GetDescriptor(nSolution);
+            if (descr.version >= CActivationHeight::ACTIVATE_PBAAS)
+            {
+                hashBlockMMRRoot = descr.hashBlockMMRRoot;
+                hashPrevMMRRoot = descr.hashPrevMMRRoot;
+            }
+        }
+    }
+
+public:
     void SetNull()
     {
         phashBlock = NULL;
@@ -349,6 +376,7 @@ public:
         maturity = 0;
         immature = 0;
         segid = -2;
+        fSolutionTrimmed = false;
         pprev = NULL;
         pskip = NULL;
         nFile = 0;
@@ -374,6 +402,8 @@ public:
         nBits          = 0;
         nNonce         = uint256();
         nSolution.clear();
+        hashBlockMMRRoot = uint256();
+        hashPrevMMRRoot = uint256();
     }
 
     CBlockIndex()
@@ -391,7 +421,30 @@ public:
         nTime          = block.nTime;
         nBits          = block.nBits;
         nNonce         = block.nNonce;
-        nSolution      = block.nSolution;
+        SetSolution(block.nSolution);
+    }
+
+    //! Replace the solution, which must match the header this entry was created from
+    void SetSolution(const std::vector<unsigned char> &solution)
+    {
+        nSolution = solution;
+        fSolutionTrimmed = false;
+        CacheSolutionDescriptor();
+    }
+
+    //! Returns the block solution, reading it from the block tree database if it has been trimmed.
+    std::vector<unsigned char> GetSolution() const;
+
+    //! Release the solution from memory. Only valid once this entry has been written to the block tree database.
+    void TrimSolution()
+    {
+        std::vector<unsigned char>().swap(nSolution);
+        fSolutionTrimmed = true;
+    }
+
+    bool IsSolutionTrimmed() const
+    {
+        return fSolutionTrimmed;
     }
 
     void SetHeight(int32_t height)
@@ -433,7 +486,7 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
+        block.nSolution      = GetSolution();
         return block;
     }
 
@@ -501,14 +554,22 @@ public:
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
 
+    // POS target and type only depend on the version and nonce, so avoid building a full header,
+    // which would require the solution
     int32_t GetVerusPOSTarget() const
     {
-        return GetBlockHeader().GetVerusPOSTarget();
+        CBlockHeader block;
+        block.nVersion = nVersion;
+        block.nNonce = nNonce;
+        return block.GetVerusPOSTarget();
     }
 
     bool IsVerusPOSBlock() const
     {
-        return GetBlockHeader().IsVerusPOSBlock();
+        CBlockHeader block;
+        block.nVersion = nVersion;
+        block.nNonce = nNonce;
+        return block.IsVerusPOSBlock();
     }
 
     bool GetRawVerusPOSHash(uint256 &ret) const;
@@ -516,28 +577,16 @@ public:
 
     uint256 BlockMMRRoot() const
     {
-        if (nVersion == CBlockHeader::VERUS_V2)
+        if (!hashBlockMMRRoot.IsNull())
         {
-            CPBaaSSolutionDescriptor descr = CConstVerusSolutionVector::GetDescriptor((nSolution));
-            if (descr.version >= CActivationHeight::ACTIVATE_PBAAS)
-            {
-                return descr.hashBlockMMRRoot;
-            }
+            return hashBlockMMRRoot;
         }
         return hashMerkleRoot;
     }
 
     uint256 PrevMMRRoot()
     {
-        if (nVersion == CBlockHeader::VERUS_V2)
-        {
-            CPBaaSSolutionDescriptor descr = CConstVerusSolutionVector::GetDescriptor(nSolution);
-            if (descr.version >= CActivationHeight::ACTIVATE_PBAAS)
-            {
-                return descr.hashPrevMMRRoot;
-            }
-        }
-        return uint256();
+        return hashPrevMMRRoot;
     }
 
     // return a node from this block index as is, including hash of merkle root and block hash as well as compact chain power, to put into an MMR
@@ -576,6 +625,17 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        if (pindex->IsSolutionTrimmed())
+        {
+            // we are about to (re)write this entry, so we need the solution that is already on disk
+            nSolution = pindex->GetSolution();
+            fSolutionTrimmed = false;
+        }
+    }
+
+    const std::vector<unsigned char> &GetDiskSolution() const
+    {
+        return nSolution;
     }
 
     ADD_SERIALIZE_METHODS;
@@ -667,11 +727,11 @@ public:
         block.nTime           = nTime;
         block.nBits           = nBits;
         block.nNonce          = nNonce;
-        block.nSolution       = nSolution;
+        block.nSolution       = GetSolution();
         CPBaaSPreHeader preBlock(block);
 
         str += strprintf("block.nVersion=%x\npprev=%p\nnHeight=%d\nhashBlock=%s\nblock.hashPrevBlock=%s\nblock.hashMerkleRoot=%s\nblock.nBits=%d\nblock.nNonce=%s\nblock.nSolution=%s\npreBlock.hashPrevMMRRoot=%s\npreBlock.hashBlockMMRRoot=%s\n",
-            this->nVersion, pprev, this->chainPower.nHeight, GetBlockHash().ToString(), hashPrev.ToString(), hashMerkleRoot.ToString(), nBits, nNonce.ToString(), HexBytes(nSolution.data(), nSolution.size()), preBlock.hashPrevMMRRoot.ToString(), preBlock.hashBlockMMRRoot.ToString());
+            this->nVersion, pprev, this->chainPower.nHeight, GetBlockHash().ToString(), hashPrev.ToString(), hashMerkleRoot.ToString(), nBits, nNonce.ToString(), HexBytes(block.nSolution.data(), block.nSolution.size()), preBlock.hashPrevMMRRoot.ToString(), preBlock.hashBlockMMRRoot.ToString());
 
         return str;
     }
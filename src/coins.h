@@ -11,6 +11,7 @@
 #include "compressor.h"
 #include "core_memusage.h"
 #include "memusage.h"
+#include "pooledmap.h"
 #include "serialize.h"
 #include "uint256.h"
 #include "base58.h"
@@ -335,7 +336,8 @@ enum ShieldedType
     SAPLING,
 };
 
-typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
+// the coins cache is by far the largest of these, so it uses the flat, pooled map
+typedef pooledmap<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
 typedef boost::unordered_map<uint256, CAnchorsSproutCacheEntry, CCoinsKeyHasher> CAnchorsSproutMap;
 typedef boost::unordered_map<uint256, CAnchorsSaplingCacheEntry, CCoinsKeyHasher> CAnchorsSaplingMap;
 typedef boost::unordered_map<uint256, CNullifiersCacheEntry, CCoinsKeyHasher> CNullifiersMap;
@@ -394,6 +396,12 @@ public:
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats &stats) const;
 
+    //! Wait until any writes this view or the views backing it hand to a background writer are on disk
+    virtual bool SyncWrites();
+
+    //! Memory held by writes that have been accepted but are not yet on disk
+    virtual size_t PendingWriteUsage() const;
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 };
@@ -424,6 +432,8 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    bool SyncWrites();
+    size_t PendingWriteUsage() const;
 };
 
 
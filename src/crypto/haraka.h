@@ -129,4 +129,25 @@ void haraka512_keyed(unsigned char *out, const unsigned char *in, const u128 *rc
 void haraka512_4x(unsigned char *out, const unsigned char *in);
 void haraka512_8x(unsigned char *out, const unsigned char *in);
 
+typedef void (*haraka_function)(unsigned char *out, const unsigned char *in);
+
+/* Four lane kernels, with the output of haraka256_4x and haraka512_4x, see haraka_vaes.c */
+enum {
+  HARAKA_KERNEL_X4 = 0,       // interleaved AES-NI, always available
+  HARAKA_KERNEL_VAES256 = 1,  // two lanes per AES instruction
+  HARAKA_KERNEL_VAES512 = 2,  // four lanes per AES instruction
+  HARAKA_KERNEL_COUNT = 3
+};
+
+void haraka256_4x_vaes256(unsigned char *out, const unsigned char *in);
+void haraka512_4x_vaes256(unsigned char *out, const unsigned char *in);
+void haraka256_4x_vaes512(unsigned char *out, const unsigned char *in);
+void haraka512_4x_vaes512(unsigned char *out, const unsigned char *in);
+
+int haraka_kernel_supported(int kernel);
+const char *haraka_kernel_name(int kernel);
+void haraka_get_kernels(int kernel, haraka_function *p256, haraka_function *p512);
+/* returns 1 if the kernel is supported and every lane matches haraka256 and haraka512 */
+int haraka_kernel_matches_reference(int kernel);
+
 #endif
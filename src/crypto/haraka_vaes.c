@@ -0,0 +1,319 @@
+/*
+Four lane Haraka256 and Haraka512 kernels using VAES, with CPUID based
+detection of the kernels this CPU supports.
+
+The VAES-256 kernels run two lanes in each AES instruction and the VAES-512
+kernels run all four, with the round constants broadcast to every lane.
+Each kernel produces exactly the output of haraka256_4x and haraka512_4x,
+which remain the fallback wherever VAES is unavailable.
+
+Distributed under the MIT software license, see the accompanying
+file COPYING or http://www.opensource.org/licenses/mit-license.php.
+*/
+
+#include <string.h>
+#include "crypto/haraka.h"
+
+// VAES needs gcc 8 or clang 7 to build with function level targets. MinGW does not align the stack for spilled
+// 256 and 512 bit registers, so the kernels are left out of Windows builds
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(_WIN32) && \
+    ((defined(__clang__) && __clang_major__ >= 7) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define HARAKA_VAES_KERNELS 1
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+static const char *haraka_kernel_names[HARAKA_KERNEL_COUNT] = {"x4", "vaes256-x4", "vaes512-x4"};
+
+#ifdef HARAKA_VAES_KERNELS
+
+#define HARAKA_VAES256 __attribute__((target("avx2,vaes")))
+#define HARAKA_VAES512 __attribute__((target("avx512f,vaes")))
+
+#define LOADU(src) _mm_loadu_si128((const u128 *)(src))
+
+// store the truncated Haraka512 output of one lane
+#define TRUNCSTORE_LANE(out, s0, s1, s2, s3) \
+  _mm_storel_epi64((u128 *)(out), _mm_unpackhi_epi64(s0, s0)); \
+  _mm_storel_epi64((u128 *)((out) + 8), _mm_unpackhi_epi64(s1, s1)); \
+  _mm_storel_epi64((u128 *)((out) + 16), s2); \
+  _mm_storel_epi64((u128 *)((out) + 24), s3);
+
+#define AES2_VAES256(s0, s1, rci) \
+  s0 = _mm256_aesenc_epi128(s0, _mm256_broadcastsi128_si256(rc[rci])); \
+  s1 = _mm256_aesenc_epi128(s1, _mm256_broadcastsi128_si256(rc[rci + 1])); \
+  s0 = _mm256_aesenc_epi128(s0, _mm256_broadcastsi128_si256(rc[rci + 2])); \
+  s1 = _mm256_aesenc_epi128(s1, _mm256_broadcastsi128_si256(rc[rci + 3]));
+
+#define MIX2_VAES256(s0, s1) \
+  tmp = _mm256_unpacklo_epi32(s0, s1); \
+  s1 = _mm256_unpackhi_epi32(s0, s1); \
+  s0 = tmp;
+
+#define AES4_VAES256(s0, s1, s2, s3, rci) \
+  s0 = _mm256_aesenc_epi128(s0, _mm256_broadcastsi128_si256(rc[rci])); \
+  s1 = _mm256_aesenc_epi128(s1, _mm256_broadcastsi128_si256(rc[rci + 1])); \
+  s2 = _mm256_aesenc_epi128(s2, _mm256_broadcastsi128_si256(rc[rci + 2])); \
+  s3 = _mm256_aesenc_epi128(s3, _mm256_broadcastsi128_si256(rc[rci + 3])); \
+  s0 = _mm256_aesenc_epi128(s0, _mm256_broadcastsi128_si256(rc[rci + 4])); \
+  s1 = _mm256_aesenc_epi128(s1, _mm256_broadcastsi128_si256(rc[rci + 5])); \
+  s2 = _mm256_aesenc_epi128(s2, _mm256_broadcastsi128_si256(rc[rci + 6])); \
+  s3 = _mm256_aesenc_epi128(s3, _mm256_broadcastsi128_si256(rc[rci + 7]));
+
+#define MIX4_VAES256(s0, s1, s2, s3) \
+  tmp  = _mm256_unpacklo_epi32(s0, s1); \
+  s0 = _mm256_unpackhi_epi32(s0, s1); \
+  s1 = _mm256_unpacklo_epi32(s2, s3); \
+  s2 = _mm256_unpackhi_epi32(s2, s3); \
+  s3 = _mm256_unpacklo_epi32(s0, s2); \
+  s0 = _mm256_unpackhi_epi32(s0, s2); \
+  s2 = _mm256_unpackhi_epi32(s1, tmp); \
+  s1 = _mm256_unpacklo_epi32(s1, tmp);
+
+HARAKA_VAES256 void haraka256_4x_vaes256(unsigned char *out, const unsigned char *in) {
+  // s[h][j] holds state word j of lanes 2h and 2h + 1
+  __m256i s[2][2], in0[2][2], tmp;
+  int h, r;
+
+  for (h = 0; h < 2; h++) {
+    in0[h][0] = s[h][0] = _mm256_set_m128i(LOADU(in + 64 * h + 32), LOADU(in + 64 * h));
+    in0[h][1] = s[h][1] = _mm256_set_m128i(LOADU(in + 64 * h + 48), LOADU(in + 64 * h + 16));
+  }
+
+  for (r = 0; r < NUMROUNDS; r++) {
+    AES2_VAES256(s[0][0], s[0][1], 4 * r);
+    AES2_VAES256(s[1][0], s[1][1], 4 * r);
+    MIX2_VAES256(s[0][0], s[0][1]);
+    MIX2_VAES256(s[1][0], s[1][1]);
+  }
+
+  for (h = 0; h < 2; h++) {
+    s[h][0] = _mm256_xor_si256(s[h][0], in0[h][0]);
+    s[h][1] = _mm256_xor_si256(s[h][1], in0[h][1]);
+    _mm_storeu_si128((u128 *)(out + 64 * h), _mm256_castsi256_si128(s[h][0]));
+    _mm_storeu_si128((u128 *)(out + 64 * h + 16), _mm256_castsi256_si128(s[h][1]));
+    _mm_storeu_si128((u128 *)(out + 64 * h + 32), _mm256_extracti128_si256(s[h][0], 1));
+    _mm_storeu_si128((u128 *)(out + 64 * h + 48), _mm256_extracti128_si256(s[h][1], 1));
+  }
+}
+
+HARAKA_VAES256 void haraka512_4x_vaes256(unsigned char *out, const unsigned char *in) {
+  // s[h][j] holds state word j of lanes 2h and 2h + 1
+  __m256i s[2][4], in0[2][4], tmp;
+  int h, j, r;
+
+  for (h = 0; h < 2; h++) {
+    for (j = 0; j < 4; j++) {
+      in0[h][j] = s[h][j] = _mm256_set_m128i(LOADU(in + 128 * h + 64 + 16 * j), LOADU(in + 128 * h + 16 * j));
+    }
+  }
+
+  for (r = 0; r < NUMROUNDS; r++) {
+    AES4_VAES256(s[0][0], s[0][1], s[0][2], s[0][3], 8 * r);
+    AES4_VAES256(s[1][0], s[1][1], s[1][2], s[1][3], 8 * r);
+    MIX4_VAES256(s[0][0], s[0][1], s[0][2], s[0][3]);
+    MIX4_VAES256(s[1][0], s[1][1], s[1][2], s[1][3]);
+  }
+
+  for (h = 0; h < 2; h++) {
+    u128 lo[4], hi[4];
+    for (j = 0; j < 4; j++) {
+      s[h][j] = _mm256_xor_si256(s[h][j], in0[h][j]);
+      lo[j] = _mm256_castsi256_si128(s[h][j]);
+      hi[j] = _mm256_extracti128_si256(s[h][j], 1);
+    }
+    TRUNCSTORE_LANE(out + 64 * h, lo[0], lo[1], lo[2], lo[3]);
+    TRUNCSTORE_LANE(out + 64 * h + 32, hi[0], hi[1], hi[2], hi[3]);
+  }
+}
+
+#define AES2_VAES512(s0, s1, rci) \
+  s0 = _mm512_aesenc_epi128(s0, _mm512_broadcast_i32x4(rc[rci])); \
+  s1 = _mm512_aesenc_epi128(s1, _mm512_broadcast_i32x4(rc[rci + 1])); \
+  s0 = _mm512_aesenc_epi128(s0, _mm512_broadcast_i32x4(rc[rci + 2])); \
+  s1 = _mm512_aesenc_epi128(s1, _mm512_broadcast_i32x4(rc[rci + 3]));
+
+#define MIX2_VAES512(s0, s1) \
+  tmp = _mm512_unpacklo_epi32(s0, s1); \
+  s1 = _mm512_unpackhi_epi32(s0, s1); \
+  s0 = tmp;
+
+#define AES4_VAES512(s0, s1, s2, s3, rci) \
+  s0 = _mm512_aesenc_epi128(s0, _mm512_broadcast_i32x4(rc[rci])); \
+  s1 = _mm512_aesenc_epi128(s1, _mm512_broadcast_i32x4(rc[rci + 1])); \
+  s2 = _mm512_aesenc_epi128(s2, _mm512_broadcast_i32x4(rc[rci + 2])); \
+  s3 = _mm512_aesenc_epi128(s3, _mm512_broadcast_i32x4(rc[rci + 3])); \
+  s0 = _mm512_aesenc_epi128(s0, _mm512_broadcast_i32x4(rc[rci + 4])); \
+  s1 = _mm512_aesenc_epi128(s1, _mm512_broadcast_i32x4(rc[rci + 5])); \
+  s2 = _mm512_aesenc_epi128(s2, _mm512_broadcast_i32x4(rc[rci + 6])); \
+  s3 = _mm512_aesenc_epi128(s3, _mm512_broadcast_i32x4(rc[rci + 7]));
+
+#define MIX4_VAES512(s0, s1, s2, s3) \
+  tmp  = _mm512_unpacklo_epi32(s0, s1); \
+  s0 = _mm512_unpackhi_epi32(s0, s1); \
+  s1 = _mm512_unpacklo_epi32(s2, s3); \
+  s2 = _mm512_unpackhi_epi32(s2, s3); \
+  s3 = _mm512_unpacklo_epi32(s0, s2); \
+  s0 = _mm512_unpackhi_epi32(s0, s2); \
+  s2 = _mm512_unpackhi_epi32(s1, tmp); \
+  s1 = _mm512_unpacklo_epi32(s1, tmp);
+
+// gather one 128 bit word from each of four lanes, stride bytes apart
+HARAKA_VAES512 static inline __m512i load_4x128(const unsigned char *in, int stride) {
+  __m512i v = _mm512_castsi128_si512(LOADU(in));
+  v = _mm512_inserti32x4(v, LOADU(in + stride), 1);
+  v = _mm512_inserti32x4(v, LOADU(in + 2 * stride), 2);
+  return _mm512_inserti32x4(v, LOADU(in + 3 * stride), 3);
+}
+
+HARAKA_VAES512 void haraka256_4x_vaes512(unsigned char *out, const unsigned char *in) {
+  // s[j] holds state word j of all four lanes
+  __m512i s[2], in0[2], tmp;
+  int j, r;
+
+  for (j = 0; j < 2; j++) {
+    in0[j] = s[j] = load_4x128(in + 16 * j, 32);
+  }
+
+  for (r = 0; r < NUMROUNDS; r++) {
+    AES2_VAES512(s[0], s[1], 4 * r);
+    MIX2_VAES512(s[0], s[1]);
+  }
+
+  for (j = 0; j < 2; j++) {
+    s[j] = _mm512_xor_si512(s[j], in0[j]);
+    _mm_storeu_si128((u128 *)(out + 16 * j), _mm512_extracti32x4_epi32(s[j], 0));
+    _mm_storeu_si128((u128 *)(out + 32 + 16 * j), _mm512_extracti32x4_epi32(s[j], 1));
+    _mm_storeu_si128((u128 *)(out + 64 + 16 * j), _mm512_extracti32x4_epi32(s[j], 2));
+    _mm_storeu_si128((u128 *)(out + 96 + 16 * j), _mm512_extracti32x4_epi32(s[j], 3));
+  }
+}
+
+HARAKA_VAES512 void haraka512_4x_vaes512(unsigned char *out, const unsigned char *in) {
+  // s[j] holds state word j of all four lanes
+  __m512i s[4], in0[4], tmp;
+  u128 lane[4][4];
+  int j, r;
+
+  for (j = 0; j < 4; j++) {
+    in0[j] = s[j] = load_4x128(in + 16 * j, 64);
+  }
+
+  for (r = 0; r < NUMROUNDS; r++) {
+    AES4_VAES512(s[0], s[1], s[2], s[3], 8 * r);
+    MIX4_VAES512(s[0], s[1], s[2], s[3]);
+  }
+
+  for (j = 0; j < 4; j++) {
+    s[j] = _mm512_xor_si512(s[j], in0[j]);
+    lane[0][j] = _mm512_extracti32x4_epi32(s[j], 0);
+    lane[1][j] = _mm512_extracti32x4_epi32(s[j], 1);
+    lane[2][j] = _mm512_extracti32x4_epi32(s[j], 2);
+    lane[3][j] = _mm512_extracti32x4_epi32(s[j], 3);
+  }
+  for (j = 0; j < 4; j++) {
+    TRUNCSTORE_LANE(out + 32 * j, lane[j][0], lane[j][1], lane[j][2], lane[j][3]);
+  }
+}
+
+static unsigned long long haraka_xgetbv0() {
+  unsigned int eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((unsigned long long)edx << 32) | eax;
+}
+
+int haraka_kernel_supported(int kernel) {
+  unsigned int eax, ebx, ecx, edx;
+  unsigned long long xcr0;
+
+  if (kernel == HARAKA_KERNEL_X4) {
+    return 1;
+  }
+  if (kernel != HARAKA_KERNEL_VAES256 && kernel != HARAKA_KERNEL_VAES512) {
+    return 0;
+  }
+
+  // AES and an OS that saves extended state, then VAES and the vector width on leaf 7
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_AES) || !(ecx & bit_OSXSAVE) ||
+      __get_cpuid_max(0, 0) < 7) {
+    return 0;
+  }
+  xcr0 = haraka_xgetbv0();
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if (!(ecx & (1 << 9))) {
+    return 0;
+  }
+  if (kernel == HARAKA_KERNEL_VAES256) {
+    return (ebx & (1 << 5)) && (xcr0 & 0x6) == 0x6;
+  }
+  return (ebx & (1 << 16)) && (xcr0 & 0xe6) == 0xe6;
+}
+
+#else // HARAKA_VAES_KERNELS
+
+void haraka256_4x_vaes256(unsigned char *out, const unsigned char *in) { haraka256_4x(out, in); }
+void haraka512_4x_vaes256(unsigned char *out, const unsigned char *in) { haraka512_4x(out, in); }
+void haraka256_4x_vaes512(unsigned char *out, const unsigned char *in) { haraka256_4x(out, in); }
+void haraka512_4x_vaes512(unsigned char *out, const unsigned char *in) { haraka512_4x(out, in); }
+
+int haraka_kernel_supported(int kernel) {
+  return kernel == HARAKA_KERNEL_X4;
+}
+
+#endif // HARAKA_VAES_KERNELS
+
+const char *haraka_kernel_name(int kernel) {
+  return (kernel >= 0 && kernel < HARAKA_KERNEL_COUNT) ? haraka_kernel_names[kernel] : "unknown";
+}
+
+void haraka_get_kernels(int kernel, haraka_function *p256, haraka_function *p512) {
+  switch (kernel) {
+    case HARAKA_KERNEL_VAES256:
+      *p256 = &haraka256_4x_vaes256;
+      *p512 = &haraka512_4x_vaes256;
+      break;
+    case HARAKA_KERNEL_VAES512:
+      *p256 = &haraka256_4x_vaes512;
+      *p512 = &haraka512_4x_vaes512;
+      break;
+    default:
+      *p256 = &haraka256_4x;
+      *p512 = &haraka512_4x;
+  }
+}
+
+int haraka_kernel_matches_reference(int kernel) {
+  unsigned char in[256], out[128], ref[128];
+  haraka_function f256, f512;
+  int i, trial;
+
+  if (!haraka_kernel_supported(kernel)) {
+    return 0;
+  }
+  haraka_get_kernels(kernel, &f256, &f512);
+
+  // fixed inputs, so that a mismatch can be reproduced
+  for (trial = 0; trial < 16; trial++) {
+    for (i = 0; i < sizeof(in); i++) {
+      in[i] = (unsigned char)(i * 167 + trial * 59 + (i >> 3) * trial);
+    }
+
+    // every lane must match the single lane function on its own input
+    f256(out, in);
+    for (i = 0; i < 4; i++) {
+      haraka256(ref + 32 * i, in + 32 * i);
+    }
+    if (memcmp(out, ref, 128)) {
+      return 0;
+    }
+
+    f512(out, in);
+    for (i = 0; i < 4; i++) {
+      haraka512(ref + 32 * i, in + 64 * i);
+    }
+    if (memcmp(out, ref, 128)) {
+      return 0;
+    }
+  }
+  return 1;
+}
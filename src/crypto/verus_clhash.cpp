@@ -20,6 +20,7 @@
 #include "primitives/block.h"
 
 #include <assert.h>
+#include <chrono>
 #include <string.h>
 
 #ifdef _WIN32
@@ -40,6 +41,7 @@ int __cpuverusoptimized = 0x80;
 
 thread_local thread_specific_ptr verusclhasher_key;
 thread_local thread_specific_ptr verusclhasher_descr;
+thread_local uint64_t verusclhasher_keygen_nanos = 0;
 
 #if defined(__APPLE__) || defined(_WIN32)
 // attempt to workaround horrible mingw/gcc destructor bug on Windows and Mac, which passes garbage in the this pointer
@@ -248,6 +250,8 @@ bool mine_verus_v2(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHas
     // skip keygen if it is the current key
     if (pdesc->seed != *((uint256 *)curBuf))
     {
+        auto keygenStart = std::chrono::steady_clock::now();
+
         // generate a new key by chain hashing with Haraka256 from the last curbuf
         // assume 256 bit boundary
         int n256blks = keysize >> 5;
@@ -262,6 +266,8 @@ bool mine_verus_v2(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHas
         pdesc->seed = *((uint256 *)curBuf);
         memcpy(hasherrefresh, hashKey, keyrefreshsize);
         memset(((unsigned char *)hasherrefresh) + keyrefreshsize, 0, keysize - keyrefreshsize);
+
+        verusclhasher_keygen_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - keygenStart).count();
     }
     else
     {
@@ -98,6 +98,8 @@ struct thread_specific_ptr {
 
 extern thread_local thread_specific_ptr verusclhasher_key;
 extern thread_local thread_specific_ptr verusclhasher_descr;
+// time this thread's mining kernel spent generating new keys, for mining metrics
+extern thread_local uint64_t verusclhasher_keygen_nanos;
 
 extern int __cpuverusoptimized;
 
@@ -21,6 +21,7 @@
 #include "primitives/block.h"
 
 #include <assert.h>
+#include <chrono>
 #include <string.h>
 
 #ifdef __APPLE__
@@ -1272,6 +1273,8 @@ bool mine_verus_v2_port(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &fin
     // skip keygen if it is the current key
     if (pdesc->seed != *((uint256 *)curBuf))
     {
+        auto keygenStart = std::chrono::steady_clock::now();
+
         // generate a new key by chain hashing with Haraka256 from the last curbuf
         // assume 256 bit boundary
         int n256blks = keysize >> 5;
@@ -1286,6 +1289,8 @@ bool mine_verus_v2_port(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &fin
         pdesc->seed = *((uint256 *)curBuf);
         memcpy(hasherrefresh, hashKey, keyrefreshsize);
         memset(((unsigned char *)hasherrefresh) + keyrefreshsize, 0, keysize - keyrefreshsize);
+
+        verusclhasher_keygen_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - keygenStart).count();
     }
     else
     {
@@ -4,24 +4,143 @@
 
 #include "dbwrapper.h"
 
+#include "sync.h"
 #include "util.h"
 
 #include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
 #include <stdint.h>
+#include <stdio.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles)
+#include <set>
+#include <sstream>
+
+/** LRU block cache that counts lookups, so that cache hit rates can be reported */
+class CCountingCache : public leveldb::Cache
+{
+private:
+    leveldb::Cache *pcache;
+
+public:
+    const size_t nCapacity;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+    CCountingCache(size_t capacity) : pcache(leveldb::NewLRUCache(capacity)), nCapacity(capacity), nHits(0), nMisses(0) {}
+    ~CCountingCache() { delete pcache; }
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge, void (*deleter)(const leveldb::Slice& key, void* value))
+    {
+        return pcache->Insert(key, value, charge, deleter);
+    }
+
+    Handle* Lookup(const leveldb::Slice& key)
+    {
+        Handle *h = pcache->Lookup(key);
+        if (h)
+            nHits.fetch_add(1, std::memory_order_relaxed);
+        else
+            nMisses.fetch_add(1, std::memory_order_relaxed);
+        return h;
+    }
+
+    void Release(Handle* handle) { pcache->Release(handle); }
+    void* Value(Handle* handle) { return pcache->Value(handle); }
+    void Erase(const leveldb::Slice& key) { pcache->Erase(key); }
+    uint64_t NewId() { return pcache->NewId(); }
+};
+
+static CCriticalSection cs_openDBs;
+static std::set<const CDBWrapper*> setOpenDBs;
+
+CDBTuningProfile GetDBTuningProfile(const std::string &name, bool compression, int maxOpenFiles)
+{
+    CDBTuningProfile profile(name, compression, maxOpenFiles);
+
+    if (name == "chainstate")
+    {
+        // point lookups of coins, nullifiers and anchors, most of which miss in the filter
+        profile.nBloomBits = 12;
+    }
+    else if (name == "blockindex")
+    {
+        // block index, tx index and the address, spent and timestamp indexes, which are mostly
+        // read by range scans over adjacent keys
+        profile.nBlockSize = 16384;
+    }
+    else if (name == "notarisations")
+    {
+        // small and rarely read, so give most of its small cache to write buffers
+        profile.nBlockCachePercent = 30;
+        profile.nWriteBufferPercent = 35;
+    }
+
+    // apply overrides of the form <name>:<option>=<value>
+    if (mapMultiArgs.count("-dbtuning"))
+    {
+        for (auto &setting : mapMultiArgs["-dbtuning"])
+        {
+            size_t colon = setting.find(':');
+            size_t equals = setting.find('=');
+            if (colon == std::string::npos || equals == std::string::npos || equals < colon || setting.substr(0, colon) != name)
+            {
+                continue;
+            }
+            std::string option = setting.substr(colon + 1, equals - colon - 1);
+            std::string value = setting.substr(equals + 1);
+            try
+            {
+                if (option == "blocksize")
+                    profile.nBlockSize = boost::lexical_cast<size_t>(value);
+                else if (option == "restartinterval")
+                    profile.nBlockRestartInterval = boost::lexical_cast<int>(value);
+                else if (option == "bloombits")
+                    profile.nBloomBits = boost::lexical_cast<int>(value);
+                else if (option == "compression")
+                    profile.fCompression = boost::lexical_cast<int>(value) != 0;
+                else if (option == "blockcachepct")
+                    profile.nBlockCachePercent = boost::lexical_cast<int>(value);
+                else if (option == "writebufferpct")
+                    profile.nWriteBufferPercent = boost::lexical_cast<int>(value);
+                else if (option == "maxopenfiles")
+                    profile.nMaxOpenFiles = boost::lexical_cast<int>(value);
+                else if (option == "compactonopen")
+                    profile.fCompactOnOpen = boost::lexical_cast<int>(value) != 0;
+                else
+                    LogPrintf("Ignoring unknown -dbtuning option %s\n", setting);
+            }
+            catch (const boost::bad_lexical_cast &e)
+            {
+                LogPrintf("Ignoring invalid -dbtuning value %s\n", setting);
+            }
+        }
+    }
+
+    // keep the cache split within the configured cache size
+    profile.nBlockCachePercent = std::max(1, std::min(profile.nBlockCachePercent, 100));
+    profile.nWriteBufferPercent = std::max(1, std::min(profile.nWriteBufferPercent, (100 - profile.nBlockCachePercent) / 2));
+    profile.nBlockSize = std::max(profile.nBlockSize, (size_t)1024);
+    profile.nBlockRestartInterval = std::max(profile.nBlockRestartInterval, 1);
+    profile.nBloomBits = std::max(profile.nBloomBits, 0);
+    profile.nMaxOpenFiles = std::max(profile.nMaxOpenFiles, 16);
+    return profile;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBTuningProfile &profile)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
-    options.max_open_files = maxOpenFiles;
+    options.block_cache = new CCountingCache(nCacheSize * profile.nBlockCachePercent / 100);
+    options.write_buffer_size = nCacheSize * profile.nWriteBufferPercent / 100; // up to two write buffers may be held in memory simultaneously
+    options.filter_policy = profile.nBloomBits ? leveldb::NewBloomFilterPolicy(profile.nBloomBits) : NULL;
+    options.compression = profile.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = profile.nMaxOpenFiles;
+    options.block_size = profile.nBlockSize;
+    options.block_restart_interval = profile.nBlockRestartInterval;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -30,14 +149,17 @@ static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxO
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles, const std::string &profileName) :
+    nReads(0), nReadMisses(0), nBatches(0), nBatchBytes(0)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, compression, maxOpenFiles);
+    profile = GetDBTuningProfile(profileName.empty() ? path.filename().string() : profileName, compression, maxOpenFiles);
+    strPath = path.string();
+    options = GetOptions(nCacheSize, profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -53,11 +175,23 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
-    LogPrintf("Opened LevelDB successfully\n");
+    LogPrintf("Opened LevelDB successfully with tuning profile %s (block size %u, bloom bits %d, compression %d)\n",
+              profile.name, profile.nBlockSize, profile.nBloomBits, profile.fCompression);
+    if (profile.fCompactOnOpen) {
+        LogPrintf("Compacting LevelDB in %s\n", path.string());
+        pdb->CompactRange(NULL, NULL);
+    }
+
+    LOCK(cs_openDBs);
+    setOpenDBs.insert(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(cs_openDBs);
+        setOpenDBs.erase(this);
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -72,9 +206,60 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    nBatches.fetch_add(1, std::memory_order_relaxed);
+    nBatchBytes.fetch_add(batch.SizeEstimate(), std::memory_order_relaxed);
     return true;
 }
 
+CDBStats CDBWrapper::GetStats() const
+{
+    CDBStats stats;
+    stats.name = profile.name;
+    stats.path = strPath;
+    stats.profile = profile;
+    stats.nWriteBufferSize = options.write_buffer_size;
+    stats.nReads = nReads.load();
+    stats.nReadMisses = nReadMisses.load();
+    stats.nBatches = nBatches.load();
+    stats.nBatchBytes = nBatchBytes.load();
+
+    // the block cache is always created by GetOptions
+    const CCountingCache *pcache = static_cast<const CCountingCache *>(options.block_cache);
+    stats.nBlockCacheSize = pcache->nCapacity;
+    stats.nBlockCacheHits = pcache->nHits.load();
+    stats.nBlockCacheMisses = pcache->nMisses.load();
+
+    // the per level table of the "leveldb.stats" property has one row for each non-empty level:
+    // level, files, size(MB), compaction time(sec), compaction read(MB), compaction write(MB)
+    std::string strStats;
+    if (pdb->GetProperty("leveldb.stats", &strStats))
+    {
+        std::istringstream lines(strStats);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            CDBStats::LevelStats level;
+            if (sscanf(line.c_str(), "%d %d %lf %lf %lf %lf", &level.nLevel, &level.nFiles, &level.sizeMB,
+                       &level.compactionSeconds, &level.compactionReadMB, &level.compactionWriteMB) == 6)
+            {
+                stats.levels.push_back(level);
+            }
+        }
+    }
+    return stats;
+}
+
+std::vector<CDBStats> GetAllDBStats()
+{
+    std::vector<CDBStats> allStats;
+    LOCK(cs_openDBs);
+    for (auto pdbw : setOpenDBs)
+    {
+        allStats.push_back(pdbw->GetStats());
+    }
+    return allStats;
+}
+
 bool CDBWrapper::IsEmpty()
 {
     boost::scoped_ptr<CDBIterator> it(NewIterator());
@@ -11,6 +11,10 @@
 #include "util.h"
 #include "version.h"
 
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -27,6 +31,60 @@ public:
 
 class CDBWrapper;
 
+/**
+ * LevelDB tuning for one database. Each CDBWrapper selects a profile by name, and
+ * any field can be overridden with -dbtuning=<name>:<option>=<value>.
+ */
+struct CDBTuningProfile
+{
+    std::string name;
+    size_t nBlockSize;              //!< approximate uncompressed size of each table block
+    int nBlockRestartInterval;      //!< keys between restart points for key delta encoding
+    int nBloomBits;                 //!< bloom filter bits per key, 0 disables the filter
+    bool fCompression;              //!< snappy compression of table blocks
+    int nBlockCachePercent;         //!< share of the database cache used for the block cache
+    int nWriteBufferPercent;        //!< share of the database cache used for each of the (up to two) write buffers
+    int nMaxOpenFiles;
+    bool fCompactOnOpen;            //!< compact the whole database after opening it
+
+    CDBTuningProfile(const std::string &profileName="default", bool compression=false, int maxOpenFiles=64) :
+        name(profileName), nBlockSize(4096), nBlockRestartInterval(16), nBloomBits(10), fCompression(compression),
+        nBlockCachePercent(50), nWriteBufferPercent(25), nMaxOpenFiles(maxOpenFiles), fCompactOnOpen(false) {}
+};
+
+/** Returns the built-in profile for the named database with any -dbtuning overrides applied */
+CDBTuningProfile GetDBTuningProfile(const std::string &name, bool compression, int maxOpenFiles);
+
+/** Counters and LevelDB internal statistics for one open database */
+struct CDBStats
+{
+    struct LevelStats
+    {
+        int nLevel;
+        int nFiles;
+        double sizeMB;
+        double compactionSeconds;
+        double compactionReadMB;
+        double compactionWriteMB;
+    };
+
+    std::string name;
+    std::string path;
+    CDBTuningProfile profile;
+    size_t nBlockCacheSize;
+    size_t nWriteBufferSize;
+    uint64_t nReads;
+    uint64_t nReadMisses;
+    uint64_t nBatches;
+    uint64_t nBatchBytes;
+    uint64_t nBlockCacheHits;
+    uint64_t nBlockCacheMisses;
+    std::vector<LevelStats> levels;
+};
+
+/** Returns statistics for every open database */
+std::vector<CDBStats> GetAllDBStats();
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -45,12 +103,15 @@ class CDBBatch
 private:
     const CDBWrapper &parent;
     leveldb::WriteBatch batch;
+    size_t size_estimate;
 
 public:
     /**
      * @param[in] _parent   CDBWrapper that this batch is to be submitted to
      */
-    CDBBatch(const CDBWrapper &_parent) : parent(_parent) { };
+    CDBBatch(const CDBWrapper &_parent) : parent(_parent), size_estimate(0) { };
+
+    size_t SizeEstimate() const { return size_estimate; }
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
@@ -66,6 +127,7 @@ public:
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
 
         batch.Put(slKey, slValue);
+        size_estimate += slKey.size() + slValue.size();
     }
 
     template <typename K>
@@ -77,6 +139,21 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         batch.Delete(slKey);
+        size_estimate += slKey.size();
+    }
+
+    //! write a key and value that are already serialized
+    void WriteSerialized(const std::string &key, const std::string &value)
+    {
+        batch.Put(key, value);
+        size_estimate += key.size() + value.size();
+    }
+
+    //! erase a key that is already serialized
+    void EraseSerialized(const std::string &key)
+    {
+        batch.Delete(key);
+        size_estimate += key.size();
     }
 };
 
@@ -127,6 +204,10 @@ public:
         return piter->key().size();
     }
 
+    leveldb::Slice GetKeySlice() {
+        return piter->key();
+    }
+
     template<typename V> bool GetValue(V& value) {
         leveldb::Slice slValue = piter->value();
         try {
@@ -142,6 +223,10 @@ public:
         return piter->value().size();
     }
 
+    leveldb::Slice GetValueSlice() {
+        return piter->value();
+    }
+
 };
 
 class CDBWrapper
@@ -168,16 +253,31 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! tuning profile this database was opened with
+    CDBTuningProfile profile;
+
+    //! location of the database, for statistics
+    std::string strPath;
+
+    //! counters reported by GetStats
+    mutable std::atomic<uint64_t> nReads;
+    mutable std::atomic<uint64_t> nReadMisses;
+    std::atomic<uint64_t> nBatches;
+    std::atomic<uint64_t> nBatchBytes;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
      * @param[in] nCacheSize  Configures various leveldb cache settings.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
+     * @param[in] profileName Tuning profile to use, defaults to the name of the database directory.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64, const std::string &profileName = "");
     ~CDBWrapper();
 
+    CDBStats GetStats() const;
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
@@ -188,9 +288,12 @@ public:
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        nReads.fetch_add(1, std::memory_order_relaxed);
         if (!status.ok()) {
-            if (status.IsNotFound())
+            if (status.IsNotFound()) {
+                nReadMisses.fetch_add(1, std::memory_order_relaxed);
                 return false;
+            }
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
@@ -221,9 +324,12 @@ public:
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        nReads.fetch_add(1, std::memory_order_relaxed);
         if (!status.ok()) {
-            if (status.IsNotFound())
+            if (status.IsNotFound()) {
+                nReadMisses.fetch_add(1, std::memory_order_relaxed);
                 return false;
+            }
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
@@ -4,6 +4,7 @@
 #include "utiltest.h"
 #include "utiltime.h"
 
+extern uint32_t ASSETCHAINS_ALGO, ASSETCHAINS_VERUSHASH;
 
 TEST(Metrics, AtomicTimer) {
     AtomicTimer t;
@@ -94,6 +95,38 @@ TEST(Metrics, GetLocalSolPS) {
     EXPECT_EQ(1, GetLocalSolPS());
 }
 
+TEST(Metrics, GetLocalSolPSVerusHash) {
+    uint32_t savedAlgo = ASSETCHAINS_ALGO;
+    ASSETCHAINS_ALGO = ASSETCHAINS_VERUSHASH;
+    while (miningTimer.running()) {
+        miningTimer.stop();
+    }
+    SetMockTime(200);
+    ClearMiningThreads();
+    ClearMiningTimer();
+
+    MiningThreadCounters *pCounters = RegisterMiningThread();
+    miningTimer.start();
+    pCounters->hashes += 100;
+    SetMockTime(202);
+    EXPECT_EQ(50, GetLocalSolPS());
+
+    // Restarting mining clears the timer, but not the thread's counters
+    miningTimer.stop();
+    ClearMiningTimer();
+    miningTimer.start();
+    EXPECT_EQ(0, GetLocalSolPS());
+
+    pCounters->hashes += 30;
+    SetMockTime(203);
+    EXPECT_EQ(30, GetLocalSolPS());
+
+    miningTimer.stop();
+    ClearMiningThreads();
+    ClearMiningTimer();
+    ASSETCHAINS_ALGO = savedAlgo;
+}
+
 TEST(Metrics, EstimateNetHeight) {
     auto params = RegtestActivateBlossom(false, 200);
     int64_t blockTimes[400];
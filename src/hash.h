@@ -257,6 +257,15 @@ public:
         return result;
     }
 
+    // copy the state out and back in, to hash a common prefix of several messages once
+    static const size_t STATE_SIZE = sizeof(crypto_generichash_blake2b_state);
+    void SaveState(unsigned char *pch) const {
+        memcpy(pch, &state, STATE_SIZE);
+    }
+    void RestoreState(const unsigned char *pch) {
+        memcpy(&state, pch, STATE_SIZE);
+    }
+
     template<typename T>
     CBLAKE2bWriter& operator<<(const T& obj) {
         // Serialize to this stream
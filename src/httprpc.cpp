@@ -142,10 +142,15 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                 printf("%s %s\n", jreq.strMethod.c_str(), jreq.params.write().c_str());
             }
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // Write the reply as JSONRPCReply would, letting the command write its result straight into it
+            UniValueWriter writer(strReply);
+            writer.beginObject();
+            writer.key("result");
+            tableRPC.execute(jreq.strMethod, jreq.params, writer);
+            writer.pushKV("error", NullUniValue);
+            writer.pushKV("id", jreq.id);
+            writer.endObject();
+            strReply += "\n";
 
         // array of requests
         } else if (valRequest.isArray())
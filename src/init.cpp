@@ -64,6 +64,7 @@
 
 #if ENABLE_ZMQ
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqpublishnotifier.h"
 #endif
 
 #if ENABLE_PROTON
@@ -349,9 +350,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("This help message"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-asyncflush", strprintf(_("Write the coin database cache and the block indexes in a background thread, so block validation goes on while they are flushed (default: %u)"), DEFAULT_ASYNC_FLUSH));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), 3));
+    strUsage += HelpMessageOpt("-columnarundo", strprintf(_("Write undo data in the compact columnar format, which versions before it cannot read (default: %u)"), DEFAULT_COLUMNAR_UNDO));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), "komodo.conf"));
     if (mode == HMM_BITCOIND)
     {
@@ -362,6 +365,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-rawblockcache=<n>", strprintf(_("Memory in megabytes for caching serialized blocks recently served to peers and REST clients (default: %u)"), DEFAULT_RAW_BLOCK_CACHE_MB));
+    strUsage += HelpMessageOpt("-dbtuning=<db>:<option>=<value>", _("Override a LevelDB tuning option of the chainstate, blockindex or notarisations database. "
+        "Options are blocksize, restartinterval, bloombits, compression, blockcachepct, writebufferpct, maxopenfiles and compactonopen (can be specified multiple times)"));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("[DEPRECATED FROM OVERWINTER] Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
@@ -373,6 +379,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+    strUsage += HelpMessageOpt("-pruneretain=<n>", strprintf(_("When pruning, keep the transactions needed for cross-chain proofs with their proofs, so pruned blocks can still be proven: "
+            "0 = none, 1 = notarizations, imports, exports, currency definitions and identities, 2 = all crypto-condition transactions. "
+            "Only applies to blocks connected while it is set (default: %u)"), DEFAULT_PRUNE_RETAIN));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files on startup"));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
@@ -381,6 +390,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-assetindex", strprintf(_("Maintain an index of assets CC token balances and open orders, used for token balance, order book and input selection queries. A record of every assets output ever created is kept so blocks can be disconnected, so the index grows with the number of assets outputs in the chain, spent or not (default: %u)"), DEFAULT_ASSETINDEX));
+    strUsage += HelpMessageOpt("-oracleindex", strprintf(_("Maintain an index of oracles CC data samples, used to read oracle prices without scanning the baton chains (default: %u)"), DEFAULT_ORACLEINDEX));
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
     strUsage += HelpMessageOpt("-banscore=<n>", strprintf(_("Threshold for disconnecting misbehaving peers (default: %u)"), 100));
@@ -397,6 +408,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), 5000));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 1000));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: select, epoll where available (default: %s)"), GetDefaultSocketEvents()));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
@@ -447,6 +459,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubblocktemplate=<address>", _("Enable publish block template paying to -mineraddress in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubcurrencystate=<address>", _("Enable publish fractional currency state of each block in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubinterval=<n>", strprintf(_("Minimum milliseconds between block template or currency state messages (default: %d)"), DEFAULT_ZMQ_PUB_INTERVAL));
+    strUsage += HelpMessageOpt("-zmqtemplatefeechange=<n>", strprintf(_("Percent change in block template fees that publishes a new template on the same tip (default: %d)"), DEFAULT_ZMQ_TEMPLATE_FEE_CHANGE));
 #endif
 
 #if ENABLE_PROTON
@@ -516,6 +532,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin mining if enabled (-1 = all cores, default: %d)"), 0));
     strUsage += HelpMessageOpt("-equihashsolver=<name>", _("Specify the Equihash solver to be used if enabled (default: \"default\")"));
     strUsage += HelpMessageOpt("-mineraddress=<addr>", _("Send mined coins to a specific single address"));
+    strUsage += HelpMessageOpt("-minerthreadaffinity", strprintf(_("Pin each VerusHash mining thread to a CPU, spreading threads across NUMA nodes (default: %u)"), DEFAULT_MINER_THREAD_AFFINITY));
+    strUsage += HelpMessageOpt("-blocktemplaterefresh=<n>", strprintf(_("Seconds a block template shared by mining threads is reused after the mempool changes (default: %u)"), DEFAULT_BLOCK_TEMPLATE_REFRESH));
     strUsage += HelpMessageOpt("-minetolocalwallet", strprintf(
             _("Require that mined blocks use a coinbase address in the local wallet (default: %u)"),
  #ifdef ENABLE_WALLET
@@ -951,10 +969,18 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             LogPrintf("%s: parameter interaction: -zapwallettxes=<mode> -> setting -rescan=1\n", __func__);
     }
 
+    std::string strSocketEvents = GetArg("-socketevents", GetDefaultSocketEvents());
+    if (!SetSocketEvents(strSocketEvents))
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: select%s"),
+                                   strSocketEvents, GetDefaultSocketEvents() == "epoll" ? ", epoll" : ""));
+
     // Make sure enough file descriptors are available
     int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     nMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // select() can only wait on sockets below FD_SETSIZE, epoll is only limited by the descriptor limit
+    if (!fSocketEventsEpoll)
+        nMaxConnections = std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS));
+    nMaxConnections = std::max(nMaxConnections, 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1013,6 +1039,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", true);
+    fColumnarUndo = GetBoolArg("-columnarundo", DEFAULT_COLUMNAR_UNDO);
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1038,6 +1065,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
         fPruneMode = true;
     }
+    nPruneRetain = GetArg("-pruneretain", DEFAULT_PRUNE_RETAIN);
+    if (nPruneRetain < PRUNE_RETAIN_NONE || nPruneRetain > PRUNE_RETAIN_CC) {
+        return InitError(strprintf(_("Invalid -pruneretain level %d, it must be from %d to %d."), nPruneRetain, PRUNE_RETAIN_NONE, PRUNE_RETAIN_CC));
+    }
 
     RegisterAllCoreRPCCommands(tableRPC);
 #ifdef ENABLE_WALLET
@@ -1303,10 +1334,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
     std::ostringstream strErrors;
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script, header and relayed transaction verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
+        {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadHeaderHashCheck);
+            threadGroup.create_thread(&ThreadRelayedTxPrecheck);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1581,7 +1616,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     if ( fReindex == 0 )
     {
-        bool checkval,fAddressIndex,fSpentIndex,fTimeStampIndex;
+        bool checkval,fAddressIndex,fSpentIndex,fTimeStampIndex,fAssetIndex,fOracleIndex;
         pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
 
         fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
@@ -1619,6 +1654,24 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             fprintf(stderr,"set timestampindex, will reindex. sorry will take a while.\n");
             fReindex = true;
         }
+
+        fAssetIndex = GetBoolArg("-assetindex", DEFAULT_ASSETINDEX);
+        pblocktree->ReadFlag("assetindex", checkval);
+        if ( checkval != fAssetIndex )
+        {
+            pblocktree->WriteFlag("assetindex", fAssetIndex);
+            fprintf(stderr,"set assetindex, will reindex. sorry will take a while.\n");
+            fReindex = true;
+        }
+
+        fOracleIndex = GetBoolArg("-oracleindex", DEFAULT_ORACLEINDEX);
+        pblocktree->ReadFlag("oracleindex", checkval);
+        if ( checkval != fOracleIndex )
+        {
+            pblocktree->WriteFlag("oracleindex", fOracleIndex);
+            fprintf(stderr,"set oracleindex, will reindex. sorry will take a while.\n");
+            fReindex = true;
+        }
     }
     
     bool clearWitnessCaches = false;
@@ -1640,8 +1693,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pblocktree;
                 delete pnotarisations;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles, GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH));
+                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex, GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH));
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
                 pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
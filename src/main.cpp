@@ -46,6 +46,8 @@
 #include <algorithm>
 #include <atomic>
 #include <sstream>
+#include <deque>
+#include <list>
 #include <map>
 #include <unordered_map>
 #include <vector>
@@ -90,12 +92,16 @@ bool fTxIndex = false;
 bool fInsightExplorer = false;       // this ensures that the primary address and spent indexes are active, enabling advanced CCs
 bool fAddressIndex = false;
 bool fSpentIndex = false;
+bool fAssetIndex = false;
+bool fOracleIndex = false;
 bool fTimestampIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = true;
+bool fColumnarUndo = DEFAULT_COLUMNAR_UNDO;
+int nPruneRetain = DEFAULT_PRUNE_RETAIN;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
@@ -119,6 +125,161 @@ map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(cs_main);;
 map<uint256, set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);;
 void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** A transaction relayed by a peer, with the coins it spends as of when it arrived, waiting to be accepted */
+struct CQueuedRelayedTx {
+    CTransaction tx;
+    int nHeight;
+    std::map<uint256, CCoins> inputs;
+    bool fChecked;
+    bool fPrecheckPassed;
+    CValidationState state;
+
+    CQueuedRelayedTx() : nHeight(0), fChecked(false), fPrecheckPassed(false) {}
+};
+static const size_t MAX_PEER_TX_QUEUE = 100;
+
+/**
+ * Transactions relayed by each peer, in the order they arrived. The script verification threads precheck them
+ * without cs_main, taking one transaction from each peer with work in turn, so a peer relaying many slow
+ * transactions cannot delay the others. The message handler accepts the prechecked transactions at the front of
+ * a peer's queue under one hold of cs_main, and holds back any other message from the peer until its queue is
+ * empty, so messages are still handled in the order they arrive.
+ */
+class CRelayedTxQueue
+{
+    struct CPeerTxQueue {
+        std::deque<std::shared_ptr<CQueuedRelayedTx> > vQueued;
+        std::deque<std::shared_ptr<CQueuedRelayedTx> > vUnchecked;
+    };
+
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+    std::map<NodeId, CPeerTxQueue> mapQueues;
+    // peers with transactions waiting for a worker, served round robin
+    std::list<NodeId> peerRotation;
+    size_t nQueued;
+    size_t nUnchecked;
+
+public:
+    CRelayedTxQueue() : nQueued(0), nUnchecked(0) {}
+
+    // queues a transaction, to be prechecked by a worker if fCheck, and returns the peer's queue size
+    size_t Push(NodeId peer, const std::shared_ptr<CQueuedRelayedTx> &pqueued, bool fCheck)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        CPeerTxQueue &queue = mapQueues[peer];
+        queue.vQueued.push_back(pqueued);
+        nQueued++;
+        if (fCheck)
+        {
+            queue.vUnchecked.push_back(pqueued);
+            nUnchecked++;
+            if (queue.vUnchecked.size() == 1)
+                peerRotation.push_back(peer);
+            condWorker.notify_one();
+        }
+        return queue.vQueued.size();
+    }
+
+    // moves the prechecked transactions at the front of the peer's queue to vChecked, returns true if none are left
+    bool TakeChecked(NodeId peer, std::vector<std::shared_ptr<CQueuedRelayedTx> > &vChecked)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::map<NodeId, CPeerTxQueue>::iterator it = mapQueues.find(peer);
+        if (it == mapQueues.end())
+            return true;
+        std::deque<std::shared_ptr<CQueuedRelayedTx> > &vQueued = it->second.vQueued;
+        while (!vQueued.empty() && vQueued.front()->fChecked)
+        {
+            vChecked.push_back(vQueued.front());
+            vQueued.pop_front();
+            nQueued--;
+        }
+        if (!vQueued.empty())
+            return false;
+        mapQueues.erase(it);
+        return true;
+    }
+
+    bool Contains(NodeId peer, const uint256 &hash)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::map<NodeId, CPeerTxQueue>::iterator it = mapQueues.find(peer);
+        if (it == mapQueues.end())
+            return false;
+        BOOST_FOREACH(const std::shared_ptr<CQueuedRelayedTx> &pqueued, it->second.vQueued)
+        {
+            if (pqueued->tx.GetHash() == hash)
+                return true;
+        }
+        return false;
+    }
+
+    size_t Size(NodeId peer)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::map<NodeId, CPeerTxQueue>::iterator it = mapQueues.find(peer);
+        return it == mapQueues.end() ? 0 : it->second.vQueued.size();
+    }
+
+    // drops the peer's queue, a transaction being prechecked is finished and then freed
+    void Erase(NodeId peer)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::map<NodeId, CPeerTxQueue>::iterator it = mapQueues.find(peer);
+        if (it == mapQueues.end())
+            return;
+        nQueued -= it->second.vQueued.size();
+        nUnchecked -= it->second.vUnchecked.size();
+        peerRotation.remove(peer);
+        mapQueues.erase(it);
+    }
+
+    void GetDepth(size_t &queued, size_t &unchecked, size_t &peers)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        queued = nQueued;
+        unchecked = nUnchecked;
+        peers = mapQueues.size();
+    }
+
+    // worker thread loop, runs until interrupted
+    void Thread()
+    {
+        while (true)
+        {
+            std::shared_ptr<CQueuedRelayedTx> pqueued;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (peerRotation.empty())
+                    condWorker.wait(lock);
+                NodeId peer = peerRotation.front();
+                peerRotation.pop_front();
+                CPeerTxQueue &queue = mapQueues[peer];
+                pqueued = queue.vUnchecked.front();
+                queue.vUnchecked.pop_front();
+                if (!queue.vUnchecked.empty())
+                    peerRotation.push_back(peer);
+            }
+            bool fPassed = PrecheckRelayedTransaction(pqueued->tx, pqueued->state, pqueued->nHeight, pqueued->inputs);
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                pqueued->fPrecheckPassed = fPassed;
+                pqueued->fChecked = true;
+                nUnchecked--;
+            }
+            WakeMessageHandler();
+        }
+    }
+};
+
+static CRelayedTxQueue relayedTxQueue;
+
+void ThreadRelayedTxPrecheck() {
+    RenameThread("zcash-txprecheck");
+    relayedTxQueue.Thread();
+}
+
 /**
  * Returns true if there are nRequired or more blocks of minVersion or above
  * in the last Consensus::Params::nMajorityWindow blocks, starting at pstart and going backwards.
@@ -359,6 +520,7 @@ namespace {
         BOOST_FOREACH(const QueuedBlock& entry, state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
         EraseOrphansFor(nodeid);
+        relayedTxQueue.Erase(nodeid);
         nPreferredDownload -= state->fPreferredDownload;
         
         mapNodeState.erase(nodeid);
@@ -1142,6 +1304,105 @@ bool ContextualCheckCoinbaseTransaction(const CTransaction &tx, uint32_t nHeight
     return valid;
 }
 
+/** Check the joinsplit signature and Sapling proofs and signatures of a transaction for the branch at nHeight. */
+bool ContextualCheckShieldedProofs(
+        const CTransaction& tx,
+        CValidationState &state,
+        const CChainParams& chainparams,
+        const int nHeight,
+        bool (*isInitBlockDownload)(const CChainParams&))
+{
+    uint256 dataToBeSigned;
+
+    if (!tx.IsMint() &&
+        (!tx.vJoinSplit.empty() ||
+         !tx.vShieldedSpend.empty() ||
+         !tx.vShieldedOutput.empty()))
+    {
+        auto consensusBranchId = CurrentEpochBranchId(nHeight, chainparams.GetConsensus());
+        // Empty output script.
+        CScript scriptCode;
+        try {
+            dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId);
+        } catch (std::logic_error ex) {
+            return state.DoS(100, error("CheckTransaction(): error computing signature hash"),
+                             REJECT_INVALID, "error-computing-signature-hash");
+        }
+        
+    }
+
+    if (!(tx.IsMint() || tx.vJoinSplit.empty()))
+    {
+        BOOST_STATIC_ASSERT(crypto_sign_PUBLICKEYBYTES == 32);
+        
+        // We rely on libsodium to check that the signature is canonical.
+        // https://github.com/jedisct1/libsodium/commit/62911edb7ff2275cccd74bf1c8aefcc4d76924e0
+        if (crypto_sign_verify_detached(&tx.joinSplitSig[0],
+                                        dataToBeSigned.begin(), 32,
+                                        tx.joinSplitPubKey.begin()
+                                        ) != 0) {
+            return state.DoS(isInitBlockDownload(chainparams) ? 0 : 100,
+                                error("CheckTransaction(): invalid joinsplit signature"),
+                                REJECT_INVALID, "bad-txns-invalid-joinsplit-signature");
+        }
+    }
+
+    if (!tx.vShieldedSpend.empty() ||
+        !tx.vShieldedOutput.empty())
+    {
+        auto ctx = librustzcash_sapling_verification_ctx_init();
+
+        for (const SpendDescription &spend : tx.vShieldedSpend) {
+            if (!librustzcash_sapling_check_spend(
+                ctx,
+                spend.cv.begin(),
+                spend.anchor.begin(),
+                spend.nullifier.begin(),
+                spend.rk.begin(),
+                spend.zkproof.begin(),
+                spend.spendAuthSig.begin(),
+                dataToBeSigned.begin()
+            ))
+            {
+                librustzcash_sapling_verification_ctx_free(ctx);
+                return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
+                                      REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
+            }
+        }
+
+        for (const OutputDescription &output : tx.vShieldedOutput) {
+            if (!librustzcash_sapling_check_output(
+                ctx,
+                output.cv.begin(),
+                output.cm.begin(),
+                output.ephemeralKey.begin(),
+                output.zkproof.begin()
+            ))
+            {
+                librustzcash_sapling_verification_ctx_free(ctx);
+                return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
+                                      REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+            }
+        }
+
+        if (!librustzcash_sapling_final_check(
+            ctx,
+            tx.valueBalance,
+            tx.bindingSig.begin(),
+            dataToBeSigned.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
+                                  REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+        }
+
+        librustzcash_sapling_verification_ctx_free(ctx);
+    }
+
+    return true;
+}
+
 /**
  * Check a transaction contextually against a set of consensus rules valid at a given block height.
  *
@@ -1157,7 +1418,8 @@ bool ContextualCheckTransaction(
         const CChainParams& chainparams,
         const int nHeight,
         const int dosLevel,
-        bool (*isInitBlockDownload)(const CChainParams&))
+        bool (*isInitBlockDownload)(const CChainParams&),
+        bool fCheckProofs)
 {
     bool overwinterActive = chainparams.GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_OVERWINTER);
     bool saplingActive = chainparams.GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_SAPLING);
@@ -1242,40 +1504,10 @@ bool ContextualCheckTransaction(
                             REJECT_INVALID, "bad-txns-oversize");
     }
 
-    uint256 dataToBeSigned;
-
-    if (!tx.IsMint() &&
-        (!tx.vJoinSplit.empty() ||
-         !tx.vShieldedSpend.empty() ||
-         !tx.vShieldedOutput.empty()))
-    {
-        auto consensusBranchId = CurrentEpochBranchId(nHeight, chainparams.GetConsensus());
-        // Empty output script.
-        CScript scriptCode;
-        try {
-            dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId);
-        } catch (std::logic_error ex) {
-            return state.DoS(100, error("CheckTransaction(): error computing signature hash"),
-                             REJECT_INVALID, "error-computing-signature-hash");
-        }
-        
-    }
-
-    if (!(tx.IsMint() || tx.vJoinSplit.empty()))
-    {
-        BOOST_STATIC_ASSERT(crypto_sign_PUBLICKEYBYTES == 32);
-        
-        // We rely on libsodium to check that the signature is canonical.
-        // https://github.com/jedisct1/libsodium/commit/62911edb7ff2275cccd74bf1c8aefcc4d76924e0
-        if (crypto_sign_verify_detached(&tx.joinSplitSig[0],
-                                        dataToBeSigned.begin(), 32,
-                                        tx.joinSplitPubKey.begin()
-                                        ) != 0) {
-            return state.DoS(isInitBlockDownload(chainparams) ? 0 : 100,
-                                error("CheckTransaction(): invalid joinsplit signature"),
-                                REJECT_INVALID, "bad-txns-invalid-joinsplit-signature");
-        }
-    }
+    // proofs and their signatures are skipped only for transactions already verified on mempool entry,
+    // or before it, as relayed transactions are
+    if (fCheckProofs && !ContextualCheckShieldedProofs(tx, state, chainparams, nHeight, isInitBlockDownload))
+        return false;
 
     if (tx.IsCoinBase())
     {
@@ -1284,59 +1516,6 @@ bool ContextualCheckTransaction(
                                 REJECT_INVALID, "bad-txns-invalid-script-data-for-coinbase-time-lock");
     }
 
-    if (!tx.vShieldedSpend.empty() ||
-        !tx.vShieldedOutput.empty())
-    {
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                ctx,
-                spend.cv.begin(),
-                spend.anchor.begin(),
-                spend.nullifier.begin(),
-                spend.rk.begin(),
-                spend.zkproof.begin(),
-                spend.spendAuthSig.begin(),
-                dataToBeSigned.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
-
-        for (const OutputDescription &output : tx.vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                ctx,
-                output.cv.begin(),
-                output.cm.begin(),
-                output.ephemeralKey.begin(),
-                output.zkproof.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
-        }
-
-        if (!librustzcash_sapling_final_check(
-            ctx,
-            tx.valueBalance,
-            tx.bindingSig.begin(),
-            dataToBeSigned.begin()
-        ))
-        {
-            librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
-                                  REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
-        }
-
-        librustzcash_sapling_verification_ctx_free(ctx);
-    }
-
     // precheck all crypto conditions
     bool invalid = false;
     for (int i = 0; i < tx.vout.size(); i++)
@@ -1699,6 +1878,262 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
     return nMinFee;
 }
 
+/**
+ * Transactions relayed by peers that already passed CheckTransaction, including joinsplit proof
+ * verification, and the checks of their shielded proofs and signatures for a consensus branch,
+ * before cs_main was taken. AcceptToMemoryPool consumes an entry instead of repeating those checks
+ * while holding cs_main.
+ */
+class CTxPrecheckCache
+{
+    static const size_t MAX_ENTRIES = 5000;
+
+    CCriticalSection cs;
+    std::map<uint256, uint32_t> mapChecked;
+    std::deque<uint256> checkOrder;
+
+public:
+    void Add(const uint256 &hash, uint32_t consensusBranchId)
+    {
+        LOCK(cs);
+        if (mapChecked.insert(std::make_pair(hash, consensusBranchId)).second)
+        {
+            checkOrder.push_back(hash);
+            while (checkOrder.size() > MAX_ENTRIES)
+            {
+                mapChecked.erase(checkOrder.front());
+                checkOrder.pop_front();
+            }
+        }
+    }
+
+    bool Contains(const uint256 &hash)
+    {
+        LOCK(cs);
+        return mapChecked.count(hash) != 0;
+    }
+
+    // returns the consensus branch the proofs were checked for
+    bool Consume(const uint256 &hash, uint32_t &consensusBranchId)
+    {
+        LOCK(cs);
+        // the matching entry in checkOrder is left to age out
+        auto it = mapChecked.find(hash);
+        if (it == mapChecked.end())
+        {
+            return false;
+        }
+        consensusBranchId = it->second;
+        mapChecked.erase(it);
+        return true;
+    }
+};
+
+static CTxPrecheckCache txPrecheckCache;
+static std::atomic<uint64_t> nTxPrechecked(0);
+static std::atomic<uint64_t> nTxPrecheckFailed(0);
+static std::atomic<uint64_t> nTxPrecheckMicros(0);
+static std::atomic<uint64_t> nTxRelayAccepts(0);
+static std::atomic<uint64_t> nTxRelayAcceptMicros(0);
+
+bool PrecheckRelayedTransaction(const CTransaction &tx, CValidationState &state, int nHeight, const std::map<uint256, CCoins> &inputs)
+{
+    int64_t nStart = GetTimeMicros();
+    const CChainParams &chainparams = Params();
+    auto verifier = libzcash::ProofVerifier::Strict();
+    bool fValid = CheckTransaction(tx, state, verifier) &&
+                  ContextualCheckShieldedProofs(tx, state, chainparams, nHeight);
+    if (fValid)
+    {
+        uint32_t consensusBranchId = CurrentEpochBranchId(nHeight, chainparams.GetConsensus());
+
+        // Verify the signatures of inputs that spend plain pay to pubkey (hash) outputs, which puts them in the
+        // signature cache for AcceptToMemoryPool. Other scripts may need chain state, and a failure is left for
+        // AcceptToMemoryPool to find and report with the full context.
+        PrecomputedTransactionData txdata(tx);
+        for (unsigned int i = 0; i < tx.vin.size(); i++)
+        {
+            auto it = inputs.find(tx.vin[i].prevout.hash);
+            if (it == inputs.end() || !it->second.IsAvailable(tx.vin[i].prevout.n))
+            {
+                continue;
+            }
+            txnouttype whichType;
+            std::vector<std::vector<unsigned char>> vSolutions;
+            if (!Solver(it->second.vout[tx.vin[i].prevout.n].scriptPubKey, whichType, vSolutions) ||
+                (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH))
+            {
+                continue;
+            }
+            CScriptCheck check(it->second, tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, true, consensusBranchId, &txdata);
+            check();
+        }
+        txPrecheckCache.Add(tx.GetHash(), consensusBranchId);
+    }
+    else
+    {
+        nTxPrecheckFailed++;
+    }
+    nTxPrecheckMicros += GetTimeMicros() - nStart;
+    nTxPrechecked++;
+    return fValid;
+}
+
+void GetTxRelayStats(CTxRelayStats &stats)
+{
+    stats.nPrechecked = nTxPrechecked;
+    stats.nPrecheckFailed = nTxPrecheckFailed;
+    stats.nPrecheckMicros = nTxPrecheckMicros;
+    stats.nAccepts = nTxRelayAccepts;
+    stats.nAcceptMicros = nTxRelayAcceptMicros;
+    size_t nQueued, nPending, nPeers;
+    relayedTxQueue.GetDepth(nQueued, nPending, nPeers);
+    stats.nQueued = nQueued;
+    stats.nPrecheckPending = nPending;
+    stats.nQueuedPeers = nPeers;
+}
+
+/**
+ * Transactions whose scripts, crypto-conditions and shielded proofs passed AcceptToMemoryPool, so
+ * TestBlockValidity need not run those checks again when they are put into a block template. Results
+ * of transactions that touch crypto-conditions can depend on chain state, such as identities, so they
+ * are only reused on the tip they were accepted against. Other transactions depend only on their
+ * inputs and the consensus branch, and stay valid across new blocks.
+ */
+class CTxValidationCache
+{
+    static const size_t MAX_ENTRIES = 50000;
+
+    struct CEntry
+    {
+        uint256 tipHash;
+        uint32_t consensusBranchId;
+        bool fChainIndependent;
+    };
+
+    CCriticalSection cs;
+    std::map<uint256, CEntry> mapValidated;
+    std::deque<uint256> validatedOrder;
+
+public:
+    void Add(const uint256 &hash, const uint256 &tipHash, uint32_t consensusBranchId, bool fChainIndependent)
+    {
+        LOCK(cs);
+        CEntry entry = {tipHash, consensusBranchId, fChainIndependent};
+        auto it = mapValidated.find(hash);
+        if (it != mapValidated.end())
+        {
+            it->second = entry;
+            return;
+        }
+        mapValidated.insert(std::make_pair(hash, entry));
+        validatedOrder.push_back(hash);
+        while (validatedOrder.size() > MAX_ENTRIES)
+        {
+            mapValidated.erase(validatedOrder.front());
+            validatedOrder.pop_front();
+        }
+    }
+
+    bool IsValidated(const uint256 &hash, const uint256 &tipHash, uint32_t consensusBranchId)
+    {
+        LOCK(cs);
+        auto it = mapValidated.find(hash);
+        return it != mapValidated.end() &&
+               it->second.consensusBranchId == consensusBranchId &&
+               (it->second.fChainIndependent || it->second.tipHash == tipHash);
+    }
+};
+
+static CTxValidationCache txValidationCache;
+static std::atomic<uint64_t> nTemplatesValidated(0);
+static std::atomic<uint64_t> nTemplateValidateMicros(0);
+static std::atomic<uint64_t> nTemplateTxReused(0);
+static std::atomic<uint64_t> nTemplateTxChecked(0);
+
+// true if neither the transaction nor any output it spends uses a crypto-condition
+static bool IsChainIndependentTx(const CTransaction &tx, const CCoinsViewCache &view)
+{
+    if (tx.IsCoinBase() || tx.IsCoinImport())
+    {
+        return false;
+    }
+    for (auto &output : tx.vout)
+    {
+        if (output.scriptPubKey.IsPayToCryptoCondition())
+        {
+            return false;
+        }
+    }
+    for (auto &input : tx.vin)
+    {
+        if (view.GetOutputFor(input).scriptPubKey.IsPayToCryptoCondition())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// coinbase, stake, notarization and import transactions depend on the rest of the block and are always checked
+static bool IsBlockDependentTx(const CBlock &block, size_t i, const CCoinsViewCache &view)
+{
+    const CTransaction &tx = block.vtx[i];
+    if (tx.IsCoinBase() ||
+        tx.IsCoinImport() ||
+        (i == block.vtx.size() - 1 && block.IsVerusPOSBlock()) ||
+        IsBlockBoundTransaction(tx, block.vtx[0].GetHash()))
+    {
+        return true;
+    }
+
+    auto isBlockDependentEval = [](const CScript &script) {
+        COptCCParams p;
+        if (!script.IsPayToCryptoCondition(p) || !p.IsValid())
+        {
+            return false;
+        }
+        switch (p.evalCode)
+        {
+            case EVAL_EARNEDNOTARIZATION:
+            case EVAL_ACCEPTEDNOTARIZATION:
+            case EVAL_FINALIZE_NOTARIZATION:
+            case EVAL_CURRENCYSTATE:
+            case EVAL_CROSSCHAIN_EXPORT:
+            case EVAL_CROSSCHAIN_IMPORT:
+            case EVAL_FINALIZE_EXPORT:
+            case EVAL_IMPORTPAYOUT:
+            case EVAL_IMPORTCOIN:
+                return true;
+        }
+        return false;
+    };
+
+    for (auto &output : tx.vout)
+    {
+        if (isBlockDependentEval(output.scriptPubKey))
+        {
+            return true;
+        }
+    }
+    for (auto &input : tx.vin)
+    {
+        if (isBlockDependentEval(view.GetOutputFor(input).scriptPubKey))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GetTemplateValidationStats(CTemplateValidationStats &stats)
+{
+    stats.nValidated = nTemplatesValidated;
+    stats.nValidateMicros = nTemplateValidateMicros;
+    stats.nTxReused = nTemplateTxReused;
+    stats.nTxChecked = nTemplateTxChecked;
+}
+
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                            bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel)
 {
@@ -1740,14 +2175,18 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
         //fprintf(stderr,"AcceptToMemoryPool komodo_validate_interest failure\n");
         return error("AcceptToMemoryPool: komodo_validate_interest failed");
     }
-    if (!CheckTransaction(tx, state, verifier))
+    uint32_t precheckedBranchId;
+    bool fPrechecked = txPrecheckCache.Consume(tx.GetHash(), precheckedBranchId);
+    if (!fPrechecked && !CheckTransaction(tx, state, verifier))
     {
         return error("AcceptToMemoryPool: CheckTransaction failed");
     }
 
     // DoS level set to 10 to be more forgiving.
     // Check transaction contextually against the set of consensus rules which apply in the next block to be mined.
-    if (!ContextualCheckTransaction(tx, state, chainParams, nextBlockHeight, (dosLevel == -1) ? 10 : dosLevel))
+    bool fCheckProofs = !fPrechecked || precheckedBranchId != consensusBranchId;
+    if (!ContextualCheckTransaction(tx, state, chainParams, nextBlockHeight, (dosLevel == -1) ? 10 : dosLevel,
+                                    IsInitialBlockDownload, fCheckProofs))
     {
         return error("AcceptToMemoryPool: ContextualCheckTransaction failed");
     }
@@ -1929,7 +2368,7 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
             if (!mempool.IsKnownReserveTransaction(hash, txDesc))
             {
                 // we need the current currency state
-                txDesc = CReserveTransactionDescriptor(tx, view, nextBlockHeight);
+                txDesc = CReserveTransactionDescriptor::GetCached(tx, view, nextBlockHeight);
                 // if we have a reserve transaction
                 if (!txDesc.IsValid() && txDesc.IsReject())
                 {
@@ -2073,6 +2512,12 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
         if ( flag != 0 )
             KOMODO_CONNECTING = -1;
 
+        // remember that this passed all checks for the next block, so block templates need not repeat them
+        if (!iscoinbase && chainActive.LastTip() && nextBlockHeight == chainActive.Height() + 1)
+        {
+            txValidationCache.Add(hash, chainActive.LastTip()->GetBlockHash(), consensusBranchId, IsChainIndependentTx(tx, view));
+        }
+
         // Store transaction in memory
         if ( komodo_is_notarytx(tx) == 0 )
             KOMODO_ON_DEMAND++;
@@ -2154,6 +2599,39 @@ bool GetAddressUnspent(const uint160& addressHash, int type,
     return true;
 }
 
+bool GetAssetBalanceOutputs(const uint256 &tokenid, const uint160 &addressHash, std::vector<CAssetBalanceDbEntry> &outputs)
+{
+    if (!fAssetIndex)
+        return error("asset index not enabled");
+
+    if (!pblocktree->ReadAssetBalances(tokenid, addressHash, outputs))
+        return error("unable to get asset outputs for address");
+
+    return true;
+}
+
+bool GetAssetOrders(const uint256 &tokenid, std::vector<CAssetIndexDbEntry> &orders)
+{
+    if (!fAssetIndex)
+        return error("asset index not enabled");
+
+    if (!pblocktree->ReadAssetOrders(tokenid, orders))
+        return error("unable to get asset orders");
+
+    return true;
+}
+
+bool GetOracleSamples(const uint256 &oracletxid, std::vector<COracleSampleDbEntry> &samples)
+{
+    if (!fOracleIndex)
+        return error("oracle index not enabled");
+
+    if (!pblocktree->ReadOracleSamples(oracletxid, samples))
+        return error("unable to get oracle samples");
+
+    return true;
+}
+
 /*uint64_t myGettxout(uint256 hash,int32_t n)
 {
     CCoins coins;
@@ -2256,6 +2734,18 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::P
             return true;
         }
     }
+
+    if (fPruneMode && nPruneRetain > PRUNE_RETAIN_NONE) {
+        CRetainedTransaction retained;
+        if (pblocktree->ReadRetainedTransaction(hash, retained)) {
+            BlockMap::iterator mi = mapBlockIndex.find(retained.blockHash);
+            if (mi != mapBlockIndex.end() && chainActive.Contains(mi->second)) {
+                txOut = retained.tx;
+                hashBlock = retained.blockHash;
+                return true;
+            }
+        }
+    }
     
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
         int nHeight = -1;
@@ -2291,6 +2781,97 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     return GetTransaction(hash, txOut, Params().GetConsensus(), hashBlock, fAllowSlow);
 }
 
+// true if a transaction is kept with its block proof when its block is pruned
+static bool IsRetainedTransaction(const CTransaction &tx, int retainLevel)
+{
+    for (auto &out : tx.vout)
+    {
+        COptCCParams p;
+        if (!out.scriptPubKey.IsPayToCryptoCondition(p) || !p.IsValid())
+            continue;
+        if (retainLevel >= PRUNE_RETAIN_CC)
+            return true;
+        switch (p.evalCode)
+        {
+            case EVAL_CURRENCY_DEFINITION:
+            case EVAL_EARNEDNOTARIZATION:
+            case EVAL_ACCEPTEDNOTARIZATION:
+            case EVAL_FINALIZE_NOTARIZATION:
+            case EVAL_CROSSCHAIN_EXPORT:
+            case EVAL_CROSSCHAIN_IMPORT:
+            case EVAL_FINALIZE_EXPORT:
+            case EVAL_IDENTITY_PRIMARY:
+            case EVAL_IDENTITY_REVOKE:
+            case EVAL_IDENTITY_RECOVER:
+            case EVAL_IDENTITY_RESERVATION:
+                return true;
+        }
+    }
+    return false;
+}
+
+bool GetRetainedTransactions(const CBlock &block, const uint256 &blockHash, int height, int retainLevel,
+                             std::vector<CRetainedTransactionDbEntry> &retainedTxs)
+{
+    std::vector<int> retainedIndexes;
+    for (int i = 0; i < (int)block.vtx.size(); i++)
+    {
+        if (IsRetainedTransaction(block.vtx[i], retainLevel))
+            retainedIndexes.push_back(i);
+    }
+    if (!retainedIndexes.size())
+        return true;
+
+    std::vector<CMMRProof> txProofs;
+    if (!block.GetTransactionProofs(retainedIndexes, txProofs))
+        return false;
+    retainedTxs.reserve(retainedTxs.size() + retainedIndexes.size());
+    for (size_t j = 0; j < retainedIndexes.size(); j++)
+    {
+        const CTransaction &tx = block.vtx[retainedIndexes[j]];
+        retainedTxs.push_back(std::make_pair(tx.GetHash(),
+                                             CRetainedTransaction(blockHash, height, retainedIndexes[j], txProofs[j], tx)));
+    }
+    return true;
+}
+
+void GetRetainedTransactionIds(const CBlock &block, std::vector<uint256> &retainedTxids)
+{
+    // the block may have been connected while pruning with a higher retain level, so include whatever could be there
+    for (auto &tx : block.vtx)
+    {
+        if (IsRetainedTransaction(tx, PRUNE_RETAIN_CC))
+            retainedTxids.push_back(tx.GetHash());
+    }
+}
+
+/** Prove parts of a transaction in an active chain block, from the block if we have it, or else from the proof retained when it was pruned */
+bool GetPartialTransactionProof(const CBlockIndex *pindex, const CTransaction &tx, int txIndex,
+                                const std::vector<std::pair<int16_t, int16_t>> &partIndexes,
+                                CPartialTransactionProof &txProof)
+{
+    if (pindex->nStatus & BLOCK_HAVE_DATA)
+    {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus(), false))
+            return error("%s: cannot read block %s", __func__, pindex->GetBlockHash().GetHex());
+        txProof = block.GetPartialTransactionProof(tx, txIndex, partIndexes);
+    }
+    else
+    {
+        CRetainedTransaction retained;
+        if (!pblocktree->ReadRetainedTransaction(tx.GetHash(), retained) ||
+            retained.blockHash != pindex->GetBlockHash() ||
+            retained.txIndex != txIndex)
+        {
+            return error("%s: block %s is pruned and transaction %s was not retained", __func__,
+                         pindex->GetBlockHash().GetHex(), tx.GetHash().GetHex());
+        }
+        txProof = CBlock::MakePartialTransactionProof(pindex->GetBlockHeader().IsPBaaS() != 0, retained.txProof, tx, partIndexes);
+    }
+    return txProof.components.size() != 0;
+}
+
 /*char *komodo_getspendscript(uint256 hash,int32_t n)
  {
  CTransaction tx; uint256 hashBlock;
@@ -2373,23 +2954,126 @@ bool ReadBlockFromDisk(int32_t height, CBlock& block, const CDiskBlockPos& pos,
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool checkPOW)
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool checkPOW)
+{
+    if ( pindex == 0 )
+        return false;
+
+    if (!ReadBlockFromDisk(pindex->GetHeight(), block, pindex->GetBlockPos(), consensusParams, checkPOW))
+        return error("ReadBlockFromDisk: Errors reading block %s", pindex->GetBlockHash().GetHex());
+
+    if (block.GetHash() != pindex->GetBlockHash())
+        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
+                     pindex->ToString(), pindex->GetBlockPos().ToString());
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    return ReadBlockFromDisk(block, pindex, consensusParams, 0);
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // the block is preceded by the message start and its size, which WriteBlockToDisk wrote
+    if (pos.nPos < MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("%s: invalid block position %s", __func__, pos.ToString());
+    CDiskBlockPos hpos = pos;
+    hpos.nPos -= MESSAGE_START_SIZE + sizeof(unsigned int);
+
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blkStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blkStart) >> nSize;
+        if (memcmp(blkStart, messageStart, MESSAGE_START_SIZE))
+            return error("%s: block magic mismatch at %s", __func__, pos.ToString());
+        if (nSize > MAX_BLOCK_SIZE)
+            return error("%s: block size %u too large at %s", __func__, nSize, pos.ToString());
+        vchBlock.resize(nSize);
+        filein.read((char *)vchBlock.data(), nSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
+/** LRU of serialized blocks that were recently served, limited by total size */
+class CRawBlockCache
 {
-    if ( pindex == 0 )
-        return false;
+    typedef std::shared_ptr<const std::vector<unsigned char> > RawBlockPtr;
+    typedef std::list<std::pair<uint256, RawBlockPtr> > RawBlockList;
 
-    if (!ReadBlockFromDisk(pindex->GetHeight(), block, pindex->GetBlockPos(), consensusParams, checkPOW))
-        return error("ReadBlockFromDisk: Errors reading block %s", pindex->GetBlockHash().GetHex());
+    CCriticalSection cs;
+    RawBlockList lruList;
+    std::unordered_map<uint256, RawBlockList::iterator, BlockHasher> blockMap;
+    size_t nCachedBytes;
 
-    if (block.GetHash() != pindex->GetBlockHash())
-        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
-                     pindex->ToString(), pindex->GetBlockPos().ToString());
-    return true;
-}
+public:
+    CRawBlockCache() : nCachedBytes(0) {}
 
-bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+    RawBlockPtr Get(const uint256 &hash)
+    {
+        LOCK(cs);
+        auto it = blockMap.find(hash);
+        if (it == blockMap.end())
+            return RawBlockPtr();
+        lruList.splice(lruList.begin(), lruList, it->second);
+        return it->second->second;
+    }
+
+    void Put(const uint256 &hash, const RawBlockPtr &pblock, size_t nMaxBytes)
+    {
+        LOCK(cs);
+        if (pblock->size() > nMaxBytes || blockMap.count(hash))
+            return;
+        lruList.push_front(std::make_pair(hash, pblock));
+        blockMap[hash] = lruList.begin();
+        nCachedBytes += pblock->size();
+        while (nCachedBytes > nMaxBytes)
+        {
+            nCachedBytes -= lruList.back().second->size();
+            blockMap.erase(lruList.back().first);
+            lruList.pop_back();
+        }
+    }
+};
+
+static CRawBlockCache rawBlockCache;
+
+std::shared_ptr<const std::vector<unsigned char> > GetRawBlock(const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
 {
-    return ReadBlockFromDisk(block, pindex, consensusParams, 0);
+    std::shared_ptr<const std::vector<unsigned char> > pRawBlock = rawBlockCache.Get(pindex->GetBlockHash());
+    if (pRawBlock)
+        return pRawBlock;
+
+    std::shared_ptr<std::vector<unsigned char> > pNewBlock = std::make_shared<std::vector<unsigned char> >();
+    if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !ReadRawBlockFromDisk(*pNewBlock, pindex->GetBlockPos(), messageStart))
+        return std::shared_ptr<const std::vector<unsigned char> >();
+
+    // the data is only served and cached if it is the block we expect, as ReadBlockFromDisk checks
+    CBlockHeader header;
+    try {
+        CDataStream ssHeader(*pNewBlock, SER_DISK, CLIENT_VERSION);
+        ssHeader >> header;
+    }
+    catch (const std::exception& e) {
+        error("%s: Deserialize error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+        return std::shared_ptr<const std::vector<unsigned char> >();
+    }
+    if (header.GetHash() != pindex->GetBlockHash())
+    {
+        error("%s: GetHash() doesn't match index for %s at %s", __func__, pindex->ToString(), pindex->GetBlockPos().ToString());
+        return std::shared_ptr<const std::vector<unsigned char> >();
+    }
+
+    static const size_t nMaxCacheBytes = (size_t)GetArg("-rawblockcache", DEFAULT_RAW_BLOCK_CACHE_MB) << 20;
+    rawBlockCache.Put(pindex->GetBlockHash(), pNewBlock, nMaxCacheBytes);
+    return pNewBlock;
 }
 
 //uint64_t komodo_moneysupply(int32_t height);
@@ -2753,7 +3437,7 @@ namespace Consensus {
         int32_t outNum;
         CCrossChainImport cci(tx, &outNum);
 
-        CReserveTransactionDescriptor rtxd(tx, inputs, nSpendHeight);
+        CReserveTransactionDescriptor rtxd = CReserveTransactionDescriptor::GetCached(tx, inputs, nSpendHeight);
 
         if (cci.IsValid())
         {
@@ -3081,36 +3765,65 @@ namespace {
 /**
  * Apply the undo operation of a CTxInUndo to the given chain state.
  * @param undo The undo object.
- * @param view The coins view to which to apply the changes.
+ * @param coins The coins of the transaction that the tx input spends.
  * @param out The out point that corresponds to the tx input.
  * @return True on success.
  */
-static bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const COutPoint& out)
+static bool ApplyTxInUndo(const CTxInUndo& undo, CCoins& coins, const COutPoint& out)
 {
     bool fClean = true;
     
-    CCoinsModifier coins = view.ModifyCoins(out.hash);
     if (undo.nHeight != 0) {
         // undo data contains height: this is the last output of the prevout tx being spent
-        if (!coins->IsPruned())
+        if (!coins.IsPruned())
             fClean = fClean && error("%s: undo data overwriting existing transaction", __func__);
-        coins->Clear();
-        coins->fCoinBase = undo.fCoinBase;
-        coins->nHeight = undo.nHeight;
-        coins->nVersion = undo.nVersion;
+        coins.Clear();
+        coins.fCoinBase = undo.fCoinBase;
+        coins.nHeight = undo.nHeight;
+        coins.nVersion = undo.nVersion;
     } else {
-        if (coins->IsPruned())
+        if (coins.IsPruned())
             fClean = fClean && error("%s: undo data adding output to missing transaction", __func__);
     }
-    if (coins->IsAvailable(out.n))
+    if (coins.IsAvailable(out.n))
         fClean = fClean && error("%s: undo data overwriting existing output", __func__);
-    if (coins->vout.size() < out.n+1)
-        coins->vout.resize(out.n+1);
-    coins->vout[out.n] = undo.txout;
+    if (coins.vout.size() < out.n+1)
+        coins.vout.resize(out.n+1);
+    coins.vout[out.n] = undo.txout;
     
     return fClean;
 }
 
+/**
+ * Restore all inputs of a transaction from its undo data. The inputs that spend the same
+ * transaction are restored together, with a single lookup and modification of its coins,
+ * latest spend first.
+ * @return True on success.
+ */
+bool ApplyTxUndo(const CTxUndo& txundo, const CTransaction& tx, CCoinsViewCache& view)
+{
+    bool fClean = true;
+
+    std::vector<unsigned int> vInputs(tx.vin.size());
+    for (unsigned int j = 0; j < vInputs.size(); j++)
+        vInputs[j] = j;
+    std::sort(vInputs.begin(), vInputs.end(), [&tx](unsigned int a, unsigned int b) {
+        const uint256 &hashA = tx.vin[a].prevout.hash, &hashB = tx.vin[b].prevout.hash;
+        return hashA < hashB || (hashA == hashB && a > b);
+    });
+
+    for (size_t k = 0; k < vInputs.size();) {
+        const uint256 &hash = tx.vin[vInputs[k]].prevout.hash;
+        CCoinsModifier coins = view.ModifyCoins(hash);
+        for (; k < vInputs.size() && tx.vin[vInputs[k]].prevout.hash == hash; k++) {
+            unsigned int j = vInputs[k];
+            if (!ApplyTxInUndo(txundo.vprevout[j], *coins, tx.vin[j].prevout))
+                fClean = false;
+        }
+    }
+    return fClean;
+}
+
 
 void ConnectNotarisations(const CBlock &block, int height)
 {
@@ -3148,6 +3861,25 @@ enum DisconnectResult
     DISCONNECT_FAILED   // Something else went wrong.
 };
 
+// adds the asset index entry of an output being spent, which may have been created earlier in the same block
+static void AddAssetIndexSpend(const COutPoint &prevout, const std::vector<CAssetIndexDbEntry> &blockOutputs,
+                               std::vector<CAssetIndexDbEntry> &assetSpends)
+{
+    for (auto &output : blockOutputs)
+    {
+        if (output.first == prevout)
+        {
+            assetSpends.push_back(output);
+            return;
+        }
+    }
+    CAssetOutputValue value;
+    if (pblocktree->ReadAssetOutput(prevout, value))
+    {
+        assetSpends.push_back(make_pair(prevout, value));
+    }
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state.
  *  The addressIndex and spentIndex will be updated if requested.
@@ -3178,12 +3910,28 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     std::vector<CAddressIndexDbEntry> addressIndex;
     std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
     std::vector<CSpentIndexDbEntry> spentIndex;
+    std::vector<CAssetIndexDbEntry> assetOutputs;
+    std::vector<CAssetIndexDbEntry> assetSpends;
+    std::vector<COracleSampleDbEntry> oracleSamples;
+    std::vector<uint256> retainedTxids;
+
+    if (fPruneMode && updateIndices) {
+        GetRetainedTransactionIds(block, retainedTxids);
+    }
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = block.vtx[i];
         uint256 const hash = tx.GetHash();
 
+        if (fAssetIndex && updateIndices) {
+            GetAssetIndexOutputs(tx, assetOutputs);
+        }
+
+        if (fOracleIndex && updateIndices) {
+            GetOracleIndexSamples(tx, pindex->GetHeight(), i, oracleSamples);
+        }
+
         if (fAddressIndex && updateIndices) {
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
 
@@ -3268,15 +4016,15 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                 error("DisconnectBlock(): transaction and undo data inconsistent");
                 return DISCONNECT_FAILED;
             }
+            if (!ApplyTxUndo(txundo, tx, view))
+                fClean = false;
+
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
-                const COutPoint &out = tx.vin[j].prevout;
                 const CTxInUndo &undo = txundo.vprevout[j];
-                if (!ApplyTxInUndo(undo, view, out))
-                    fClean = false;
-
                 const CTxIn input = tx.vin[j];
                 if (fAddressIndex && updateIndices) {
-                    const CTxOut &prevout = view.GetOutputFor(input);
+                    // the output restored from the undo data
+                    const CTxOut &prevout = undo.txout;
 
                     COptCCParams p;
                     if (prevout.scriptPubKey.IsPayToCryptoCondition(p))
@@ -3334,6 +4082,10 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                         CSpentIndexKey(input.prevout.hash, input.prevout.n),
                         CSpentIndexValue()));
                 }
+
+                if (fAssetIndex && updateIndices && undo.txout.scriptPubKey.IsPayToCryptoCondition()) {
+                    AddAssetIndexSpend(input.prevout, assetOutputs, assetSpends);
+                }
             }
         }
         else if (tx.IsCoinImport())
@@ -3360,22 +4112,22 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
     // insightexplorer
-    if (fAddressIndex && updateIndices) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode(state, "Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode(state, "Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-    // insightexplorer
-    if (fSpentIndex && updateIndices) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            AbortNode(state, "Failed to write transaction index");
+    if ((fAddressIndex || fSpentIndex || fAssetIndex || fOracleIndex || retainedTxids.size()) && updateIndices) {
+        static const std::vector<CAddressIndexDbEntry> noAddressIndex;
+        static const std::vector<CAddressUnspentDbEntry> noAddressUnspentIndex;
+        static const std::vector<CSpentIndexDbEntry> noSpentIndex;
+        if (!pblocktree->EraseBlockIndexes(fAddressIndex ? addressIndex : noAddressIndex,
+                                           fAddressIndex ? addressUnspentIndex : noAddressUnspentIndex,
+                                           fSpentIndex ? spentIndex : noSpentIndex,
+                                           assetOutputs,
+                                           assetSpends,
+                                           oracleSamples,
+                                           retainedTxids)) {
+            AbortNode(state, "Failed to update address and spent indexes");
             return DISCONNECT_FAILED;
         }
+        if (fOracleIndex)
+            OracleIndexBlockDisconnected(oracleSamples);
     }
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
@@ -3412,6 +4164,62 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+// each header hash is a full VerusHash with its own key generation, so threads take small batches
+static CCheckQueue<CHeaderHashCheck> headerhashcheckqueue(16);
+static CCriticalSection cs_headerHashCheck;
+
+void ThreadHeaderHashCheck() {
+    RenameThread("zcash-hdrcheck");
+    headerhashcheckqueue.Thread();
+}
+
+bool CHeaderHashCheck::operator()() {
+    *phash = pheader->GetHash();
+    if (expected.IsNull() || *phash == expected)
+        return true;
+    if (pFailedIndex)
+    {
+        int failed = pFailedIndex->load();
+        while ((failed < 0 || index < failed) && !pFailedIndex->compare_exchange_weak(failed, index))
+            ;
+    }
+    return false;
+}
+
+bool GetBlockHeaderHashes(const std::vector<CBlockHeader> &headers, std::vector<uint256> &hashes,
+                          const std::vector<uint256> *pExpected, int *pFailedIndex)
+{
+    hashes.resize(headers.size());
+    std::atomic<int> failedIndex(-1);
+
+    // the queue's control must have the queue to itself
+    bool fParallel = nScriptCheckThreads && headers.size() > 1;
+    LOCK(cs_headerHashCheck);
+    CCheckQueueControl<CHeaderHashCheck> control(fParallel ? &headerhashcheckqueue : NULL);
+
+    std::vector<CHeaderHashCheck> vChecks;
+    vChecks.reserve(headers.size());
+    bool fOk = true;
+    for (int i = 0; i < headers.size(); i++)
+    {
+        CHeaderHashCheck check(headers[i], hashes[i], pExpected ? (*pExpected)[i] : uint256(), i, &failedIndex);
+        if (fParallel)
+        {
+            vChecks.push_back(CHeaderHashCheck());
+            check.swap(vChecks.back());
+        }
+        else if (!check())
+        {
+            fOk = false;
+        }
+    }
+    control.Add(vChecks);
+    bool fAllOk = control.Wait() && fOk;
+    if (pFailedIndex)
+        *pFailedIndex = failedIndex.load();
+    return fAllOk;
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3590,7 +4398,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     
     // DERSIG (BIP66) is also always enforced, but does not have a flag.
     
-    CBlockUndo blockundo;
+    CBlockUndo blockundo(fColumnarUndo ? CBlockUndo::FORMAT_COLUMNAR : CBlockUndo::FORMAT_LEGACY);
     
     if ( ASSETCHAINS_CC != 0 )
     {
@@ -3614,6 +4422,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<CAddressIndexDbEntry> addressIndex;
     std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
     std::vector<CSpentIndexDbEntry> spentIndex;
+    std::vector<CAssetIndexDbEntry> assetOutputs;
+    std::vector<CAssetIndexDbEntry> assetSpends;
+    std::vector<COracleSampleDbEntry> oracleSamples;
 
     // Construct the incremental merkle tree at the current
     // block position,
@@ -3766,6 +4577,27 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 return state.DoS(100, error("ConnectBlock(): too many sigops"),
                                  REJECT_INVALID, "bad-blk-sigops");
         }
+
+        if (fAssetIndex && !fJustCheck)
+        {
+            if (!tx.IsCoinBase() && !tx.IsCoinImport())
+            {
+                for (auto &input : tx.vin)
+                {
+                    if (view.GetOutputFor(input).scriptPubKey.IsPayToCryptoCondition())
+                    {
+                        AddAssetIndexSpend(input.prevout, assetOutputs, assetSpends);
+                    }
+                }
+            }
+            GetAssetIndexOutputs(tx, assetOutputs);
+        }
+
+        if (fOracleIndex && !fJustCheck)
+        {
+            GetOracleIndexSamples(tx, pindex->GetHeight(), i, oracleSamples);
+        }
+
         
         txdata.emplace_back(tx);
 
@@ -3787,7 +4619,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
         if (!tx.IsCoinBase())
         {
-            rtxd = CReserveTransactionDescriptor(tx, view, nHeight);
+            rtxd = CReserveTransactionDescriptor::GetCached(tx, view, nHeight);
 
             if (rtxd.IsValid() && !isVerusActive)
             {
@@ -3827,9 +4659,26 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             }
             sum += interest;
 
+            // when only checking a block template, scripts and conditions of transactions accepted to the mempool on
+            // this tip were already verified with stricter flags, so only their inputs and values are checked again
+            bool fTxScriptChecks = fExpensiveChecks;
+            if (fJustCheck && fExpensiveChecks && pindex->pprev)
+            {
+                if (!IsBlockDependentTx(block, i, view) &&
+                    txValidationCache.IsValidated(txhash, pindex->pprev->GetBlockHash(), consensusBranchId))
+                {
+                    fTxScriptChecks = false;
+                    nTemplateTxReused++;
+                }
+                else
+                {
+                    nTemplateTxChecked++;
+                }
+            }
+
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!ContextualCheckInputs(tx, state, view, nHeight, fExpensiveChecks, flags, fCacheResults, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vChecks : NULL))
+            if (!ContextualCheckInputs(tx, state, view, nHeight, fTxScriptChecks, flags, fCacheResults, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vChecks : NULL))
                 return false;
             control.Add(vChecks);
         }        
@@ -4050,80 +4899,60 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     }
 
     ConnectNotarisations(block, pindex->GetHeight());
-    
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPos))
-            return AbortNode(state, "Failed to write transaction index");
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
 
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-        }
+    // all index entries for this block are committed together in one batch
+    {
+        static const std::vector<std::pair<uint256, CDiskTxPos> > noTxIndex;
+        static const std::vector<CAddressIndexDbEntry> noAddressIndex;
+        static const std::vector<CAddressUnspentDbEntry> noAddressUnspentIndex;
+        static const std::vector<CSpentIndexDbEntry> noSpentIndex;
 
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
+        CTimestampIndexKey timestampIndex;
+        CTimestampBlockIndexKey timestampBlockKey;
+        CTimestampBlockIndexValue timestampBlockValue;
 
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
-    }
+        // START insightexplorer
+        if (fTimestampIndex) {
+            unsigned int logicalTS = pindex->nTime;
+            unsigned int prevLogicalTS = 0;
 
-    // START insightexplorer
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-    if (fSpentIndex) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            return AbortNode(state, "Failed to write spent index");
-        }
-    }
-    if (fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
+            // retrieve logical timestamp of the previous block
+            if (pindex->pprev)
+                if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
+                    LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
 
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+            if (logicalTS <= prevLogicalTS) {
+                logicalTS = prevLogicalTS + 1;
+                LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+            }
 
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+            timestampIndex = CTimestampIndexKey(logicalTS, pindex->GetBlockHash());
+            timestampBlockKey = CTimestampBlockIndexKey(pindex->GetBlockHash());
+            timestampBlockValue = CTimestampBlockIndexValue(logicalTS);
         }
+        // END insightexplorer
 
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
+        // keep proofs of the transactions we need to go on proving once this block is pruned
+        std::vector<CRetainedTransactionDbEntry> retainedTxs;
+        if (fPruneMode && nPruneRetain > PRUNE_RETAIN_NONE &&
+            !GetRetainedTransactions(block, pindex->GetBlockHash(), pindex->GetHeight(), nPruneRetain, retainedTxs))
+            return AbortNode(state, "Failed to prove retained transactions");
 
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
+        if (!pblocktree->WriteBlockIndexes(fTxIndex ? vPos : noTxIndex,
+                                           fAddressIndex ? addressIndex : noAddressIndex,
+                                           fAddressIndex ? addressUnspentIndex : noAddressUnspentIndex,
+                                           fSpentIndex ? spentIndex : noSpentIndex,
+                                           assetOutputs,
+                                           assetSpends,
+                                           oracleSamples,
+                                           retainedTxs,
+                                           fTimestampIndex ? &timestampIndex : NULL,
+                                           fTimestampIndex ? &timestampBlockKey : NULL,
+                                           fTimestampIndex ? &timestampBlockValue : NULL))
+            return AbortNode(state, "Failed to write block indexes");
+        if (fOracleIndex)
+            OracleIndexBlockConnected(oracleSamples);
     }
-    // END insightexplorer
 
     if (CConstVerusSolutionVector::GetVersionByHeight(pindex->GetHeight() + 1) >= CActivationHeight::ACTIVATE_IDENTITY)
     {
@@ -4193,7 +5022,8 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (nLastSetChain == 0) {
             nLastSetChain = nNow;
         }
-        size_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // a coin database write still in progress holds on to the memory of the cache it was flushed from
+        size_t cacheSize = pcoinsTip->DynamicMemoryUsage() + pcoinsTip->PendingWriteUsage();
         // The cache is large and close to the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize * (10.0/9) > nCoinCacheUsage;
         // The cache is over the limit, we have to write now.
@@ -4211,6 +5041,10 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 return state.Error("out of disk space");
             // First make sure all block and undo data is flushed to disk.
             FlushBlockFile();
+            // Hand the index entries gathered since the last write to the block index database, which may write
+            // them in the background while the block index is written.
+            if (!pblocktree->FlushIndexes())
+                return AbortNode(state, "Failed to write to block index database");
             // Then update all block file information (which may refer to block and undo files).
             {
                 std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
@@ -4220,18 +5054,22 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                     setDirtyFileInfo.erase(it++);
                 }
                 std::vector<const CBlockIndex*> vBlocks;
+                std::vector<CBlockIndex*> vWritten;
                 vBlocks.reserve(setDirtyBlockIndex.size());
+                vWritten.reserve(setDirtyBlockIndex.size());
                 for (set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
                     vBlocks.push_back(*it);
+                    vWritten.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
+                // now that these entries are on disk, their solutions no longer need to be held in memory
+                for (auto pindex : vWritten) {
+                    pindex->TrimSolution();
+                }
             }
-            // Finally remove any pruned files
-            if (fFlushForPrune)
-                UnlinkPrunedFiles(setFilesToPrune);
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -4243,11 +5081,23 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
-            // Flush the chainstate (which may refer to block index entries).
+            // Flush the chainstate (which may refer to block index entries). The coin database may write it
+            // in the background, in which case we only wait for it when shutting down or before pruning, as
+            // the chainstate on disk must not need blocks from the files we delete.
+            int64_t nFlushStart = GetTimeMicros();
+            // The indexes of the blocks in the chainstate are on disk before the chainstate that names them.
+            if (!pblocktree->SyncIndexes())
+                return AbortNode(state, "Failed to write to block index database");
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            if ((mode == FLUSH_STATE_ALWAYS || fFlushForPrune) && !pcoinsTip->SyncWrites())
+                return AbortNode(state, "Failed to write to coin database");
+            LogPrint("bench", "    - Coins flush: %.2fms\n", 0.001 * (GetTimeMicros() - nFlushStart));
             nLastFlush = nNow;
         }
+        // Finally remove any pruned files
+        if (fFlushForPrune)
+            UnlinkPrunedFiles(setFilesToPrune);
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
             // Update best block in wallet (so we can detect restored wallets).
             GetMainSignals().SetBestChain(chainActive.GetLocator());
@@ -4273,6 +5123,10 @@ void PruneAndFlush() {
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     chainActive.SetTip(pindexNew);
+
+    // descriptors may depend on currency definitions and activation as of the old tip. this runs after the block
+    // being connected has reused the descriptors built for it in the mempool
+    CReserveTransactionDescriptor::ClearCache();
     
     // New best block
     nTimeBestReceived = GetTime();
@@ -4344,6 +5198,9 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
         }
     }
 
+    // descriptors may depend on currency definitions in the block being disconnected
+    CReserveTransactionDescriptor::ClearCache();
+
     // Apply the block atomically to the chain state.
     uint256 sproutAnchorBeforeDisconnect = pcoinsTip->GetBestAnchor(SPROUT);
     uint256 saplingAnchorBeforeDisconnect = pcoinsTip->GetBestAnchor(SAPLING);
@@ -4907,10 +5764,10 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex) {
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256 *pHash=NULL)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = pHash ? *pHash : block.GetHash();
     //printf("Hash of new index entry: %s\n\n", hash.GetHex().c_str());
 
     BlockMap::iterator it = mapBlockIndex.find(hash);
@@ -5442,10 +6299,10 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
 
 bool ContextualCheckBlockHeader(
     const CBlockHeader& block, CValidationState& state,
-    const CChainParams& chainParams, CBlockIndex * const pindexPrev)
+    const CChainParams& chainParams, CBlockIndex * const pindexPrev, const uint256 *pHash)
 {
     const Consensus::Params& consensusParams = chainParams.GetConsensus();
-    uint256 hash = block.GetHash();
+    uint256 hash = pHash ? *pHash : block.GetHash();
     if (hash == consensusParams.hashGenesisBlock)
         return true;
     
@@ -5524,11 +6381,12 @@ bool ContextualCheckBlockHeader(
 
 bool ContextualCheckBlock(
     const CBlock& block, CValidationState& state,
-    const CChainParams& chainparams, CBlockIndex * const pindexPrev)
+    const CChainParams& chainparams, CBlockIndex * const pindexPrev, bool fReuseMempoolChecks)
 {
     const int nHeight = pindexPrev == NULL ? 0 : pindexPrev->GetHeight() + 1;
     const Consensus::Params& consensusParams = chainparams.GetConsensus();
     bool sapling = consensusParams.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_SAPLING);
+    uint32_t consensusBranchId = CurrentEpochBranchId(nHeight, consensusParams);
 
     if (block.nVersion != CBlockHeader::GetVersionByHeight(nHeight))
     {
@@ -5554,8 +6412,11 @@ bool ContextualCheckBlock(
     for (uint32_t i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = block.vtx[i];
         
-        // Check transaction contextually against consensus rules at block height
-        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, 10)) {
+        // Check transaction contextually against consensus rules at block height, reusing proof verification from
+        // mempool acceptance if allowed. Proofs depend only on the transaction and consensus branch.
+        bool fCheckProofs = !(fReuseMempoolChecks && i > 0 && pindexPrev &&
+                              txValidationCache.IsValidated(tx.GetHash(), pindexPrev->GetBlockHash(), consensusBranchId));
+        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, 10, IsInitialBlockDownload, fCheckProofs)) {
             return false; // Failure reason has been set in validation state object
         }
 
@@ -5616,20 +6477,20 @@ bool ContextualCheckBlock(
     return true;
 }
 
-static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL)
+static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL, const uint256 *pHash=NULL)
 {
     static uint256 zero;
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = pHash ? *pHash : block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
     if (miSelf != mapBlockIndex.end())
     {
         // Block header is already known.
         if ( (pindex = miSelf->second) == 0 )
-            miSelf->second = pindex = AddToBlockIndex(block);
+            miSelf->second = pindex = AddToBlockIndex(block, &hash);
         if (ppindex)
             *ppindex = pindex;
         if ( pindex != 0 && pindex->nStatus & BLOCK_FAILED_MASK )
@@ -5676,7 +6537,7 @@ static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, C
         if ( (pindexPrev->nStatus & BLOCK_FAILED_MASK) )
             return state.DoS(100, error("%s: prev block invalid", __func__), REJECT_INVALID, "bad-prevblk");
     }
-    if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev))
+    if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev, &hash))
     {
         //fprintf(stderr,"AcceptBlockHeader ContextualCheckBlockHeader failed\n");
         LogPrintf("AcceptBlockHeader ContextualCheckBlockHeader failed\n");
@@ -5684,7 +6545,7 @@ static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, C
     }
     if (pindex == NULL)
     {
-        if ( (pindex= AddToBlockIndex(block)) != 0 )
+        if ( (pindex= AddToBlockIndex(block, &hash)) != 0 )
         {
             miSelf = mapBlockIndex.find(hash);
             if (miSelf != mapBlockIndex.end())
@@ -5979,6 +6840,8 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     assert(pindexPrev == chainActive.Tip());
 
     bool success = false;
+    nTemplatesValidated++;
+    int64_t nStart = GetTimeMicros();
     
     CCoinsViewCache viewNew(pcoinsTip);
     CBlockIndex indexDummy(block);
@@ -5990,7 +6853,7 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     int32_t futureblock;
     if (ContextualCheckBlockHeader(block, state, chainparams, pindexPrev) &&
         CheckBlock(&futureblock,indexDummy.GetHeight(),0,block, state, chainparams, verifier, fCheckPOW, fCheckMerkleRoot) &&
-        ContextualCheckBlock(block, state, chainparams, pindexPrev) &&
+        ContextualCheckBlock(block, state, chainparams, pindexPrev, true) &&
         ConnectBlock(block, state, &indexDummy, viewNew, chainparams, true, fCheckPOW) &&
         futureblock == 0 )
     {
@@ -5999,6 +6862,7 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     assert(state.IsValid());
 
     RemoveCoinbaseFromMemPool(block);
+    nTemplateValidateMicros += GetTimeMicros() - nStart;
     return success;
 }
 
@@ -6335,6 +7199,14 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Check whether we have an asset index
+    pblocktree->ReadFlag("assetindex", fAssetIndex);
+    LogPrintf("%s: asset index %s\n", __func__, fAssetIndex ? "enabled" : "disabled");
+
+    // Check whether we have an oracle index
+    pblocktree->ReadFlag("oracleindex", fOracleIndex);
+    LogPrintf("%s: oracle index %s\n", __func__, fOracleIndex ? "enabled" : "disabled");
+
     // insightexplorer
     // Check whether block explorer features are enabled
     pblocktree->ReadFlag("insightexplorer", fInsightExplorer);
@@ -6754,6 +7626,12 @@ bool InitBlockIndex(const CChainParams& chainparams)
     
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
+
+    fAssetIndex = GetBoolArg("-assetindex", DEFAULT_ASSETINDEX);
+    pblocktree->WriteFlag("assetindex", fAssetIndex);
+
+    fOracleIndex = GetBoolArg("-oracleindex", DEFAULT_ORACLEINDEX);
+    pblocktree->WriteFlag("oracleindex", fOracleIndex);
     fprintf(stderr,"fAddressIndex.%d/%d fSpentIndex.%d/%d\n",fAddressIndex,DEFAULT_ADDRESSINDEX,fSpentIndex,DEFAULT_SPENTINDEX);
     LogPrintf("Initializing databases...\n");
     
@@ -7221,9 +8099,20 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    // full blocks are sent exactly as stored, without decoding and encoding them again
+                    std::shared_ptr<const std::vector<unsigned char> > pRawBlock;
+                    if (inv.type == MSG_BLOCK)
+                    {
+                        pRawBlock = GetRawBlock((*mi).second, Params().MessageStart());
+                    }
+
                     // Send block from disk
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams, 1))
+                    if (pRawBlock)
+                    {
+                        pfrom->PushMessage("block", CFlatData((void *)pRawBlock->data(), (void *)(pRawBlock->data() + pRawBlock->size())));
+                    }
+                    else if (!ReadBlockFromDisk(block, (*mi).second, consensusParams, 1))
                     {
                         assert(!"cannot load block from disk");
                     }
@@ -7334,6 +8223,159 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
     }
 }
 
+/** Accept a transaction relayed by pfrom to the mempool, with any orphans it completes, and relay them */
+void static ProcessRelayedTransaction(CNode* pfrom, const CTransaction &tx, bool fPrecheckPassed, CValidationState &state) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    vector<uint256> vWorkQueue;
+    vector<uint256> vEraseQueue;
+    CInv inv(MSG_TX, tx.GetHash());
+    bool fMissingInputs = false;
+    int64_t nAcceptStart = GetTimeMicros();
+
+    pfrom->setAskFor.erase(inv.hash);
+    mapAlreadyAskedFor.erase(inv);
+
+    // coinbases would be accepted to the mem pool for instant spend transactions, stop them here
+    if (fPrecheckPassed && !AlreadyHave(inv) && AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs))
+    {
+        mempool.check(pcoinsTip);
+        RelayTransaction(tx);
+        vWorkQueue.push_back(inv.hash);
+        
+        LogPrint("mempool", "AcceptToMemoryPool: peer=%d %s: accepted %s (poolsz %u)\n",
+                 pfrom->id, pfrom->cleanSubVer,
+                 tx.GetHash().ToString(),
+                 mempool.mapTx.size());
+        
+        // Recursively process any orphan transactions that depended on this one
+        set<NodeId> setMisbehaving;
+        for (unsigned int i = 0; i < vWorkQueue.size(); i++)
+        {
+            map<uint256, set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
+            if (itByPrev == mapOrphanTransactionsByPrev.end())
+                continue;
+            for (set<uint256>::iterator mi = itByPrev->second.begin();
+                 mi != itByPrev->second.end();
+                 ++mi)
+            {
+                const uint256& orphanHash = *mi;
+                const CTransaction& orphanTx = mapOrphanTransactions[orphanHash].tx;
+                NodeId fromPeer = mapOrphanTransactions[orphanHash].fromPeer;
+                bool fMissingInputs2 = false;
+                // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
+                // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
+                // anyone relaying LegitTxX banned)
+                CValidationState stateDummy;
+                
+                
+                if (setMisbehaving.count(fromPeer))
+                    continue;
+                if (AcceptToMemoryPool(mempool, stateDummy, orphanTx, true, &fMissingInputs2))
+                {
+                    LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
+                    RelayTransaction(orphanTx);
+                    vWorkQueue.push_back(orphanHash);
+                    vEraseQueue.push_back(orphanHash);
+                }
+                else if (!fMissingInputs2)
+                {
+                    int nDos = 0;
+                    if (stateDummy.IsInvalid(nDos) && nDos > 0)
+                    {
+                        // Punish peer that gave us an invalid orphan tx
+                        Misbehaving(fromPeer, nDos);
+                        setMisbehaving.insert(fromPeer);
+                        LogPrint("mempool", "   invalid orphan tx %s\n", orphanHash.ToString());
+                    }
+                    // Has inputs but not accepted to mempool
+                    // Probably non-standard or insufficient fee/priority
+                    LogPrint("mempool", "   removed orphan tx %s\n", orphanHash.ToString());
+                    vEraseQueue.push_back(orphanHash);
+                    assert(recentRejects);
+                    recentRejects->insert(orphanHash);
+                }
+                mempool.check(pcoinsTip);
+            }
+        }
+        
+        BOOST_FOREACH(uint256 hash, vEraseQueue)
+        EraseOrphanTx(hash);
+    }
+    // TODO: currently, prohibit joinsplits and shielded spends/outputs from entering mapOrphans
+    else if (fMissingInputs &&
+             tx.vJoinSplit.empty() &&
+             tx.vShieldedSpend.empty() &&
+             tx.vShieldedOutput.empty())
+    {
+        // valid stake transactions end up in the orphan tx bin
+        AddOrphanTx(tx, pfrom->GetId());
+
+        // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+        unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+        unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
+        if (nEvicted > 0)
+            LogPrint("mempool", "mapOrphan overflow, removed %u tx\n", nEvicted);
+    } else {
+        assert(recentRejects);
+        recentRejects->insert(tx.GetHash());
+        
+        if (pfrom->fWhitelisted) {
+            // Always relay transactions received from whitelisted peers, even
+            // if they were already in the mempool or rejected from it due
+            // to policy, allowing the node to function as a gateway for
+            // nodes hidden behind it.
+            //
+            // Never relay transactions that we would assign a non-zero DoS
+            // score for, as we expect peers to do the same with us in that
+            // case.
+            int nDoS = 0;
+            if (!state.IsInvalid(nDoS) || nDoS == 0) {
+                LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->id);
+                RelayTransaction(tx);
+            } else {
+                LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s (code %d))\n",
+                          tx.GetHash().ToString(), pfrom->id, state.GetRejectReason(), state.GetRejectCode());
+            }
+        }
+    }
+    int nDoS = 0;
+    if (state.IsInvalid(nDoS))
+    {
+        LogPrint("mempool", "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.GetHash().ToString(),
+                 pfrom->id, pfrom->cleanSubVer,
+                 state.GetRejectReason());
+        pfrom->PushMessage("reject", std::string("tx"), state.GetRejectCode(),
+                           state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
+        if (nDoS > 0)
+            Misbehaving(pfrom->GetId(), nDoS);
+    }
+    nTxRelayAcceptMicros += GetTimeMicros() - nAcceptStart;
+    nTxRelayAccepts++;
+}
+
+/** Accept the prechecked transactions at the front of pfrom's queue under one hold of cs_main, returns true if none are left */
+bool static AcceptQueuedTransactions(CNode* pfrom)
+{
+    vector<std::shared_ptr<CQueuedRelayedTx> > vChecked;
+    bool fEmpty = relayedTxQueue.TakeChecked(pfrom->GetId(), vChecked);
+    pfrom->nRelayedTxQueued -= vChecked.size();
+    if (vChecked.empty())
+        return fEmpty;
+
+    LOCK(cs_main);
+    BOOST_FOREACH(std::shared_ptr<CQueuedRelayedTx> &pqueued, vChecked)
+        ProcessRelayedTransaction(pfrom, pqueued->tx, pqueued->fPrecheckPassed, pqueued->state);
+    return fEmpty;
+}
+
+/** More transactions from pfrom can be queued ahead of the ones being prechecked when its next message is one */
+bool static CanQueueRelayedTx(CNode* pfrom)
+{
+    if (pfrom->vRecvMsg.empty() || !pfrom->vRecvMsg.front().complete())
+        return false;
+    return pfrom->vRecvMsg.front().hdr.GetCommand() == "tx" && pfrom->nRelayedTxQueued < MAX_PEER_TX_QUEUE;
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     const CChainParams& chainparams = Params();
@@ -7809,7 +8851,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 CBlockHeader h = pindex->GetBlockHeader();
                 //printf("size.%i, solution size.%i\n", (int)sizeof(h), (int)h.nSolution.size());
                 //printf("hash.%s prevhash.%s nonce.%s\n", h.GetHash().ToString().c_str(), h.hashPrevBlock.ToString().c_str(), h.nNonce.ToString().c_str());
-                vHeaders.push_back(pindex->GetBlockHeader());
+                vHeaders.push_back(h);
                 if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
                     break;
             }
@@ -7826,138 +8868,53 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     
     else if (strCommand == "tx")
     {
-        vector<uint256> vWorkQueue;
-        vector<uint256> vEraseQueue;
         CTransaction tx;
         vRecv >> tx;
-        
+
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
-        
-        LOCK(cs_main);
-        
-        bool fMissingInputs = false;
-        CValidationState state;
-        
-        pfrom->setAskFor.erase(inv.hash);
-        mapAlreadyAskedFor.erase(inv);
 
-        // coinbases would be accepted to the mem pool for instant spend transactions, stop them here
-        if (!AlreadyHave(inv) && AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs))
+        // Context free checks, proofs and signatures don't depend on chain state, so they are done before taking
+        // cs_main for long, to keep slow transactions from stalling everything else that needs it. Transactions
+        // we already have, rejected, prechecked or queued are not checked again.
+        bool fKnown;
+        int nHeight;
+        std::map<uint256, CCoins> inputs;
         {
-            mempool.check(pcoinsTip);
-            RelayTransaction(tx);
-            vWorkQueue.push_back(inv.hash);
-            
-            LogPrint("mempool", "AcceptToMemoryPool: peer=%d %s: accepted %s (poolsz %u)\n",
-                     pfrom->id, pfrom->cleanSubVer,
-                     tx.GetHash().ToString(),
-                     mempool.mapTx.size());
-            
-            // Recursively process any orphan transactions that depended on this one
-            set<NodeId> setMisbehaving;
-            for (unsigned int i = 0; i < vWorkQueue.size(); i++)
+            LOCK(cs_main);
+            fKnown = AlreadyHave(inv) || txPrecheckCache.Contains(inv.hash);
+            nHeight = chainActive.Height() + 1;
+            if (!fKnown)
             {
-                map<uint256, set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
-                if (itByPrev == mapOrphanTransactionsByPrev.end())
-                    continue;
-                for (set<uint256>::iterator mi = itByPrev->second.begin();
-                     mi != itByPrev->second.end();
-                     ++mi)
+                LOCK(mempool.cs);
+                CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+                for (const CTxIn &txin : tx.vin)
                 {
-                    const uint256& orphanHash = *mi;
-                    const CTransaction& orphanTx = mapOrphanTransactions[orphanHash].tx;
-                    NodeId fromPeer = mapOrphanTransactions[orphanHash].fromPeer;
-                    bool fMissingInputs2 = false;
-                    // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
-                    // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
-                    // anyone relaying LegitTxX banned)
-                    CValidationState stateDummy;
-                    
-                    
-                    if (setMisbehaving.count(fromPeer))
-                        continue;
-                    if (AcceptToMemoryPool(mempool, stateDummy, orphanTx, true, &fMissingInputs2))
-                    {
-                        LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
-                        RelayTransaction(orphanTx);
-                        vWorkQueue.push_back(orphanHash);
-                        vEraseQueue.push_back(orphanHash);
-                    }
-                    else if (!fMissingInputs2)
-                    {
-                        int nDos = 0;
-                        if (stateDummy.IsInvalid(nDos) && nDos > 0)
-                        {
-                            // Punish peer that gave us an invalid orphan tx
-                            Misbehaving(fromPeer, nDos);
-                            setMisbehaving.insert(fromPeer);
-                            LogPrint("mempool", "   invalid orphan tx %s\n", orphanHash.ToString());
-                        }
-                        // Has inputs but not accepted to mempool
-                        // Probably non-standard or insufficient fee/priority
-                        LogPrint("mempool", "   removed orphan tx %s\n", orphanHash.ToString());
-                        vEraseQueue.push_back(orphanHash);
-                        assert(recentRejects);
-                        recentRejects->insert(orphanHash);
-                    }
-                    mempool.check(pcoinsTip);
-                }
-            }
-            
-            BOOST_FOREACH(uint256 hash, vEraseQueue)
-            EraseOrphanTx(hash);
-        }
-        // TODO: currently, prohibit joinsplits and shielded spends/outputs from entering mapOrphans
-        else if (fMissingInputs &&
-                 tx.vJoinSplit.empty() &&
-                 tx.vShieldedSpend.empty() &&
-                 tx.vShieldedOutput.empty())
-        {
-            // valid stake transactions end up in the orphan tx bin
-            AddOrphanTx(tx, pfrom->GetId());
-
-            // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
-            unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-            unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
-            if (nEvicted > 0)
-                LogPrint("mempool", "mapOrphan overflow, removed %u tx\n", nEvicted);
-        } else {
-            assert(recentRejects);
-            recentRejects->insert(tx.GetHash());
-            
-            if (pfrom->fWhitelisted) {
-                // Always relay transactions received from whitelisted peers, even
-                // if they were already in the mempool or rejected from it due
-                // to policy, allowing the node to function as a gateway for
-                // nodes hidden behind it.
-                //
-                // Never relay transactions that we would assign a non-zero DoS
-                // score for, as we expect peers to do the same with us in that
-                // case.
-                int nDoS = 0;
-                if (!state.IsInvalid(nDoS) || nDoS == 0) {
-                    LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->id);
-                    RelayTransaction(tx);
-                } else {
-                    LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s (code %d))\n",
-                              tx.GetHash().ToString(), pfrom->id, state.GetRejectReason(), state.GetRejectCode());
+                    CCoins coins;
+                    if (!inputs.count(txin.prevout.hash) && viewMemPool.GetCoins(txin.prevout.hash, coins))
+                        inputs[txin.prevout.hash].swap(coins);
                 }
             }
         }
-        int nDoS = 0;
-        if (state.IsInvalid(nDoS))
+
+        if (!fKnown && relayedTxQueue.Contains(pfrom->GetId(), inv.hash))
+            fKnown = true;
+
+        // with script verification threads, the precheck runs on them while the next messages are read
+        std::shared_ptr<CQueuedRelayedTx> pqueued(new CQueuedRelayedTx());
+        pqueued->tx = tx;
+        pqueued->nHeight = nHeight;
+        pqueued->inputs.swap(inputs);
+        bool fCheck = !fKnown && nScriptCheckThreads;
+        if (!fCheck)
         {
-            LogPrint("mempool", "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.GetHash().ToString(),
-                     pfrom->id, pfrom->cleanSubVer,
-                     state.GetRejectReason());
-            pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
-                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
-            if (nDoS > 0)
-                Misbehaving(pfrom->GetId(), nDoS);
+            pqueued->fPrecheckPassed = fKnown || PrecheckRelayedTransaction(tx, pqueued->state, nHeight, pqueued->inputs);
+            pqueued->fChecked = true;
         }
+        pfrom->nRelayedTxQueued = relayedTxQueue.Push(pfrom->GetId(), pqueued, fCheck);
     }
 
+
     else if (strCommand == "headers" && !fImporting && !fReindex) // Ignore headers received while importing
     {
         std::vector<CBlockHeader> headers;
@@ -7973,7 +8930,11 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             vRecv >> headers[n];
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
-        
+
+        // hash the whole batch in parallel before taking cs_main, rather than one header at a time under it
+        std::vector<uint256> headerHashes;
+        GetBlockHeaderHashes(headers, headerHashes);
+
         LOCK(cs_main);
         
         if (nCount == 0) {
@@ -7982,7 +8943,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
         
         CBlockIndex *pindexLast = NULL;
-        BOOST_FOREACH(const CBlockHeader& header, headers) {
+        for (unsigned int n = 0; n < nCount; n++) {
+            const CBlockHeader& header = headers[n];
             /*
             auto lastIndex = mapBlockIndex.find(header.hashPrevBlock);
             auto thisIndex = mapBlockIndex.find(header.GetHash());
@@ -8039,7 +9001,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 return error("non-continuous headers sequence");
             }
             int32_t futureblock;
-            if (!AcceptBlockHeader(&futureblock, header, state, chainparams, &pindexLast)) {
+            if (!AcceptBlockHeader(&futureblock, header, state, chainparams, &pindexLast, &headerHashes[n])) {
                 int nDoS;
                 if (state.IsInvalid(nDoS) && futureblock == 0)
                 {
@@ -8153,81 +9115,16 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     
     else if (strCommand == "ping")
     {
-        if (pfrom->nVersion > BIP0031_VERSION)
-        {
-            uint64_t nonce = 0;
-            vRecv >> nonce;
-            // Echo the message back with the nonce. This allows for two useful features:
-            //
-            // 1) A remote node can quickly check if the connection is operational
-            // 2) Remote nodes can measure the latency of the network thread. If this node
-            //    is overloaded it won't respond to pings quickly and the remote node can
-            //    avoid sending us more work, like chain download requests.
-            //
-            // The nonce stops the remote getting confused between different pings: without
-            // it, if the remote node sends a ping once per second and this node takes 5
-            // seconds to respond to each, the 5th ping the remote sends would appear to
-            // return very quickly.
-            pfrom->PushMessage("pong", nonce);
-        }
+        // answered by the socket thread when nothing is queued ahead of it, see ProcessFastMessage
+        LOCK(pfrom->cs_vSend);
+        pfrom->ProcessPing(vRecv, nTimeReceived, false);
     }
     
     
     else if (strCommand == "pong")
     {
-        int64_t pingUsecEnd = nTimeReceived;
-        uint64_t nonce = 0;
-        size_t nAvail = vRecv.in_avail();
-        bool bPingFinished = false;
-        std::string sProblem;
-        
-        if (nAvail >= sizeof(nonce)) {
-            vRecv >> nonce;
-            
-            // Only process pong message if there is an outstanding ping (old ping without nonce should never pong)
-            if (pfrom->nPingNonceSent != 0) {
-                if (nonce == pfrom->nPingNonceSent) {
-                    // Matching pong received, this ping is no longer outstanding
-                    bPingFinished = true;
-                    int64_t pingUsecTime = pingUsecEnd - pfrom->nPingUsecStart;
-                    if (pingUsecTime > 0) {
-                        // Successful ping time measurement, replace previous
-                        pfrom->nPingUsecTime = pingUsecTime;
-                        pfrom->nMinPingUsecTime = std::min(pfrom->nMinPingUsecTime, pingUsecTime);
-                    } else {
-                        // This should never happen
-                        sProblem = "Timing mishap";
-                    }
-                } else {
-                    // Nonce mismatches are normal when pings are overlapping
-                    sProblem = "Nonce mismatch";
-                    if (nonce == 0) {
-                        // This is most likely a bug in another implementation somewhere; cancel this ping
-                        bPingFinished = true;
-                        sProblem = "Nonce zero";
-                    }
-                }
-            } else {
-                sProblem = "Unsolicited pong without ping";
-            }
-        } else {
-            // This is most likely a bug in another implementation somewhere; cancel this ping
-            bPingFinished = true;
-            sProblem = "Short payload";
-        }
-        
-        if (!(sProblem.empty())) {
-            LogPrint("net", "pong peer=%d %s: %s, %x expected, %x received, %u bytes\n",
-                     pfrom->id,
-                     pfrom->cleanSubVer,
-                     sProblem,
-                     pfrom->nPingNonceSent,
-                     nonce,
-                     nAvail);
-        }
-        if (bPingFinished) {
-            pfrom->nPingNonceSent = 0;
-        }
+        LOCK(pfrom->cs_vSend);
+        pfrom->ProcessPong(vRecv, nTimeReceived);
     }
     
     
@@ -8362,6 +9259,15 @@ bool ProcessMessages(CNode* pfrom)
 
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return fOk;
+
+    // relayed transactions are accepted in the order they arrived, and before anything the peer sent after them.
+    // until they are prechecked only more transactions are read from the peer, up to MAX_PEER_TX_QUEUE
+    pfrom->fMessagesHeld = false;
+    if (pfrom->nRelayedTxQueued && !CanQueueRelayedTx(pfrom))
+    {
+        pfrom->fMessagesHeld = !AcceptQueuedTransactions(pfrom);
+        if (pfrom->fMessagesHeld) return fOk;
+    }
     
     std::deque<CNetMessage>::iterator it = pfrom->vRecvMsg.begin();
     while (!pfrom->fDisconnect && it != pfrom->vRecvMsg.end()) {
@@ -8451,7 +9357,17 @@ bool ProcessMessages(CNode* pfrom)
         
         if (!fRet)
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
-        
+
+        // queued transactions that are prechecked are accepted as soon as no more can be queued behind them. The
+        // receive buffer is wiped if the connection got shut down, so nothing more is looked at then.
+        if (pfrom->fDisconnect ||
+            it == pfrom->vRecvMsg.end() ||
+            !it->complete() ||
+            it->hdr.GetCommand() != "tx" ||
+            pfrom->nRelayedTxQueued >= MAX_PEER_TX_QUEUE ||
+            pfrom->nSendSize >= SendBufferSize())
+            AcceptQueuedTransactions(pfrom);
+
         break;
     }
     
@@ -34,8 +34,10 @@
 #include "timestampindex.h"
 
 #include <algorithm>
+#include <atomic>
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -50,6 +52,7 @@ class CBloomFilter;
 class CChainParams;
 class CInv;
 class CScriptCheck;
+class CTxUndo;
 class CValidationInterface;
 class CValidationState;
 class PrecomputedTransactionData;
@@ -65,6 +68,8 @@ static const unsigned int DEFAULT_BLOCK_MIN_SIZE = 0;
 static const unsigned int DEFAULT_BLOCK_PRIORITY_SIZE = DEFAULT_BLOCK_MAX_SIZE / 2;
 /** Default for accepting alerts from the P2P network. */
 static const bool DEFAULT_ALERTS = true;
+/** Default for -columnarundo, writing new undo data in the columnar format */
+static const bool DEFAULT_COLUMNAR_UNDO = true;
 /** Minimum alert priority for enabling safe mode. */
 static const int ALERT_PRIORITY_SAFE_MODE = 4000;
 /** Maximum reorg length we will accept before we shut down and alert the user. */
@@ -118,8 +123,19 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 #define DEFAULT_SPENTINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 static const bool DEFAULT_INSIGHTEXPLORER = true;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
+static const bool DEFAULT_ASSETINDEX = false;
+static const bool DEFAULT_ORACLEINDEX = false;
+/** Levels of -pruneretain, the transactions kept with their block proofs when blocks are pruned */
+enum {
+    PRUNE_RETAIN_NONE = 0,
+    PRUNE_RETAIN_PBAAS = 1,             // notarizations, imports, exports, currency definitions and identities
+    PRUNE_RETAIN_CC = 2                 // every transaction with a crypto-condition output
+};
+static const int DEFAULT_PRUNE_RETAIN = PRUNE_RETAIN_PBAAS;
 static const unsigned int DEFAULT_DB_MAX_OPEN_FILES = 1000;
 static const bool DEFAULT_DB_COMPRESSION = true;
+/** Default for -rawblockcache, the memory in megabytes used to cache serialized blocks served to peers and REST clients */
+static const unsigned int DEFAULT_RAW_BLOCK_CACHE_MB = 16;
 
 // Sanity check the magic numbers when we change them
 BOOST_STATIC_ASSERT(DEFAULT_BLOCK_MAX_SIZE <= MAX_BLOCK_SIZE);
@@ -168,11 +184,20 @@ extern bool fSpentIndex;
 // Maintain a full timestamp index, used to query for blocks within a time range
 extern bool fTimestampIndex;
 
+// Maintain an index of unspent assets CC outputs by token and holder, and of open orders by token, side and price
+extern bool fAssetIndex;
+
+// Maintain an index of oracles CC data samples by oracle, publisher and height
+extern bool fOracleIndex;
+
 // END insightexplorer
 
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+extern bool fColumnarUndo;
+/** Which transactions are kept, with their proofs, when their blocks are pruned */
+extern int nPruneRetain;
 // TODO: remove this flag by structuring our code such that
 // it is unneeded for testing
 extern bool fCoinbaseEnforcedProtectionEnabled;
@@ -252,6 +277,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the thread that prechecks transactions relayed by peers */
+void ThreadRelayedTxPrecheck();
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(const CChainParams&), CCriticalSection& cs, const CBlockIndex *const &bestHeader);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -265,6 +292,15 @@ std::string GetWarnings(const std::string& strFor);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256 &hash, CTransaction &tx, const Consensus::Params& params, uint256 &hashBlock, bool fAllowSlow = false);
 bool GetTransaction(const uint256 &hash, CTransaction &tx, uint256 &hashBlock, bool fAllowSlow = false);
+/** Prove parts of a transaction in an active chain block, from the block or, if it was pruned, from the proof retained with -pruneretain */
+bool GetPartialTransactionProof(const CBlockIndex *pindex, const CTransaction &tx, int txIndex,
+                                const std::vector<std::pair<int16_t, int16_t>> &partIndexes,
+                                CPartialTransactionProof &txProof);
+/** The transactions of a block kept at a -pruneretain level, with their proofs in the block, as written when it is connected */
+bool GetRetainedTransactions(const CBlock &block, const uint256 &blockHash, int height, int retainLevel,
+                             std::vector<CRetainedTransactionDbEntry> &retainedTxs);
+/** The transactions of a block that may have been retained at any level, erased when it is disconnected */
+void GetRetainedTransactionIds(const CBlock &block, std::vector<uint256> &retainedTxids);
 /** Find the best known block, and make it the tip of the block chain */
 bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams, const CBlock* pblock = NULL);
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
@@ -304,6 +340,37 @@ void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
 
+/**
+ * Run the context free checks of a relayed transaction and the checks of its proofs and signatures for a block at
+ * nHeight without cs_main, remembering success for AcceptToMemoryPool. inputs are the coins it spends that were
+ * found, whose signatures are put in the signature cache.
+ */
+bool PrecheckRelayedTransaction(const CTransaction &tx, CValidationState &state, int nHeight, const std::map<uint256, CCoins> &inputs);
+
+/** Counters for relayed transaction validation, split between checks done without and with cs_main */
+struct CTxRelayStats
+{
+    uint64_t nPrechecked;
+    uint64_t nPrecheckFailed;
+    uint64_t nPrecheckMicros;
+    uint64_t nAccepts;
+    uint64_t nAcceptMicros;
+    uint64_t nQueued;
+    uint64_t nPrecheckPending;
+    uint64_t nQueuedPeers;
+};
+void GetTxRelayStats(CTxRelayStats &stats);
+
+/** Counters for TestBlockValidity, including transactions whose mempool validation was reused */
+struct CTemplateValidationStats
+{
+    uint64_t nValidated;
+    uint64_t nValidateMicros;
+    uint64_t nTxReused;
+    uint64_t nTxChecked;
+};
+void GetTemplateValidationStats(CTemplateValidationStats &stats);
+
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                         bool* pfMissingInputs, bool fRejectAbsurdFee=false, int dosLevel=-1);
@@ -366,14 +433,24 @@ bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, cons
                            const Consensus::Params& consensusParams, uint32_t consensusBranchId,
                            std::vector<CScriptCheck> *pvChecks = NULL);
 
+/** Check the joinsplit signature and Sapling proofs and signatures of a transaction, which depend only on the
+ * consensus branch at nHeight */
+bool ContextualCheckShieldedProofs(const CTransaction& tx, CValidationState &state,
+                                   const CChainParams& chainparams, int nHeight,
+                                   bool (*isInitBlockDownload)(const CChainParams&) = IsInitialBlockDownload);
+
 /** Check a transaction contextually against a set of consensus rules */
 bool ContextualCheckTransaction(const CTransaction& tx, CValidationState &state,
                                 const CChainParams& chainparams, int nHeight, int dosLevel,
-                                bool (*isInitBlockDownload)(const CChainParams&) = IsInitialBlockDownload);
+                                bool (*isInitBlockDownload)(const CChainParams&) = IsInitialBlockDownload,
+                                bool fCheckProofs = true);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
 
+/** Restore the inputs of a transaction being disconnected from its undo data */
+bool ApplyTxUndo(const CTxUndo& txundo, const CTransaction& tx, CCoinsViewCache& view);
+
 /** Transaction validation functions */
 
 /** Context-independent validity checks */
@@ -467,16 +544,66 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure computing one block header's hash, so that batches of headers can be hashed on the header check
+ * threads, each of which keeps its own VerusHash key buffers. Stores a reference to the header and the hash.
+ */
+class CHeaderHashCheck
+{
+private:
+    const CBlockHeader *pheader;
+    uint256 *phash;
+    uint256 expected;
+    int index;
+    std::atomic<int> *pFailedIndex;
+
+public:
+    CHeaderHashCheck(): pheader(0), phash(0), index(0), pFailedIndex(0) {}
+    CHeaderHashCheck(const CBlockHeader &headerIn, uint256 &hashOut, const uint256 &expectedIn=uint256(),
+                     int indexIn=0, std::atomic<int> *pFailedIndexIn=NULL) :
+        pheader(&headerIn), phash(&hashOut), expected(expectedIn), index(indexIn), pFailedIndex(pFailedIndexIn) { }
+
+    // fails only when an expected hash was given and the header does not hash to it, lowering *pFailedIndex
+    // to this check's index if it was higher or still -1
+    bool operator()();
+
+    void swap(CHeaderHashCheck &check) {
+        std::swap(pheader, check.pheader);
+        std::swap(phash, check.phash);
+        std::swap(expected, check.expected);
+        std::swap(index, check.index);
+        std::swap(pFailedIndex, check.pFailedIndex);
+    }
+};
+
+/** Run an instance of the header hash checking thread */
+void ThreadHeaderHashCheck();
+
+/**
+ * Hash a batch of block headers in parallel on the header check threads. If pExpected is not NULL, returns
+ * false when any header does not hash to its expected hash, and sets *pFailedIndex, if given, to the first
+ * such header. Once a check fails the queue skips the rest, so hashes after a failure may be left null.
+ */
+bool GetBlockHeaderHashes(const std::vector<CBlockHeader> &headers, std::vector<uint256> &hashes,
+                          const std::vector<uint256> *pExpected=NULL, int *pFailedIndex=NULL);
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(const uint160& addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
 bool GetAddressUnspent(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry>& unspentOutputs);
+bool GetAssetBalanceOutputs(const uint256 &tokenid, const uint160 &addressHash, std::vector<CAssetBalanceDbEntry> &outputs);
+bool GetAssetOrders(const uint256 &tokenid, std::vector<CAssetIndexDbEntry> &orders);
+bool GetOracleSamples(const uint256 &oracletxid, std::vector<COracleSampleDbEntry> &samples);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(int32_t height, CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool checkPOW);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool checkPOW);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the serialized bytes of a block without decoding them */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
+/** Returns the serialized block for an index entry with block data, from the raw block cache or from disk, or null on failure */
+std::shared_ptr<const std::vector<unsigned char> > GetRawBlock(const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -500,9 +627,9 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
  *  By "context", we mean only the previous block headers, but not the UTXO
  *  set; UTXO-related validity checks are done in ConnectBlock(). */
 bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state,
-                                const CChainParams& chainparams, CBlockIndex *pindexPrev);
+                                const CChainParams& chainparams, CBlockIndex *pindexPrev, const uint256 *pHash=NULL);
 bool ContextualCheckBlock(const CBlock& block, CValidationState& state,
-                          const CChainParams& chainparams, CBlockIndex *pindexPrev);
+                          const CChainParams& chainparams, CBlockIndex *pindexPrev, bool fReuseMempoolChecks=false);
 
 /**
  * Store block on disk.
@@ -16,6 +16,7 @@
 
 #include <boost/thread.hpp>
 #include <boost/thread/synchronized_value.hpp>
+#include <memory>
 #include <string>
 #ifdef _WIN32
 #include <io.h>
@@ -110,7 +111,7 @@ double PerfCounterTimer::rate(const int64_t &count)
     return AtomicTimer::rate(count);
 }
 
-void PerfCounterTimer::clear()
+bool PerfCounterTimer::clear()
 {
     std::unique_lock<std::mutex> lock(mtx);
     if (!threads)
@@ -118,7 +119,9 @@ void PerfCounterTimer::clear()
         counter = 0;
         start_time = GetTime();
         total_time = 0;
+        return true;
     }
+    return false;
 }
 
 int64_t PerfCounterTimer::operator+=(int64_t operand)
@@ -127,6 +130,79 @@ int64_t PerfCounterTimer::operator+=(int64_t operand)
     return counter += operand;
 }
 
+static std::mutex cs_miningThreads;
+static std::vector<std::unique_ptr<MiningThreadCounters>> miningThreads;
+// the thread counters are not reset with miningTimer, so the hash rate counts from their total when it was cleared
+static uint64_t nMiningHashesAtClear = 0;
+
+MiningThreadCounters *RegisterMiningThread()
+{
+    std::unique_lock<std::mutex> lock(cs_miningThreads);
+    miningThreads.emplace_back(new MiningThreadCounters());
+    return miningThreads.back().get();
+}
+
+void ClearMiningThreads()
+{
+    std::unique_lock<std::mutex> lock(cs_miningThreads);
+    miningThreads.clear();
+    nMiningHashesAtClear = 0;
+}
+
+void ClearMiningTimer()
+{
+    std::unique_lock<std::mutex> lock(cs_miningThreads);
+    if (miningTimer.clear())
+    {
+        nMiningHashesAtClear = 0;
+        for (auto &counters : miningThreads)
+        {
+            nMiningHashesAtClear += counters->hashes;
+        }
+    }
+}
+
+std::vector<MiningThreadStats> GetMiningThreadStats()
+{
+    std::unique_lock<std::mutex> lock(cs_miningThreads);
+    std::vector<MiningThreadStats> ret;
+    for (auto &counters : miningThreads)
+    {
+        MiningThreadStats stats;
+        stats.hashes = counters->hashes;
+        stats.templates = counters->templates;
+        stats.staleTemplates = counters->staleTemplates;
+        stats.templateMicros = counters->templateMicros;
+        stats.hashingMicros = counters->hashingMicros;
+        stats.keyMicros = counters->keyMicros;
+        ret.push_back(stats);
+    }
+    return ret;
+}
+
+uint64_t GetMiningThreadHashes()
+{
+    std::unique_lock<std::mutex> lock(cs_miningThreads);
+    uint64_t total = 0;
+    for (auto &counters : miningThreads)
+    {
+        total += counters->hashes;
+    }
+    return total;
+}
+
+// hashes since miningTimer was last cleared
+static uint64_t GetMiningThreadHashesSinceClear()
+{
+    std::unique_lock<std::mutex> lock(cs_miningThreads);
+    uint64_t total = 0;
+    for (auto &counters : miningThreads)
+    {
+        total += counters->hashes;
+    }
+    return total > nMiningHashesAtClear ? total - nMiningHashesAtClear : 0;
+}
+
 static boost::synchronized_value<std::list<uint256>> trackedBlocks;
 
 static boost::synchronized_value<std::list<std::string>> messageBox;
@@ -156,7 +232,7 @@ double GetLocalSolPS()
 {
     if (ASSETCHAINS_ALGO == ASSETCHAINS_VERUSHASH)
     {
-        return miningTimer.rate();
+        return miningTimer.rate((int64_t)GetMiningThreadHashesSinceClear());
     }
     else
         return miningTimer.rate(solutionTargetChecks);
@@ -8,6 +8,7 @@
 #include <atomic>
 #include <mutex>
 #include <string>
+#include <vector>
 
 struct AtomicCounter {
     std::atomic<uint64_t> value;
@@ -65,9 +66,9 @@ public:
 
     /**
      * Clears and initializes timer to enable restart of count on restart of mining.
-     * Only resets if thread count is 0.
+     * Only resets if thread count is 0, and returns true if it did.
      */
-    void clear();
+    bool clear();
 
     int64_t operator+=(int64_t operand);
 
@@ -76,6 +77,44 @@ public:
     double rate(const int64_t &count);
 };
 
+/**
+ * Counters written by one mining thread only. They are padded by a cache line on each side, so mining threads
+ * never contend for a line when they count, however new aligns them, and the totals are summed when they are read.
+ */
+struct MiningThreadCounters {
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    char padBefore[CACHE_LINE_SIZE];
+    std::atomic<uint64_t> hashes;
+    std::atomic<uint64_t> templates;            // block templates mined on
+    std::atomic<uint64_t> staleTemplates;       // templates abandoned because the tip changed
+    std::atomic<uint64_t> templateMicros;       // getting block templates
+    std::atomic<uint64_t> hashingMicros;        // in the hashing kernel, including key generation
+    std::atomic<uint64_t> keyMicros;            // generating hash keys in the kernel
+    char padAfter[CACHE_LINE_SIZE];
+
+    MiningThreadCounters() : hashes(0), templates(0), staleTemplates(0), templateMicros(0), hashingMicros(0), keyMicros(0) {}
+};
+
+/** A snapshot of one mining thread's counters */
+struct MiningThreadStats {
+    uint64_t hashes;
+    uint64_t templates;
+    uint64_t staleTemplates;
+    uint64_t templateMicros;
+    uint64_t hashingMicros;
+    uint64_t keyMicros;
+};
+
+/** Gets counters for a new mining thread, valid until ClearMiningThreads is called */
+MiningThreadCounters *RegisterMiningThread();
+/** Forget all mining thread counters, only when no mining threads are running */
+void ClearMiningThreads();
+/** Clear miningTimer, and count the hashes for GetLocalSolPS from now on if it was cleared */
+void ClearMiningTimer();
+std::vector<MiningThreadStats> GetMiningThreadStats();
+uint64_t GetMiningThreadHashes();
+
 extern AtomicCounter transactionsValidated;
 extern AtomicCounter ehSolverRuns;
 extern AtomicCounter solutionTargetChecks;
@@ -41,7 +41,9 @@
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #ifdef ENABLE_MINING
+#include <atomic>
 #include <functional>
+#include <map>
 #endif
 #include <mutex>
 
@@ -436,8 +438,38 @@ void ProcessNewImports(const uint160 &sourceChainID, const CTransaction &lastCon
     }
 }
 
+static std::atomic<uint64_t> nTemplatesBuilt(0);
+static std::atomic<uint64_t> nTemplatesShared(0);
+static std::atomic<uint64_t> nTemplateBuildMicros(0);
+static std::atomic<uint64_t> nTemplateLockMicros(0);
+
+// adds the time from construction to destruction to a counter, used to measure lock hold time across early returns
+class CScopedMicrosCounter
+{
+    std::atomic<uint64_t> &total;
+    int64_t nStart;
+
+public:
+    CScopedMicrosCounter(std::atomic<uint64_t> &counter) : total(counter), nStart(GetTimeMicros()) {}
+    ~CScopedMicrosCounter()
+    {
+        total += GetTimeMicros() - nStart;
+    }
+};
+
+void GetBlockTemplateStats(CBlockTemplateStats &stats)
+{
+    stats.nBuilt = nTemplatesBuilt;
+    stats.nShared = nTemplatesShared;
+    stats.nBuildMicros = nTemplateBuildMicros;
+    stats.nLockMicros = nTemplateLockMicros;
+}
+
 CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& _scriptPubKeyIn, int32_t gpucount, bool isStake)
 {
+    nTemplatesBuilt++;
+    CScopedMicrosCounter buildTimer(nTemplateBuildMicros);
+
     CScript scriptPubKeyIn(_scriptPubKeyIn);
 
     // instead of one scriptPubKeyIn, we take a vector of them along with relative weight. each is assigned a percentage of the block subsidy and
@@ -548,6 +580,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& _
     CBlockIndex* pindexPrev = 0;
     {
         LOCK2(cs_main, mempool.cs);
+        CScopedMicrosCounter lockTimer(nTemplateLockMicros);
         pindexPrev = chainActive.LastTip();
         const int nHeight = pindexPrev->GetHeight() + 1;
         const Consensus::Params &consensusParams = chainparams.GetConsensus();
@@ -1245,7 +1278,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& _
                     // if we might expire, refresh and check again
                     if (rtxd.IsFillOrKill())
                     {
-                        rtxd = CReserveTransactionDescriptor(tx, view, nHeight);
+                        rtxd = CReserveTransactionDescriptor::GetCached(tx, view, nHeight);
                         mempool.PrioritiseReserveTransaction(rtxd, currencyState);
                     }
 
@@ -1991,7 +2024,112 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& _
 
     return pblocktemplate.release();
 }
- 
+
+/**
+ * Pay the miner outputs of a copy of a shared template to scriptTo rather than to scriptFrom, which it was built
+ * with, and rebuild the merkle and MMR roots. Fails if a transaction in the block spends the coinbase, since it
+ * refers to the coinbase by its hash.
+ */
+static bool SetTemplatePayout(CBlockTemplate &blockTemplate, const CScript &scriptFrom, const CScript &scriptTo, CBlockIndex *pindexPrev)
+{
+    CBlock &block = blockTemplate.block;
+    uint256 hashCoinbase = block.vtx[0].GetHash();
+    for (int i = 1; i < block.vtx.size(); i++)
+    {
+        for (const CTxIn &txin : block.vtx[i].vin)
+        {
+            if (txin.prevout.hash == hashCoinbase)
+            {
+                return false;
+            }
+        }
+    }
+
+    CMutableTransaction coinbaseTx(block.vtx[0]);
+    for (CTxOut &txout : coinbaseTx.vout)
+    {
+        if (txout.scriptPubKey == scriptFrom)
+        {
+            txout.scriptPubKey = scriptTo;
+        }
+    }
+    block.vtx[0] = CTransaction(coinbaseTx);
+
+    unsigned int extraNonce = 0;
+    IncrementExtraNonce(&block, pindexPrev, extraNonce, true);
+    return true;
+}
+
+/**
+ * The block template shared by all mining threads. It is built once for the current tip and mempool, and every
+ * thread asking for it gets its own copy, paying to its own coinbase script, to set its extra nonce in. The
+ * template is only rebuilt when the tip changes, or when the mempool has changed and the template is older than
+ * -blocktemplaterefresh seconds.
+ */
+class CSharedBlockTemplates
+{
+    // held while building, so threads that want a template wait for it instead of building their own.
+    // Always taken after cs_main, which RPC callers already hold and CreateNewBlock takes.
+    CCriticalSection cs;
+    std::shared_ptr<const CBlockTemplate> pTemplate;
+    CScript scriptTemplate;
+    uint256 hashPrevBlock;
+    int32_t nGpuCount;
+    unsigned int nTransactionsUpdated;
+    int64_t nBuildTime;
+
+public:
+    CSharedBlockTemplates() : nGpuCount(0), nTransactionsUpdated(0), nBuildTime(0) {}
+
+    CBlockTemplate *Get(const CChainParams& chainparams, const CScript& scriptPubKey, int32_t gpucount)
+    {
+        LOCK2(cs_main, cs);
+        CBlockIndex *pindexPrev = chainActive.LastTip();
+        unsigned int nUpdated = mempool.GetTransactionsUpdated();
+        if (pTemplate &&
+            pindexPrev->GetBlockHash() == hashPrevBlock &&
+            nGpuCount == gpucount &&
+            (nTransactionsUpdated == nUpdated ||
+             GetTime() - nBuildTime < GetArg("-blocktemplaterefresh", DEFAULT_BLOCK_TEMPLATE_REFRESH)))
+        {
+            std::unique_ptr<CBlockTemplate> pCopy(new CBlockTemplate(*pTemplate));
+            if (scriptPubKey == scriptTemplate || SetTemplatePayout(*pCopy, scriptTemplate, scriptPubKey, pindexPrev))
+            {
+                // building a template records the miner outputs as a side effect, keep that consistent
+                std::vector<pair<int, CScript>> minerOutputs({make_pair((int)1, scriptPubKey)});
+                CTxDestination firstDestination;
+                ConnectedChains.SetLatestMiningOutputs(minerOutputs, firstDestination);
+
+                nTemplatesShared++;
+                return pCopy.release();
+            }
+            // a block that spends its own coinbase is built for each script, and only shared with the same script
+            return CreateNewBlock(chainparams, scriptPubKey, gpucount, false);
+        }
+
+        CBlockTemplate *ptr = CreateNewBlock(chainparams, scriptPubKey, gpucount, false);
+        pTemplate.reset();
+        // only keep templates built on the tip we are tracking
+        if (ptr && ptr->block.hashPrevBlock == pindexPrev->GetBlockHash())
+        {
+            pTemplate = std::make_shared<const CBlockTemplate>(*ptr);
+            scriptTemplate = scriptPubKey;
+            hashPrevBlock = ptr->block.hashPrevBlock;
+            nGpuCount = gpucount;
+            nTransactionsUpdated = nUpdated;
+            nBuildTime = GetTime();
+        }
+        return ptr;
+    }
+};
+
+static CSharedBlockTemplates sharedBlockTemplates;
+
+CBlockTemplate* CreateSharedBlockTemplate(const CChainParams& chainparams, const CScript& scriptPubKey, int32_t gpucount)
+{
+    return sharedBlockTemplates.Get(chainparams, scriptPubKey, gpucount);
+}
+
 /*
  #ifdef ENABLE_WALLET
  boost::optional<CScript> GetMinerScriptPubKey(CReserveKey& reservekey)
@@ -2101,7 +2239,12 @@ CBlockTemplate* CreateNewBlockWithKey(CReserveKey& reservekey, int32_t nHeight,
             //scriptPubKey = CScript() << ToByteVector(pubkey) << OP_CHECKSIG;
         }
     }
-    return CreateNewBlock(Params(), scriptPubKey, gpucount, isStake);
+    if (isStake)
+    {
+        // a stake is found for the template it is built with, so staking templates are never shared
+        return CreateNewBlock(Params(), scriptPubKey, gpucount, isStake);
+    }
+    return CreateSharedBlockTemplate(Params(), scriptPubKey, gpucount);
 }
 
 void komodo_broadcast(const CBlock *pblock,int32_t limit)
@@ -2455,20 +2598,34 @@ typedef bool (*minefunction)(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256
 bool mine_verus_v2(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
 bool mine_verus_v2_port(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
 
-void static BitcoinMiner_noeq(CWallet *pwallet)
+void static BitcoinMiner_noeq(CWallet *pwallet, int nCPU)
 #else
-void static BitcoinMiner_noeq()
+void static BitcoinMiner_noeq(int nCPU)
 #endif
 {
     LogPrintf("%s miner started\n", ASSETCHAINS_ALGORITHMS[ASSETCHAINS_ALGO]);
     RenameThread("verushash-miner");
 
+    // pin before the hash key is allocated and first written, so its pages are placed on this CPU's NUMA node
+    if (nCPU >= 0)
+    {
+        if (SetThreadAffinity(nCPU))
+        {
+            LogPrint("mining", "%s: miner thread pinned to CPU %d\n", __func__, nCPU);
+        }
+        else
+        {
+            LogPrintf("%s: unable to pin miner thread to CPU %d\n", __func__, nCPU);
+        }
+    }
+
 #ifdef ENABLE_WALLET
     // Each thread has its own key
     CReserveKey reservekey(pwallet);
 #endif
 
-    miningTimer.clear();
+    ClearMiningTimer();
+    MiningThreadCounters *pCounters = RegisterMiningThread();
 
     const CChainParams& chainparams = Params();
     // Each thread has its own counter
@@ -2540,11 +2697,13 @@ void static BitcoinMiner_noeq()
 
             miningTimer.start();
 
+            int64_t nTemplateStart = GetTimeMicros();
 #ifdef ENABLE_WALLET
             CBlockTemplate *ptr = CreateNewBlockWithKey(reservekey, Mining_height, 0);
 #else
             CBlockTemplate *ptr = CreateNewBlockWithKey();
 #endif
+            pCounters->templateMicros += GetTimeMicros() - nTemplateStart;
             if ( ptr == 0 )
             {
                 static uint32_t counter;
@@ -2578,7 +2737,7 @@ void static BitcoinMiner_noeq()
                     LogPrintf("Error in %s miner: Invalid %s -mineraddress\n", ASSETCHAINS_ALGORITHMS[ASSETCHAINS_ALGO], ASSETCHAINS_SYMBOL);
                 }
                 miningTimer.stop();
-                miningTimer.clear();
+                ClearMiningTimer();
                 return;
             }
             CBlock *pblock = &pblocktemplate->block;
@@ -2675,6 +2834,8 @@ void static BitcoinMiner_noeq()
                 continue;
             }
 
+            pCounters->templates++;
+
             uint64_t count;
             uint64_t hashesToGo = 0;
             uint64_t totalDone = 0;
@@ -2715,6 +2876,7 @@ void static BitcoinMiner_noeq()
                                     printf("  hash: %s\ntarget: %s\n", lastChainTipPrinted->GetBlockHash().GetHex().c_str(), ArithToUint256(ourTarget).GetHex().c_str());
                                 }
                             }
+                            pCounters->staleTemplates++;
                             break;
                         }
 
@@ -2759,7 +2921,7 @@ void static BitcoinMiner_noeq()
                         do
                         {
                             // pickup/remove any new/deleted headers
-                            if (ConnectedChains.dirty || (pblock->NumPBaaSHeaders() < ConnectedChains.mergeMinedChains.size() + 1))
+                            if (ConnectedChains.dirty || (pblock->NumPBaaSHeaders() < ConnectedChains.numMergeMinedChains + 1))
                             {
                                 IncrementExtraNonce(pblock, pindexPrev, nExtraNonce, verusSolutionPBaaS ? false : true, &savebits);
 
@@ -2772,6 +2934,7 @@ void static BitcoinMiner_noeq()
                             uint64_t start = i * hashesToGo + totalDone;
                             hashesToGo -= totalDone;
 
+                            int64_t nHashStart = GetTimeMicros();
                             if (verusSolutionPBaaS)
                             {
                                 // mine on canonical header for merge mining
@@ -2785,6 +2948,12 @@ void static BitcoinMiner_noeq()
                             {
                                 blockFound = (*mine_verus)(*pblock, ss2, hashResult, uintTarget, start, &hashesToGo);
                             }
+                            pCounters->hashingMicros += GetTimeMicros() - nHashStart;
+                            if (verusclhasher_keygen_nanos)
+                            {
+                                pCounters->keyMicros += verusclhasher_keygen_nanos / 1000;
+                                verusclhasher_keygen_nanos %= 1000;
+                            }
 
                             arithHash = UintToArith256(hashResult);
                             totalDone += hashesToGo + 1;
@@ -2812,13 +2981,14 @@ void static BitcoinMiner_noeq()
                                     lastChainTipPrinted = chainActive.LastTip();
                                     printf("Block %d added to chain\n", lastChainTipPrinted->GetHeight());
                                 }
+                                pCounters->staleTemplates++;
                                 break;
                             }
                             else if ((i + 1) < count)
                             {
                                 // if we'll not drop through, update hashcount
                                 {
-                                    miningTimer += totalDone;
+                                    pCounters->hashes += totalDone;
                                     totalDone = 0;
                                 }
                             }
@@ -2876,7 +3046,7 @@ void static BitcoinMiner_noeq()
                     }
 
                     {
-                        miningTimer += totalDone;
+                        pCounters->hashes += totalDone;
                     }
                 }
                 
@@ -2927,19 +3097,19 @@ void static BitcoinMiner_noeq()
     catch (const boost::thread_interrupted&)
     {
         miningTimer.stop();
-        miningTimer.clear();
+        ClearMiningTimer();
         LogPrintf("%s miner terminated\n", ASSETCHAINS_ALGORITHMS[ASSETCHAINS_ALGO]);
         throw;
     }
     catch (const std::runtime_error &e)
     {
         miningTimer.stop();
-        miningTimer.clear();
+        ClearMiningTimer();
         LogPrintf("%s miner runtime error: %s\n", ASSETCHAINS_ALGORITHMS[ASSETCHAINS_ALGO], e.what());
         return;
     }
     miningTimer.stop();
-    miningTimer.clear();
+    ClearMiningTimer();
 }
 
 void static BitcoinMiner(CWallet *pwallet)
@@ -3403,6 +3573,32 @@ void static BitcoinMiner(CWallet *pwallet)
         c.disconnect();
     }
 
+std::vector<int> GetMinerThreadCPUs(int nThreads)
+{
+    // deal threads to nodes in turn, so each node's memory and interconnect carries an even share of the work,
+    // and within a node take CPUs in the order listed, which puts physical cores ahead of their SMT siblings
+    std::vector<std::vector<int>> nodes;
+    for (auto &node : GetNUMANodeCPUs())
+    {
+        if (node.size())
+        {
+            nodes.push_back(node);
+        }
+    }
+    std::vector<int> cpus;
+    // no pinning if the CPUs are unknown
+    if (nodes.empty())
+    {
+        return cpus;
+    }
+    for (int i = 0; i < nThreads; i++)
+    {
+        const std::vector<int> &nodeCPUs = nodes[i % nodes.size()];
+        cpus.push_back(nodeCPUs[(i / nodes.size()) % nodeCPUs.size()]);
+    }
+    return cpus;
+}
+
 #ifdef ENABLE_WALLET
     void GenerateBitcoins(bool fGenerate, CWallet* pwallet, int nThreads)
 #else
@@ -3449,6 +3645,7 @@ void static BitcoinMiner(CWallet *pwallet)
             minerThreads->join_all();
             delete minerThreads;
             minerThreads = NULL;
+            ClearMiningThreads();
         }
 
         //fprintf(stderr,"nThreads.%d fGenerate.%d\n",(int32_t)nThreads,fGenerate);
@@ -3470,18 +3667,25 @@ void static BitcoinMiner(CWallet *pwallet)
         }
 #endif
 
+        std::vector<int> threadCPUs;
+        if (GetBoolArg("-minerthreadaffinity", DEFAULT_MINER_THREAD_AFFINITY))
+        {
+            threadCPUs = GetMinerThreadCPUs(nThreads);
+        }
+
         for (int i = 0; i < nThreads; i++) {
+            int nCPU = threadCPUs.size() ? threadCPUs[i] : -1;
 
 #ifdef ENABLE_WALLET
             if (ASSETCHAINS_ALGO == ASSETCHAINS_EQUIHASH)
                 minerThreads->create_thread(boost::bind(&BitcoinMiner, pwallet));
             else
-                minerThreads->create_thread(boost::bind(&BitcoinMiner_noeq, pwallet));
+                minerThreads->create_thread(boost::bind(&BitcoinMiner_noeq, pwallet, nCPU));
 #else
             if (ASSETCHAINS_ALGO == ASSETCHAINS_EQUIHASH)
                 minerThreads->create_thread(&BitcoinMiner);
             else
-                minerThreads->create_thread(&BitcoinMiner_noeq);
+                minerThreads->create_thread(boost::bind(&BitcoinMiner_noeq, nCPU));
 #endif
         }
     }
@@ -27,8 +27,23 @@ struct CBlockTemplate
 };
 #define KOMODO_MAXGPUCOUNT 65
 
+/** Default for -blocktemplaterefresh, seconds a shared block template is reused after the mempool changes */
+static const int64_t DEFAULT_BLOCK_TEMPLATE_REFRESH = 10;
+
 /** Generate a new block, without valid proof-of-work */
 CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn, int32_t gpucount=0, bool isStake=false);
+/** Get a copy of the block template shared by all miner threads paying to scriptPubKey, building it if needed */
+CBlockTemplate* CreateSharedBlockTemplate(const CChainParams& chainparams, const CScript& scriptPubKey, int32_t gpucount=0);
+
+/** Counters for building block templates and handing out shared copies of them */
+struct CBlockTemplateStats
+{
+    uint64_t nBuilt;
+    uint64_t nShared;
+    uint64_t nBuildMicros;
+    uint64_t nLockMicros;
+};
+void GetBlockTemplateStats(CBlockTemplateStats &stats);
 #ifdef ENABLE_WALLET
 boost::optional<CScript> GetMinerScriptPubKey(CReserveKey& reservekey);
 CBlockTemplate* CreateNewBlockWithKey(CReserveKey& reservekey, int32_t nHeight, int32_t gpucount, bool isStake = false);
@@ -42,6 +57,10 @@ CBlockTemplate* CreateNewBlockWithKey();
 void GetScriptForMinerAddress(boost::shared_ptr<CReserveScript> &script);
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce, bool buildMerkle=true, uint32_t *pSaveBits=NULL);
+/** Default for -minerthreadaffinity */
+static const bool DEFAULT_MINER_THREAD_AFFINITY = false;
+/** CPUs to pin nThreads mining threads to, spread evenly across NUMA nodes */
+std::vector<int> GetMinerThreadCPUs(int nThreads);
 /** Run the miner threads */
 #ifdef ENABLE_WALLET
     void GenerateBitcoins(bool fGenerate, CWallet* pwallet, int nThreads);
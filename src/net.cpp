@@ -24,6 +24,12 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#include <atomic>
+
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
@@ -77,6 +83,7 @@ uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
 CAddrMan addrman;
 int nMaxConnections = DEFAULT_MAX_PEER_CONNECTIONS;
+bool fSocketEventsEpoll = false;
 bool fAddressesInitialized = false;
 std::string strSubVersion;
 
@@ -99,6 +106,65 @@ CCriticalSection cs_vAddedNodes;
 NodeId nLastNodeId = 0;
 CCriticalSection cs_nLastNodeId;
 
+#ifdef HAVE_SYS_EPOLL_H
+// epoll instance of ThreadSocketHandler, created by StartNode when fSocketEventsEpoll is set
+static int epollfd = -1;
+#endif
+
+std::string GetDefaultSocketEvents()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    return "epoll";
+#else
+    return "select";
+#endif
+}
+
+bool SetSocketEvents(const std::string &strMode)
+{
+    if (strMode == "select") {
+        fSocketEventsEpoll = false;
+        return true;
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (strMode == "epoll") {
+        fSocketEventsEpoll = true;
+        return true;
+    }
+#endif
+    return false;
+}
+
+// the epoll loop has no FD_SETSIZE limit, only the file descriptor limit
+static bool IsServiceableSocket(SOCKET hSocket)
+{
+    return fSocketEventsEpoll || IsSelectableSocket(hSocket);
+}
+
+// register a new peer's socket with the edge-triggered epoll loop
+static void AddSocketEvents(CNode *pnode)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd == -1 || pnode->hSocket == INVALID_SOCKET)
+        return;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl failed to add peer=%d: %s\n", pnode->id, NetworkErrorString(errno));
+        pnode->CloseSocketDisconnect();
+    }
+#endif
+}
+
+static void RemoveSocketEvents(SOCKET hSocket)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd != -1)
+        epoll_ctl(epollfd, EPOLL_CTL_DEL, hSocket, NULL);
+#endif
+}
+
 static CSemaphore *semOutbound = NULL;
 static boost::condition_variable messageHandlerCondition;
 
@@ -385,7 +451,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!IsServiceableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -401,6 +467,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
             LOCK(cs_vNodes);
             vNodes.push_back(pnode);
         }
+        AddSocketEvents(pnode);
 
         pnode->nTimeConnected = GetTime();
 
@@ -420,6 +487,7 @@ void CNode::CloseSocketDisconnect()
     if (hSocket != INVALID_SOCKET)
     {
         LogPrint("net", "disconnecting peer=%d\n", id);
+        RemoveSocketEvents(hSocket);
         CloseSocket(hSocket);
     }
 
@@ -596,7 +664,61 @@ void CNode::copyStats(CNodeStats &stats)
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
 }
 
-// requires LOCK(cs_vRecvMsg)
+/**
+ * Answer pings and record pongs as soon as they arrive, in the socket thread, rather than after the
+ * message handler gets to them behind a getdata backlog or a block being connected under cs_main.
+ * This is only done when nothing received earlier from the peer is still waiting, so a ping stays
+ * a barrier for the messages before it, and a busy handler still shows in the ping time. Anything
+ * unusual is left for ProcessMessages to handle and report.
+ * requires LOCK(pnode->cs_vRecvMsg)
+ */
+bool ProcessFastMessage(CNode *pnode)
+{
+    static const bool fDropMessagesTest = mapArgs.count("-dropmessagestest") != 0;
+
+    // ordering against the version handshake, earlier messages, replies to earlier getdata requests and
+    // queued relayed transactions is up to the message handler, as is holding back while the send buffer is full
+    if (!pnode->fSuccessfullyConnected || pnode->fDisconnect || fDropMessagesTest ||
+        pnode->vRecvMsg.size() != 1 || !pnode->vRecvGetData.empty() || pnode->nRelayedTxQueued ||
+        pnode->nSendSize >= SendBufferSize())
+        return false;
+
+    CNetMessage& msg = pnode->vRecvMsg.back();
+    const CChainParams& chainparams = Params();
+    CMessageHeader& hdr = msg.hdr;
+    if (memcmp(hdr.pchMessageStart, chainparams.MessageStart(), MESSAGE_START_SIZE) != 0 ||
+        !hdr.IsValid(chainparams.MessageStart()))
+        return false;
+
+    std::string strCommand = hdr.GetCommand();
+    bool fPing = strCommand == "ping";
+    if (!fPing && strCommand != "pong")
+        return false;
+    // pings too short to parse are rejected by the message handler
+    if (fPing && (pnode->nVersion <= BIP0031_VERSION || hdr.nMessageSize < sizeof(uint64_t)))
+        return false;
+
+    uint256 hash = Hash(msg.vRecv.begin(), msg.vRecv.begin() + hdr.nMessageSize);
+    if (ReadLE32((unsigned char*)&hash) != hdr.nChecksum)
+        return false;
+
+    // don't wait on SendMessages, the handler thread will get to it
+    TRY_LOCK(pnode->cs_vSend, lockSend);
+    if (!lockSend)
+        return false;
+
+    // take it out of vRecvMsg before handling it, which is cleared if the peer is disconnected
+    CNetMessage fastMsg(msg);
+    pnode->vRecvMsg.pop_back();
+
+    LogPrint("net", "received: %s (%u bytes) peer=%d\n", strCommand, fastMsg.vRecv.size(), pnode->id);
+    if (fPing)
+        pnode->ProcessPing(fastMsg.vRecv, fastMsg.nTime, true);
+    else
+        pnode->ProcessPong(fastMsg.vRecv, fastMsg.nTime);
+    return true;
+}
+
 bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 {
     while (nBytes > 0) {
@@ -628,13 +750,110 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            if (!ProcessFastMessage(this))
+                messageHandlerCondition.notify_one();
         }
     }
 
     return true;
 }
 
+void CNode::ProcessPing(CDataStream& vRecv, int64_t nTimeReceived, bool fFastPath)
+{
+    if (nVersion > BIP0031_VERSION)
+    {
+        uint64_t nonce = 0;
+        vRecv >> nonce;
+        // Echo the message back with the nonce. This allows for two useful features:
+        //
+        // 1) A remote node can quickly check if the connection is operational
+        // 2) Remote nodes can measure the latency of the network thread. If this node
+        //    is overloaded it won't respond to pings quickly and the remote node can
+        //    avoid sending us more work, like chain download requests.
+        //
+        // The nonce stops the remote getting confused between different pings: without
+        // it, if the remote node sends a ping once per second and this node takes 5
+        // seconds to respond to each, the 5th ping the remote sends would appear to
+        // return very quickly.
+        if (fFastPath)
+        {
+            // queued for the socket thread to send after this receive, as a failed optimistic write
+            // here would disconnect the peer while its receive buffer is in use
+            try
+            {
+                BeginMessage("pong");
+                ssSend << nonce;
+                EndMessage(false);
+            }
+            catch (...)
+            {
+                AbortMessage();
+                throw;
+            }
+        }
+        else
+            PushMessage("pong", nonce);
+        RecordPingResponse(GetTimeMicros() - nTimeReceived, fFastPath);
+    }
+}
+
+void CNode::ProcessPong(CDataStream& vRecv, int64_t nTimeReceived)
+{
+    int64_t pingUsecEnd = nTimeReceived;
+    uint64_t nonce = 0;
+    size_t nAvail = vRecv.in_avail();
+    bool bPingFinished = false;
+    std::string sProblem;
+
+    if (nAvail >= sizeof(nonce)) {
+        vRecv >> nonce;
+
+        // Only process pong message if there is an outstanding ping (old ping without nonce should never pong)
+        if (nPingNonceSent != 0) {
+            if (nonce == nPingNonceSent) {
+                // Matching pong received, this ping is no longer outstanding
+                bPingFinished = true;
+                int64_t pingUsecTime = pingUsecEnd - nPingUsecStart;
+                if (pingUsecTime > 0) {
+                    // Successful ping time measurement, replace previous
+                    nPingUsecTime = pingUsecTime;
+                    nMinPingUsecTime = std::min(nMinPingUsecTime, pingUsecTime);
+                } else {
+                    // This should never happen
+                    sProblem = "Timing mishap";
+                }
+            } else {
+                // Nonce mismatches are normal when pings are overlapping
+                sProblem = "Nonce mismatch";
+                if (nonce == 0) {
+                    // This is most likely a bug in another implementation somewhere; cancel this ping
+                    bPingFinished = true;
+                    sProblem = "Nonce zero";
+                }
+            }
+        } else {
+            sProblem = "Unsolicited pong without ping";
+        }
+    } else {
+        // This is most likely a bug in another implementation somewhere; cancel this ping
+        bPingFinished = true;
+        sProblem = "Short payload";
+    }
+
+    if (!(sProblem.empty())) {
+        LogPrint("net", "pong peer=%d %s: %s, %x expected, %x received, %u bytes\n",
+                 id,
+                 cleanSubVer,
+                 sProblem,
+                 nPingNonceSent,
+                 nonce,
+                 nAvail);
+    }
+    if (bPingFinished) {
+        nPingNonceSent = 0;
+    }
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -960,7 +1179,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!IsServiceableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1011,11 +1230,196 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    AddSocketEvents(pnode);
+}
+
+// requires LOCK(cs_vRecvMsg)
+// there is room for more received data, or no complete message is waiting to be processed
+static bool CanReceiveMore(CNode *pnode)
+{
+    return pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+           pnode->GetTotalRecvSize() <= ReceiveFloodSize();
+}
+
+// requires LOCK(cs_vRecvMsg)
+// returns true if the read filled the buffer, so more data may be waiting in the socket
+static bool SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0)
+    {
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+            pnode->CloseSocketDisconnect();
+        pnode->nLastRecv = GetTime();
+        pnode->nRecvBytes += nBytes;
+        pnode->RecordBytesRecv(nBytes);
+        return nBytes == sizeof(pchBuf) && pnode->hSocket != INVALID_SOCKET;
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
 }
 
+static void InactivityCheck(CNode *pnode)
+{
+    int64_t nTime = GetTime();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static const int MAX_SOCKET_EVENTS = 1024;
+
+static const ListenSocket *FindListenSocket(const void *ptr)
+{
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+        if (&hListenSocket == ptr)
+            return &hListenSocket;
+    return NULL;
+}
+
+/**
+ * One pass of the epoll socket loop. Peer sockets are edge-triggered, so an event marks a node
+ * pending, and it stays pending until it has read all it can and sent all it could. Only pending
+ * nodes are visited, and inactivity is checked once a second. Returns true if a read filled its
+ * buffer, so the next pass should not sleep.
+ */
+static bool ServiceSocketEvents(std::set<CNode*> &setPending, int64_t &nLastInactivityCheck, bool fNoWait)
+{
+    struct epoll_event events[MAX_SOCKET_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, MAX_SOCKET_EVENTS, fNoWait ? 0 : 50);
+    boost::this_thread::interruption_point();
+
+    if (nEvents < 0)
+    {
+        int nErr = errno;
+        if (nErr != EINTR)
+        {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            MilliSleep(50);
+        }
+        nEvents = 0;
+    }
+
+    for (int i = 0; i < nEvents; i++)
+    {
+        // listening sockets are level-triggered, so one accept per event is enough
+        const ListenSocket *pListenSocket = FindListenSocket(events[i].data.ptr);
+        if (pListenSocket)
+        {
+            AcceptConnection(*pListenSocket);
+            continue;
+        }
+        CNode *pnode = (CNode *)events[i].data.ptr;
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            pnode->fHasRecvData = true;
+        setPending.insert(pnode);
+    }
+
+    int64_t nTime = GetTime();
+    if (nTime != nLastInactivityCheck)
+    {
+        nLastInactivityCheck = nTime;
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            InactivityCheck(pnode);
+            // a send that was left queued without a later EPOLLOUT event is retried here
+            if (pnode->nSendSize > 0)
+                setPending.insert(pnode);
+        }
+    }
+
+    vector<CNode*> vNodesPending;
+    {
+        LOCK(cs_vNodes);
+        vNodesPending.assign(setPending.begin(), setPending.end());
+        BOOST_FOREACH(CNode* pnode, vNodesPending)
+            pnode->AddRef();
+    }
+    bool fMoreData = false;
+    BOOST_FOREACH(CNode* pnode, vNodesPending)
+    {
+        boost::this_thread::interruption_point();
+
+        // kept pending while the receive buffer is full or a lock is busy
+        bool fDone = true;
+        if (pnode->hSocket != INVALID_SOCKET && pnode->fHasRecvData)
+        {
+            TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+            if (!lockRecv || !CanReceiveMore(pnode))
+                fDone = false;
+            else if (SocketRecvData(pnode))
+                fDone = false, fMoreData = true;
+            else
+                pnode->fHasRecvData = false;
+        }
+        // a send that would block leaves the rest queued until EPOLLOUT
+        if (pnode->hSocket != INVALID_SOCKET)
+        {
+            TRY_LOCK(pnode->cs_vSend, lockSend);
+            if (!lockSend)
+                fDone = false;
+            else if (!pnode->vSendMsg.empty())
+                SocketSendData(pnode);
+        }
+        if (fDone || pnode->hSocket == INVALID_SOCKET)
+            setPending.erase(pnode);
+    }
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodesPending)
+            pnode->Release();
+    }
+    return fMoreData;
+}
+#endif
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    std::set<CNode*> setPendingNodes;
+    int64_t nLastInactivityCheck = 0;
+    bool fMoreData = false;
     while (true)
     {
         //
@@ -1032,6 +1436,7 @@ void ThreadSocketHandler()
                 {
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                    setPendingNodes.erase(pnode);
 
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
@@ -1081,6 +1486,14 @@ void ThreadSocketHandler()
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+#ifdef HAVE_SYS_EPOLL_H
+        if (fSocketEventsEpoll)
+        {
+            fMoreData = ServiceSocketEvents(setPendingNodes, nLastInactivityCheck, fMoreData);
+            continue;
+        }
+#endif
+
         //
         // Find which sockets have data to receive
         //
@@ -1137,9 +1550,7 @@ void ThreadSocketHandler()
                 }
                 {
                     TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (
-                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+                    if (lockRecv && CanReceiveMore(pnode))
                         FD_SET(pnode->hSocket, &fdsetRecv);
                 }
             }
@@ -1197,39 +1608,7 @@ void ThreadSocketHandler()
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0)
-                        {
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pnode->CloseSocketDisconnect();
-                            pnode->nLastRecv = GetTime();
-                            pnode->nRecvBytes += nBytes;
-                            pnode->RecordBytesRecv(nBytes);
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
+                    SocketRecvData(pnode);
             }
 
             //
@@ -1247,30 +1626,7 @@ void ThreadSocketHandler()
             //
             // Inactivity checking
             //
-            int64_t nTime = GetTime();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-            }
+            InactivityCheck(pnode);
         }
         {
             LOCK(cs_vNodes);
@@ -1560,6 +1916,11 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
+void WakeMessageHandler()
+{
+    messageHandlerCondition.notify_one();
+}
+
 void ThreadMessageHandler()
 {
     boost::mutex condition_mutex;
@@ -1599,7 +1960,8 @@ void ThreadMessageHandler()
 
                     if (pnode->nSendSize < SendBufferSize())
                     {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
+                        if (!pnode->vRecvGetData.empty() ||
+                            (!pnode->fMessagesHeld && !pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
                         {
                             fSleep = false;
                         }
@@ -1803,6 +2165,26 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     Discover(threadGroup);
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (fSocketEventsEpoll && epollfd == -1)
+    {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s, using select()\n", NetworkErrorString(errno));
+            fSocketEventsEpoll = false;
+        } else {
+            BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket) {
+                struct epoll_event event;
+                event.events = EPOLLIN;
+                event.data.ptr = &hListenSocket;
+                if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0)
+                    LogPrintf("epoll_ctl failed to add listening socket: %s\n", NetworkErrorString(errno));
+            }
+        }
+    }
+#endif
+    LogPrintf("Waiting for socket events with %s\n", fSocketEventsEpoll ? "epoll" : "select()");
+
     //
     // Start threads
     //
@@ -1868,6 +2250,11 @@ public:
         vNodes.clear();
         vNodesDisconnected.clear();
         vhListenSocket.clear();
+#ifdef HAVE_SYS_EPOLL_H
+        if (epollfd != -1)
+            close(epollfd);
+        epollfd = -1;
+#endif
         delete semOutbound;
         semOutbound = NULL;
         delete pnodeLocalHost;
@@ -1944,6 +2331,65 @@ uint64_t CNode::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+// bucket i counts responses taking less than 2^i usec, and at least half that
+static const int PING_RESPONSE_BUCKETS = 32;
+static std::atomic<uint64_t> vPingResponseBuckets[PING_RESPONSE_BUCKETS];
+static std::atomic<uint64_t> nPingResponseCount(0);
+static std::atomic<uint64_t> nPingResponseFastPath(0);
+static std::atomic<uint64_t> nPingResponseUsecTotal(0);
+static std::atomic<int64_t> nPingResponseUsecMax(0);
+
+void CNode::RecordPingResponse(int64_t nUsec, bool fFastPath)
+{
+    if (nUsec < 0)
+        nUsec = 0;
+    int nBucket = 0;
+    while (nBucket < PING_RESPONSE_BUCKETS - 1 && (nUsec >> nBucket) != 0)
+        nBucket++;
+    vPingResponseBuckets[nBucket]++;
+    nPingResponseCount++;
+    if (fFastPath)
+        nPingResponseFastPath++;
+    nPingResponseUsecTotal += nUsec;
+
+    int64_t nMax = nPingResponseUsecMax.load();
+    while (nUsec > nMax && !nPingResponseUsecMax.compare_exchange_weak(nMax, nUsec))
+        ;
+}
+
+CPingResponseStats CNode::GetPingResponseStats()
+{
+    CPingResponseStats stats;
+    uint64_t vBuckets[PING_RESPONSE_BUCKETS];
+    uint64_t nTotal = 0;
+    for (int i = 0; i < PING_RESPONSE_BUCKETS; i++)
+        nTotal += (vBuckets[i] = vPingResponseBuckets[i].load());
+
+    stats.nCount = nTotal;
+    stats.nFastPath = nPingResponseFastPath.load();
+    stats.nMaxUsec = nPingResponseUsecMax.load();
+    stats.nAvgUsec = nTotal ? nPingResponseUsecTotal.load() / nTotal : 0;
+
+    // percentiles are reported as the upper bound of their bucket
+    stats.nMedianUsec = stats.nP99Usec = -1;
+    uint64_t nSeen = 0;
+    for (int i = 0; i < PING_RESPONSE_BUCKETS && nTotal; i++)
+    {
+        nSeen += vBuckets[i];
+        int64_t nBound = std::min(((int64_t)1 << i) - 1, stats.nMaxUsec);
+        if (stats.nMedianUsec < 0 && nSeen * 2 >= nTotal)
+            stats.nMedianUsec = nBound;
+        if (nSeen * 100 >= nTotal * 99)
+        {
+            stats.nP99Usec = nBound;
+            break;
+        }
+    }
+    stats.nMedianUsec = std::max(stats.nMedianUsec, (int64_t)0);
+    stats.nP99Usec = std::max(stats.nP99Usec, (int64_t)0);
+    return stats;
+}
+
 void CNode::Fuzz(int nChance)
 {
     if (!fSuccessfullyConnected) return; // Don't fuzz initial handshake
@@ -2108,9 +2554,12 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     fNetworkNode = false;
     fSuccessfullyConnected = false;
     fDisconnect = false;
+    fHasRecvData = false;
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+    nRelayedTxQueued = 0;
+    fMessagesHeld = false;
     hashContinue = uint256();
     nStartingHeight = -1;
     fGetAddr = false;
@@ -2201,7 +2650,7 @@ void CNode::AbortMessage() UNLOCK_FUNCTION(cs_vSend)
     LogPrint("net", "(aborted)\n");
 }
 
-void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
+void CNode::EndMessage(bool fOptimisticSend) UNLOCK_FUNCTION(cs_vSend)
 {
     // The -*messagestest options are intentionally not documented in the help message,
     // since they are only used during development to debug the networking code and are
@@ -2238,7 +2687,7 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     nSendSize += (*it).size();
 
     // If write queue empty, attempt "optimistic write"
-    if (it == vSendMsg.begin())
+    if (fOptimisticSend && it == vSendMsg.begin())
         SocketSendData(this);
 
     LEAVE_CRITICAL_SECTION(cs_vSend);
@@ -77,6 +77,10 @@ unsigned short GetListenPort();
 bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhitelisted = false);
 void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler);
 bool StopNode();
+//! "epoll" where it is available, otherwise "select"
+std::string GetDefaultSocketEvents();
+//! choose the event loop of ThreadSocketHandler, false if the mode is not available on this platform
+bool SetSocketEvents(const std::string &strMode);
 void SocketSendData(CNode *pnode);
 
 typedef int NodeId;
@@ -122,6 +126,10 @@ enum
 };
 
 bool IsPeerAddrLocalGood(CNode *pnode);
+/** Answer a lone ping or record a lone pong from the socket thread, requires LOCK(pnode->cs_vRecvMsg) */
+bool ProcessFastMessage(CNode *pnode);
+/** Wake the message handler thread when work it held back for a peer is ready */
+void WakeMessageHandler();
 void AdvertizeLocal(CNode *pnode);
 void SetLimited(enum Network net, bool fLimited = true);
 bool IsLimited(enum Network net);
@@ -144,6 +152,8 @@ extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
 /** Maximum number of connections to simultaneously allow (aka connection slots) */
 extern int nMaxConnections;
+// ThreadSocketHandler waits with epoll instead of select(), which also lifts the FD_SETSIZE limit on connections
+extern bool fSocketEventsEpoll;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
@@ -169,6 +179,17 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
+/** Time from the arrival of a ping to its pong being queued, over all peers */
+struct CPingResponseStats
+{
+    uint64_t nCount;
+    uint64_t nFastPath;                 // pings answered by the socket thread
+    int64_t nAvgUsec;
+    int64_t nMedianUsec;
+    int64_t nP99Usec;
+    int64_t nMaxUsec;
+};
+
 class CNodeStats
 {
 public:
@@ -253,6 +274,9 @@ public:
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
+    // relayed transactions waiting to be prechecked or accepted, which hold back the peer's other messages
+    size_t nRelayedTxQueued;
+    bool fMessagesHeld;
     uint64_t nRecvBytes;
     int nRecvVersion;
 
@@ -277,6 +301,8 @@ public:
     bool fNetworkNode;
     bool fSuccessfullyConnected;
     bool fDisconnect;
+    // the epoll loop saw the socket become readable and has not yet read it empty
+    bool fHasRecvData;
     // We use fRelayTxes for two purposes -
     // a) it allows us to not relay tx invs before receiving the peer's version message
     // b) the peer may tell us in its version message that we should not relay tx invs
@@ -374,6 +400,11 @@ public:
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes);
 
+    // ping and pong handlers, shared by the socket thread and ProcessMessage
+    // requires LOCK(cs_vSend)
+    void ProcessPing(CDataStream& vRecv, int64_t nTimeReceived, bool fFastPath);
+    void ProcessPong(CDataStream& vRecv, int64_t nTimeReceived);
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
     {
@@ -441,7 +472,8 @@ public:
     void AbortMessage() UNLOCK_FUNCTION(cs_vSend);
 
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
-    void EndMessage() UNLOCK_FUNCTION(cs_vSend);
+    // Without fOptimisticSend the message is left queued for the socket thread.
+    void EndMessage(bool fOptimisticSend = true) UNLOCK_FUNCTION(cs_vSend);
 
     void PushVersion();
 
@@ -656,6 +688,9 @@ public:
 
     static uint64_t GetTotalBytesRecv();
     static uint64_t GetTotalBytesSent();
+
+    static void RecordPingResponse(int64_t nUsec, bool fFastPath);
+    static CPingResponseStats GetPingResponseStats();
 };
 
 
@@ -0,0 +1,118 @@
+// Copyright (c) 2019 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_ORACLEINDEX_H
+#define BITCOIN_ORACLEINDEX_H
+
+#include "uint256.h"
+#include "pubkey.h"
+#include "primitives/transaction.h"
+
+#include <vector>
+
+/** Data samples are sorted by oracle, then publisher, then block height and position in the block */
+struct COracleSampleKey {
+    uint256 oracletxid;
+    uint160 publisher;                  // key id of the publisher's pubkey
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 92;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        publisher.Serialize(s);
+        // Heights and positions are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        oracletxid.Unserialize(s);
+        publisher.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+    }
+
+    COracleSampleKey(const uint256 &oracle, const CPubKey &pk, int height, unsigned int pos, const uint256 &txid) {
+        oracletxid = oracle;
+        publisher = pk.GetID();
+        blockHeight = height;
+        txindex = pos;
+        txhash = txid;
+    }
+
+    COracleSampleKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        oracletxid.SetNull();
+        publisher.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+    }
+
+    // true if this sample was mined after the other one
+    bool IsNewerThan(const COracleSampleKey &other) const {
+        return blockHeight > other.blockHeight || (blockHeight == other.blockHeight && txindex > other.txindex);
+    }
+};
+
+struct COracleSampleIteratorKey {
+    uint256 oracletxid;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        oracletxid.Unserialize(s);
+    }
+
+    COracleSampleIteratorKey(const uint256 &oracle) {
+        oracletxid = oracle;
+    }
+
+    COracleSampleIteratorKey() {
+        oracletxid.SetNull();
+    }
+};
+
+struct COracleSampleValue {
+    CPubKey publisher;
+    std::vector<uint8_t> data;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(publisher);
+        READWRITE(data);
+    }
+
+    COracleSampleValue() {}
+    COracleSampleValue(const CPubKey &pk, const std::vector<uint8_t> &vdata) : publisher(pk), data(vdata) {}
+};
+
+typedef std::pair<COracleSampleKey, COracleSampleValue> COracleSampleDbEntry;
+
+/** Implemented in cc/oracles.cpp */
+// get the index entry for an oracles data transaction mined at height, in position txindex of its block
+void GetOracleIndexSamples(const CTransaction &tx, int height, unsigned int txindex, std::vector<COracleSampleDbEntry> &samples);
+// keep the cached latest prices of each oracle current as blocks are connected and disconnected
+void OracleIndexBlockConnected(const std::vector<COracleSampleDbEntry> &samples);
+void OracleIndexBlockDisconnected(const std::vector<COracleSampleDbEntry> &samples);
+
+#endif // BITCOIN_ORACLEINDEX_H
@@ -25,6 +25,7 @@
 #include "clientversion.h"
 #include "rpc/client.h"
 #include "rpc/protocol.h"
+#include "sync.h"
 #include "util.h"
 #include "utilstrencodings.h"
 
@@ -32,7 +33,12 @@
 #include <boost/format.hpp>
 #include <stdio.h>
 
+#include <map>
+#include <memory>
+
 #include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/http.h>
 #include <event2/keyvalq_struct.h>
 #include "support/events.h"
 
@@ -67,11 +73,12 @@ public:
 /** Reply structure for request_done to fill in */
 struct HTTPReply
 {
-    HTTPReply(): status(0), error(-1) {}
+    HTTPReply(): status(0), error(-1), base(NULL) {}
 
     int status;
     int error;
     std::string body;
+    struct event_base *base;            // if set, the event loop to stop when the request is done
 };
 
 const char *http_errorstring(int code)
@@ -100,6 +107,10 @@ static void http_request_done(struct evhttp_request *req, void *ctx)
 {
     HTTPReply *reply = static_cast<HTTPReply*>(ctx);
 
+    // a keep-alive connection stays open, so the loop would otherwise run until the server closes it
+    if (reply->base)
+        event_base_loopbreak(reply->base);
+
     if (req == NULL) {
         /* If req is NULL, it means an error occurred while connecting: the
          * error code will have been passed to http_error_cb.
@@ -150,20 +161,161 @@ static CCrossChainRPCData LoadFromConfig(std::string name)
     return ret;
 }
 
-// credentials for now are "user:password"
-UniValue RPCCall(const string& strMethod, const UniValue& params, const string credentials, int port, const string host, int timeout)
+/** An HTTP connection to another daemon, kept open between calls */
+struct CRPCConnection
 {
-    // Used for inter-daemon communicatoin to enable merge mining and notarization without a client
-    //
+    raii_event_base base;
+    raii_evhttp_connection evcon;
+    int64_t nLastUsed;
+
+    CRPCConnection(const std::string &host, int port) :
+        base(obtain_event_base()),
+        evcon(obtain_evhttp_connection_base(base.get(), host, port)),
+        nLastUsed(0) {}
+
+    // false if the other side has closed the connection, which has to be known before a request is written to it
+    bool IsOpen()
+    {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+        struct bufferevent *bev = evhttp_connection_get_bufferevent(evcon.get());
+        evutil_socket_t fd = bev ? bufferevent_getfd(bev) : -1;
+        if (fd < 0)
+            return true;                // not connected, a request makes a new connection
+        // the socket is non-blocking, and an idle connection has nothing to read unless it was closed
+        char c;
+        int nBytes = recv(fd, &c, 1, MSG_PEEK);
+        return nBytes < 0 && (WSAGetLastError() == WSAEWOULDBLOCK || WSAGetLastError() == WSAEINTR);
+#else
+        return true;
+#endif
+    }
+};
+
+/**
+ * Idle keep-alive connections by host and port. Each connection has its own event base and is used by one calling
+ * thread at a time, so callers in different threads can talk to the same daemon concurrently.
+ */
+class CRPCConnectionPool
+{
+    static const size_t MAX_IDLE_PER_HOST = 4;
+    // well under the server's default -rpcservertimeout of 30 seconds, so it rarely closes one we are about to use
+    static const int64_t MAX_IDLE_SECONDS = 15;
+
+    CCriticalSection cs;
+    std::map<std::pair<std::string, int>, std::vector<std::unique_ptr<CRPCConnection>>> mapIdle;
+
+public:
+    // returns an idle connection that is still open if there is one, otherwise NULL
+    std::unique_ptr<CRPCConnection> Take(const std::string &host, int port)
+    {
+        LOCK(cs);
+        std::unique_ptr<CRPCConnection> ret;
+        auto it = mapIdle.find(std::make_pair(host, port));
+        while (it != mapIdle.end() && it->second.size() && !ret)
+        {
+            ret = std::move(it->second.back());
+            it->second.pop_back();
+            if (GetTime() - ret->nLastUsed >= MAX_IDLE_SECONDS || !ret->IsOpen())
+            {
+                ret.reset();
+            }
+        }
+        return ret;
+    }
+
+    void Return(const std::string &host, int port, std::unique_ptr<CRPCConnection> conn)
+    {
+        conn->nLastUsed = GetTime();
+        LOCK(cs);
+        auto &idle = mapIdle[std::make_pair(host, port)];
+        if (idle.size() < MAX_IDLE_PER_HOST)
+        {
+            idle.push_back(std::move(conn));
+        }
+    }
+};
+
+static CRPCConnectionPool rpcConnectionPool;
+
+/** Latency of calls to other daemons by method, in buckets with the upper bounds below in milliseconds */
+class CRPCCallStats
+{
+public:
+    static const int NUM_BUCKETS = 8;
+
+    struct CMethodStats
+    {
+        uint64_t nCalls = 0;
+        uint64_t nErrors = 0;
+        int64_t nTotalMicros = 0;
+        uint64_t buckets[NUM_BUCKETS] = {};
+    };
+
+    void Record(const std::string &method, int64_t nMicros, bool fError)
+    {
+        LOCK(cs);
+        CMethodStats &stats = mapStats[method];
+        stats.nCalls++;
+        stats.nTotalMicros += nMicros;
+        if (fError)
+        {
+            stats.nErrors++;
+        }
+        int i = 0;
+        while (i < NUM_BUCKETS - 1 && nMicros >= BucketLimits()[i] * 1000)
+        {
+            i++;
+        }
+        stats.buckets[i]++;
+    }
+
+    UniValue ToUniValue()
+    {
+        LOCK(cs);
+        UniValue ret(UniValue::VOBJ);
+        for (auto &oneMethod : mapStats)
+        {
+            UniValue method(UniValue::VOBJ);
+            method.push_back(Pair("calls", oneMethod.second.nCalls));
+            method.push_back(Pair("errors", oneMethod.second.nErrors));
+            method.push_back(Pair("avgms", oneMethod.second.nCalls ? 0.001 * oneMethod.second.nTotalMicros / oneMethod.second.nCalls : 0.0));
+            UniValue histogram(UniValue::VOBJ);
+            for (int i = 0; i < NUM_BUCKETS; i++)
+            {
+                histogram.push_back(Pair(i == NUM_BUCKETS - 1 ? std::string("more") : strprintf("<%dms", BucketLimits()[i]),
+                                         oneMethod.second.buckets[i]));
+            }
+            method.push_back(Pair("latency", histogram));
+            ret.push_back(Pair(oneMethod.first, method));
+        }
+        return ret;
+    }
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
+private:
+    static const int *BucketLimits()
+    {
+        static const int limits[NUM_BUCKETS - 1] = {1, 5, 10, 50, 100, 500, 1000};
+        return limits;
+    }
 
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), timeout);
+    CCriticalSection cs;
+    std::map<std::string, CMethodStats> mapStats;
+};
+
+static CRPCCallStats rpcCallStats;
+
+UniValue GetRPCCallStats()
+{
+    return rpcCallStats.ToUniValue();
+}
+
+// makes one request on conn and returns the HTTP reply, the connection is only usable again if status is non-zero
+static HTTPReply RPCSendRequest(CRPCConnection &conn, const std::string &strRequest, const string &credentials, const string &host, int timeout)
+{
+    evhttp_connection_set_timeout(conn.evcon.get(), timeout);
 
     HTTPReply response;
+    response.base = conn.base.get();
     raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
     if (req == NULL)
         throw std::runtime_error("create http request failed");
@@ -174,26 +326,45 @@ UniValue RPCCall(const string& strMethod, const UniValue& params, const string c
     struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
     assert(output_headers);
     evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
+    evhttp_add_header(output_headers, "Connection", "keep-alive");
     evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(credentials)).c_str());
 
     // Attach request data
-    std::string strRequest = JSONRPCRequest(strMethod, params, 1);
     struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
     assert(output_buffer);
     evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
 
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
+    int r = evhttp_make_request(conn.evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
     req.release(); // ownership moved to evcon in above call
     if (r != 0) {
         throw CConnectionFailed("send http request failed");
     }
 
-    event_base_dispatch(base.get());
+    event_base_dispatch(conn.base.get());
+    return response;
+}
+
+// sends a JSON-RPC request or batch over a pooled connection and returns the parsed reply
+static UniValue RPCCallPooled(const std::string &strRequest, const string &credentials, int port, const string &host, int timeout)
+{
+    // Used for inter-daemon communicatoin to enable merge mining and notarization without a client
+    //
+    // a failed request is not retried, as it may have been written and carried out, and calls like
+    // sendcurrency must not be made twice. Closed connections are dropped from the pool before use instead.
+    std::unique_ptr<CRPCConnection> conn = rpcConnectionPool.Take(host, port);
+    if (!conn)
+    {
+        conn.reset(new CRPCConnection(host, port));
+    }
+
+    HTTPReply response = RPCSendRequest(*conn, strRequest, credentials, host, timeout);
 
     if (response.status == 0)
         throw CConnectionFailed(strprintf("couldn't connect to server: %s (code %d)\n(make sure server is running and you are connecting to the correct RPC port)", http_errorstring(response.error), response.error));
-    else if (response.status == HTTP_UNAUTHORIZED)
+
+    rpcConnectionPool.Return(host, port, std::move(conn));
+
+    if (response.status == HTTP_UNAUTHORIZED)
         throw std::runtime_error("incorrect rpcuser or rpcpassword (authorization failed)");
     else if (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR)
         throw std::runtime_error(strprintf("server returned HTTP error %d", response.status));
@@ -204,23 +375,82 @@ UniValue RPCCall(const string& strMethod, const UniValue& params, const string c
     UniValue valReply(UniValue::VSTR);
     if (!valReply.read(response.body))
         throw std::runtime_error("couldn't parse reply from server");
-    const UniValue& reply = valReply.get_obj();
-    if (reply.empty())
-        throw std::runtime_error("expected reply to have result, error and id properties");
+    return valReply;
+}
 
-    return reply;
+// credentials for now are "user:password"
+UniValue RPCCall(const string& strMethod, const UniValue& params, const string credentials, int port, const string host, int timeout)
+{
+    int64_t nStart = GetTimeMicros();
+    try
+    {
+        UniValue valReply = RPCCallPooled(JSONRPCRequest(strMethod, params, 1), credentials, port, host, timeout);
+        const UniValue& reply = valReply.get_obj();
+        if (reply.empty())
+            throw std::runtime_error("expected reply to have result, error and id properties");
+
+        rpcCallStats.Record(strMethod, GetTimeMicros() - nStart, !find_value(reply, "error").isNull());
+        return reply;
+    }
+    catch (...)
+    {
+        rpcCallStats.Record(strMethod, GetTimeMicros() - nStart, true);
+        throw;
+    }
 }
 
-UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeout)
+UniValue RPCCallBatch(const std::vector<std::pair<std::string, UniValue>> &calls, const std::string credentials, int port, const std::string host, int timeout)
+{
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < calls.size(); i++)
+    {
+        UniValue request(UniValue::VOBJ);
+        request.read(JSONRPCRequest(calls[i].first, calls[i].second, i));
+        batch.push_back(request);
+    }
+
+    int64_t nStart = GetTimeMicros();
+    UniValue valReply;
+    try
+    {
+        valReply = RPCCallPooled(batch.write(), credentials, port, host, timeout);
+        if (!valReply.isArray())
+            throw std::runtime_error("expected reply to be an array of replies");
+    }
+    catch (...)
+    {
+        rpcCallStats.Record("batch", GetTimeMicros() - nStart, true);
+        throw;
+    }
+    rpcCallStats.Record("batch", GetTimeMicros() - nStart, false);
+
+    // replies may come back in any order, put them in the order of the calls
+    UniValue ret(UniValue::VARR);
+    std::vector<UniValue> replies(calls.size());
+    for (int i = 0; i < valReply.size(); i++)
+    {
+        const UniValue &id = find_value(valReply[i], "id");
+        if (id.isNum() && id.get_int() >= 0 && id.get_int() < calls.size())
+        {
+            replies[id.get_int()] = valReply[i];
+        }
+    }
+    for (auto &oneReply : replies)
+    {
+        ret.push_back(oneReply);
+    }
+    return ret;
+}
+
+// makes sure we know how to reach the root chain daemon, reading its config file if needed
+static bool GetRootRPCData()
 {
-    string host, credentials;
-    int port;
     map<string, string> settings;
     map<string, vector<string>> settingsmulti;
 
     if (PBAAS_HOST != "" && PBAAS_PORT != 0)
     {
-        return RPCCall(strMethod, params, PBAAS_USERPASS, PBAAS_PORT, PBAAS_HOST);
+        return true;
     }
     else if (ReadConfigFile(PBAAS_TESTMODE ? "VRSCTEST" : "VRSC", settings, settingsmulti))
     {
@@ -231,7 +461,25 @@ UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeou
         {
             PBAAS_HOST = "127.0.0.1";
         }
-        return RPCCall(strMethod, params, credentials, port, host, timeout);
+        return true;
+    }
+    return false;
+}
+
+UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeout)
+{
+    if (GetRootRPCData())
+    {
+        return RPCCall(strMethod, params, PBAAS_USERPASS, PBAAS_PORT, PBAAS_HOST, timeout);
+    }
+    return UniValue(UniValue::VNULL);
+}
+
+UniValue RPCCallRootBatch(const std::vector<std::pair<std::string, UniValue>> &calls, int timeout)
+{
+    if (GetRootRPCData())
+    {
+        return RPCCallBatch(calls, PBAAS_USERPASS, PBAAS_PORT, PBAAS_HOST, timeout);
     }
     return UniValue(UniValue::VNULL);
 }
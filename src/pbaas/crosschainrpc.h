@@ -68,7 +68,18 @@ UniValue RPCCall(const std::string& strMethod,
                  const std::string host="127.0.0.1", 
                  int timeout=DEFAULT_RPC_TIMEOUT);
 
+// sends all calls in one JSON-RPC batch and returns their replies in the same order
+UniValue RPCCallBatch(const std::vector<std::pair<std::string, UniValue>> &calls,
+                      const std::string credentials="user:pass",
+                      int port=27486,
+                      const std::string host="127.0.0.1",
+                      int timeout=DEFAULT_RPC_TIMEOUT);
+
 UniValue RPCCallRoot(const std::string& strMethod, const UniValue& params, int timeout=DEFAULT_RPC_TIMEOUT);
+UniValue RPCCallRootBatch(const std::vector<std::pair<std::string, UniValue>> &calls, int timeout=DEFAULT_RPC_TIMEOUT);
+
+// call counts, errors and latency histograms of calls to other daemons by method
+UniValue GetRPCCallStats();
 
 template <typename SERIALIZABLE>
 std::vector<unsigned char> AsVector(const SERIALIZABLE &obj)
@@ -619,6 +619,7 @@ bool CConnectedChains::RemoveMergedBlock(uint160 chainID)
             }
         }
         mergeMinedChains.erase(chainID);
+        numMergeMinedChains = mergeMinedChains.size();
         dirty = retval = true;
 
         // if we get to 0, give the thread a kick to stop waiting for mining
@@ -671,6 +672,7 @@ bool CConnectedChains::AddMergedBlock(CPBaaSMergeMinedChainData &blkData)
         //printf("AddMergedBlock name: %s, ID: %s\n", blkData.chainDefinition.name.c_str(), cID.GetHex().c_str());
 
         mergeMinedTargets.insert(make_pair(target, &(mergeMinedChains.insert(make_pair(cID, blkData)).first->second)));
+        numMergeMinedChains = mergeMinedChains.size();
         dirty = true;
     }
     return true;
@@ -706,14 +708,28 @@ CPBaaSMergeMinedChainData *CConnectedChains::GetChainInfo(uint160 chainID)
 void CConnectedChains::QueueNewBlockHeader(CBlockHeader &bh)
 {
     //printf("QueueNewBlockHeader %s\n", bh.GetHash().GetHex().c_str());
+    CBlockHeader *pbh = new CBlockHeader(bh);
+    if (!newQualifiedHeaders.push(pbh))
     {
+        // only if the submission thread is far behind
+        delete pbh;
         LOCK(cs_mergemining);
-
         qualifiedHeaders[UintToArith256(bh.GetHash())] = bh;
     }
     sem_submitthread.post();
 }
 
+void CConnectedChains::MoveQueuedHeaders()
+{
+    AssertLockHeld(cs_mergemining);
+    CBlockHeader *pbh;
+    while (newQualifiedHeaders.pop(pbh))
+    {
+        qualifiedHeaders[UintToArith256(pbh->GetHash())] = *pbh;
+        delete pbh;
+    }
+}
+
 void CConnectedChains::CheckImports()
 {
     sem_submitthread.post();
@@ -737,6 +753,8 @@ vector<pair<string, UniValue>> CConnectedChains::SubmitQualifiedBlocks()
         submissionFound = false;
         {
             LOCK(cs_mergemining);
+            MoveQueuedHeaders();
+
             // attempt to submit with the lowest hash answers first to increase the likelihood of submitting
             // common, merge mined headers for notarization, drop out on any submission
             for (auto headerIt = qualifiedHeaders.begin(); !submissionFound && headerIt != qualifiedHeaders.end(); headerIt = qualifiedHeaders.begin())
@@ -936,12 +954,18 @@ bool CConnectedChains::CheckVerusPBaaSAvailable()
         try
         {
             UniValue params(UniValue::VARR);
-            chainInfo = find_value(RPCCallRoot("getinfo", params), "result");
+            UniValue currencyParams(UniValue::VARR);
+            currencyParams.push_back(VERUS_CHAINNAME);
+
+            // one round trip for both
+            UniValue replies = RPCCallRootBatch({{"getinfo", params}, {"getcurrency", currencyParams}});
+            if (replies.isArray() && replies.size() == 2)
+            {
+                chainInfo = find_value(replies[0], "result");
+                chainDef = find_value(replies[1], "result");
+            }
             if (!chainInfo.isNull())
             {
-                params.push_back(VERUS_CHAINNAME);
-                chainDef = find_value(RPCCallRoot("getcurrency", params), "result");
-
                 if (!chainDef.isNull() && CheckVerusPBaaSAvailable(chainInfo, chainDef))
                 {
                     // if we have not past block 1 yet, store the best known update of our current state
@@ -1988,6 +2012,7 @@ void CConnectedChains::SubmissionThread()
                 bool submit = false;
                 {
                     LOCK(cs_mergemining);
+                    MoveQueuedHeaders();
                     if (mergeMinedChains.size() == 0 && qualifiedHeaders.size() != 0)
                     {
                         qualifiedHeaders.clear();
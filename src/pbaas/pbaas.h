@@ -25,7 +25,9 @@
 #include "pbaas/reserves.h"
 #include "mmr.h"
 
+#include <atomic>
 #include <boost/algorithm/string.hpp>
+#include <boost/lockfree/queue.hpp>
 
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex, bool fIncludeAsm=true);
 
@@ -859,14 +861,18 @@ public:
     CBlock earnedNotarizationBlock;
     int32_t earnedNotarizationIndex;            // index of earned notarization in block
 
-    bool dirty;
+    std::atomic<bool> dirty;                    // read by miners without the lock on every hashing round
+    std::atomic<uint32_t> numMergeMinedChains;  // size of mergeMinedChains, for the same reason
     bool lastSubmissionFailed;                  // if we submit a failed block, make another
     std::map<arith_uint256, CBlockHeader> qualifiedHeaders;
 
+    // headers found by miners, moved into qualifiedHeaders by the submission thread, so miners never wait for cs_mergemining
+    boost::lockfree::queue<CBlockHeader *, boost::lockfree::capacity<1024>> newQualifiedHeaders;
+
     CCriticalSection cs_mergemining;
     CSemaphore sem_submitthread;
 
-    CConnectedChains() : readyToStart(0), sem_submitthread(0), earnedNotarizationHeight(0), dirty(0), lastSubmissionFailed(0) {}
+    CConnectedChains() : readyToStart(0), sem_submitthread(0), earnedNotarizationHeight(0), dirty(0), numMergeMinedChains(0), lastSubmissionFailed(0) {}
 
     arith_uint256 LowestTarget()
     {
@@ -885,6 +891,7 @@ public:
     std::vector<std::pair<std::string, UniValue>> SubmitQualifiedBlocks();
 
     void QueueNewBlockHeader(CBlockHeader &bh);
+    void MoveQueuedHeaders();                   // call with cs_mergemining held
     void QueueEarnedNotarization(CBlock &blk, int32_t txIndex, int32_t height);
     void CheckImports();
     void SignAndCommitImportTransactions(const CTransaction &lastImportTx, const std::vector<CTransaction> &transactions);
@@ -14,6 +14,8 @@
 #include "pbaas/notarization.h"
 #include "rpc/server.h"
 #include "key_io.h"
+#include <atomic>
+#include <deque>
 #include <random>
 
 std::vector<uint160> *CTokenOutput::reserveIDs = nullptr;
@@ -1327,6 +1329,103 @@ CReserveTransactionDescriptor::CReserveTransactionDescriptor(const CTransaction
     }
 }
 
+/*
+ * Valid descriptors by txid and height. A descriptor only depends on the transaction, its inputs, which an outpoint
+ * fixes, and the height, which determines activation and fill or kill expiry. Currency definitions it looks up can
+ * change with the chain, so the cache is cleared whenever the tip changes or a block is disconnected.
+ */
+class CReserveDescriptorCache
+{
+    static const size_t MAX_ENTRIES = 10000;
+
+    CCriticalSection cs;
+    std::map<std::pair<uint256, int32_t>, CReserveTransactionDescriptor> mapDescriptors;
+    std::deque<std::pair<uint256, int32_t>> insertOrder;
+
+public:
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+    CReserveDescriptorCache() : nHits(0), nMisses(0) {}
+
+    bool Get(const std::pair<uint256, int32_t> &key, CReserveTransactionDescriptor &desc)
+    {
+        LOCK(cs);
+        auto it = mapDescriptors.find(key);
+        if (it == mapDescriptors.end())
+        {
+            return false;
+        }
+        desc = it->second;
+        return true;
+    }
+
+    void Add(const std::pair<uint256, int32_t> &key, const CReserveTransactionDescriptor &desc)
+    {
+        LOCK(cs);
+        if (mapDescriptors.insert(std::make_pair(key, desc)).second)
+        {
+            mapDescriptors[key].ptx = NULL;
+            insertOrder.push_back(key);
+            while (insertOrder.size() > MAX_ENTRIES)
+            {
+                mapDescriptors.erase(insertOrder.front());
+                insertOrder.pop_front();
+            }
+        }
+    }
+
+    void Clear()
+    {
+        LOCK(cs);
+        mapDescriptors.clear();
+        insertOrder.clear();
+    }
+
+    size_t Size()
+    {
+        LOCK(cs);
+        return mapDescriptors.size();
+    }
+};
+
+static CReserveDescriptorCache reserveDescriptorCache;
+
+CReserveTransactionDescriptor CReserveTransactionDescriptor::GetCached(const CTransaction &tx, const CCoinsViewCache &view, int32_t nHeight)
+{
+    std::pair<uint256, int32_t> key(tx.GetHash(), nHeight);
+    CReserveTransactionDescriptor desc;
+    if (reserveDescriptorCache.Get(key, desc))
+    {
+        reserveDescriptorCache.nHits++;
+        // the cached copy never holds a transaction pointer, it points to the caller's transaction
+        desc.ptx = &tx;
+        return desc;
+    }
+
+    reserveDescriptorCache.nMisses++;
+    desc = CReserveTransactionDescriptor(tx, view, nHeight);
+
+    // a descriptor built without all inputs available is not the one we will get once they are
+    if (desc.IsValid() && view.HaveInputs(tx))
+    {
+        reserveDescriptorCache.Add(key, desc);
+    }
+    return desc;
+}
+
+void CReserveTransactionDescriptor::ClearCache()
+{
+    reserveDescriptorCache.Clear();
+}
+
+void CReserveTransactionDescriptor::GetCacheStats(uint64_t &hits, uint64_t &misses, uint64_t &entries)
+{
+    hits = reserveDescriptorCache.nHits;
+    misses = reserveDescriptorCache.nMisses;
+    entries = reserveDescriptorCache.Size();
+}
+
 CReserveTransfer RefundExport(const CBaseChainObject *objPtr)
 {
     if (objPtr->objectType == CHAINOBJ_RESERVETRANSFER)
@@ -741,6 +741,12 @@ public:
 
     CReserveTransactionDescriptor(const CTransaction &tx, const CCoinsViewCache &view, int32_t nHeight);
 
+    // same as constructing a descriptor, but reuses a valid descriptor already built for this transaction and height,
+    // so a transaction is only described once on its way through the mempool, block template, and block connection
+    static CReserveTransactionDescriptor GetCached(const CTransaction &tx, const CCoinsViewCache &view, int32_t nHeight);
+    static void ClearCache();
+    static void GetCacheStats(uint64_t &hits, uint64_t &misses, uint64_t &entries);
+
     bool IsReject() const { return flags & IS_REJECT; }
     bool IsValid() const { return flags & IS_VALID && !IsReject(); }
     bool IsReserve() const { return IsValid() && flags & IS_RESERVE; }
@@ -0,0 +1,391 @@
+// Copyright (c) 2019 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_POOLEDMAP_H
+#define BITCOIN_POOLEDMAP_H
+
+#include "memusage.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * A hash map for large numbers of small entries, with the subset of the boost::unordered_map interface the
+ * coins cache uses.
+ *
+ * The table is open addressing with linear probing. Each slot holds only a 32 bit tag from the hash and the
+ * index of its entry, so probing stays within a few cache lines. Entries are placed in a pool of chunks and
+ * never move, so pointers and references to them, and iterators, which walk the pool, stay valid as other
+ * entries are added and removed. Erasing an entry leaves a marker in its slot and puts the entry on a free
+ * list, so erasing while iterating, as in map.erase(it++), is safe. The memory used is exactly the slot
+ * table, the pool chunks and the free list.
+ */
+template<typename K, typename T, typename Hash>
+class pooledmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    static const uint32_t SLOT_EMPTY = 0xffffffff;
+    static const uint32_t SLOT_DELETED = 0xfffffffe;
+    static const size_t NO_ENTRY = (size_t)-1;
+
+    // the first chunks double in size from MIN_CHUNK, so small maps stay small, then all are MAX_CHUNK
+    static const size_t MIN_CHUNK_BITS = 3;
+    static const size_t MAX_CHUNK_BITS = 10;
+    static const size_t GROWING_CHUNKS = MAX_CHUNK_BITS - MIN_CHUNK_BITS;
+    static const size_t GROWING_ENTRIES = ((size_t)1 << MAX_CHUNK_BITS) - ((size_t)1 << MIN_CHUNK_BITS);
+
+    struct slot
+    {
+        uint32_t tag;
+        uint32_t index;
+    };
+
+    struct chunk
+    {
+        value_type *values;             // constructed only where used is set
+        uint8_t *used;
+    };
+
+    Hash hasher;
+    std::vector<slot> slots;            // a power of two in size, or empty
+    std::vector<chunk> chunks;
+    std::vector<uint32_t> freeIndexes;
+    size_t nSize;
+    size_t nDeleted;                    // slots with a deleted marker
+    size_t nAllocated;                  // entries in all chunks
+
+    static size_t ChunkBits(size_t c)
+    {
+        return c < GROWING_CHUNKS ? MIN_CHUNK_BITS + c : MAX_CHUNK_BITS;
+    }
+
+    static void Locate(size_t index, size_t &c, size_t &offset)
+    {
+        if (index < GROWING_ENTRIES)
+        {
+            // chunk c starts at (1 << (MIN_CHUNK_BITS + c)) - (1 << MIN_CHUNK_BITS)
+            size_t shifted = (index >> MIN_CHUNK_BITS) + 1;
+            c = 0;
+            while (shifted >>= 1)
+                c++;
+            offset = index - ((((size_t)1 << c) - 1) << MIN_CHUNK_BITS);
+        }
+        else
+        {
+            c = GROWING_CHUNKS + ((index - GROWING_ENTRIES) >> MAX_CHUNK_BITS);
+            offset = (index - GROWING_ENTRIES) & (((size_t)1 << MAX_CHUNK_BITS) - 1);
+        }
+    }
+
+    value_type *Entry(size_t index) const
+    {
+        size_t c, offset;
+        Locate(index, c, offset);
+        return chunks[c].values + offset;
+    }
+
+    void SetUsed(size_t index, bool fUsed)
+    {
+        size_t c, offset;
+        Locate(index, c, offset);
+        chunks[c].used[offset] = fUsed;
+    }
+
+    size_t NextUsed(size_t index) const
+    {
+        if (index >= nAllocated)
+            return NO_ENTRY;
+        size_t c, offset;
+        Locate(index, c, offset);
+        for (; index < nAllocated; c++, offset = 0)
+        {
+            size_t n = (size_t)1 << ChunkBits(c);
+            const uint8_t *used = chunks[c].used;
+            for (; offset < n && index < nAllocated; offset++, index++)
+            {
+                if (used[offset])
+                    return index;
+            }
+        }
+        return NO_ENTRY;
+    }
+
+    static uint32_t Tag(uint64_t hash)
+    {
+        return (uint32_t)(hash >> 32);
+    }
+
+    size_t FindSlot(const K &key) const
+    {
+        if (slots.empty())
+            return NO_ENTRY;
+        uint64_t hash = hasher(key);
+        uint32_t tag = Tag(hash);
+        size_t mask = slots.size() - 1;
+        for (size_t pos = hash & mask; ; pos = (pos + 1) & mask)
+        {
+            const slot &s = slots[pos];
+            if (s.index == SLOT_EMPTY)
+                return NO_ENTRY;
+            if (s.index != SLOT_DELETED && s.tag == tag && Entry(s.index)->first == key)
+                return pos;
+        }
+    }
+
+    void PlaceSlot(uint64_t hash, uint32_t index)
+    {
+        size_t mask = slots.size() - 1;
+        size_t pos = hash & mask;
+        while (slots[pos].index != SLOT_EMPTY && slots[pos].index != SLOT_DELETED)
+            pos = (pos + 1) & mask;
+        if (slots[pos].index == SLOT_DELETED)
+            nDeleted--;
+        slots[pos].tag = Tag(hash);
+        slots[pos].index = index;
+    }
+
+    void Rehash(size_t nSlots)
+    {
+        slot empty = {0, SLOT_EMPTY};
+        std::vector<slot>(nSlots, empty).swap(slots);
+        nDeleted = 0;
+        for (size_t i = NextUsed(0); i != NO_ENTRY; i = NextUsed(i + 1))
+            PlaceSlot(hasher(Entry(i)->first), i);
+    }
+
+    size_t AllocateEntry()
+    {
+        if (!freeIndexes.empty())
+        {
+            size_t index = freeIndexes.back();
+            freeIndexes.pop_back();
+            return index;
+        }
+        size_t c, offset;
+        Locate(nAllocated, c, offset);
+        if (c == chunks.size())
+        {
+            size_t n = (size_t)1 << ChunkBits(c);
+            chunk newChunk;
+            newChunk.values = (value_type *)malloc(n * sizeof(value_type));
+            newChunk.used = (uint8_t *)calloc(n, 1);
+            if (!newChunk.values || !newChunk.used)
+            {
+                free(newChunk.values);
+                free(newChunk.used);
+                throw std::bad_alloc();
+            }
+            chunks.push_back(newChunk);
+        }
+        assert(nAllocated < SLOT_DELETED);
+        return nAllocated++;
+    }
+
+public:
+    template <bool fConst>
+    class iter
+    {
+        friend class pooledmap;
+        typedef typename std::conditional<fConst, const pooledmap, pooledmap>::type map_type;
+        map_type *map;
+        size_t index;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename std::conditional<fConst, const typename pooledmap::value_type, typename pooledmap::value_type>::type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef value_type *pointer;
+        typedef value_type &reference;
+
+        iter() : map(NULL), index(NO_ENTRY) {}
+        iter(map_type *m, size_t i) : map(m), index(i) {}
+        // iterators convert to const iterators
+        template <bool fOther, typename = typename std::enable_if<fConst && !fOther>::type>
+        iter(const iter<fOther> &other) : map(other.map), index(other.index) {}
+
+        reference operator*() const { return *map->Entry(index); }
+        pointer operator->() const { return map->Entry(index); }
+        iter &operator++() { index = map->NextUsed(index + 1); return *this; }
+        iter operator++(int) { iter copy(*this); ++(*this); return copy; }
+        bool operator==(const iter &other) const { return index == other.index; }
+        bool operator!=(const iter &other) const { return index != other.index; }
+
+        template <bool> friend class iter;
+    };
+
+    typedef iter<false> iterator;
+    typedef iter<true> const_iterator;
+
+    pooledmap() : nSize(0), nDeleted(0), nAllocated(0) {}
+    pooledmap(const pooledmap &other) : hasher(other.hasher), nSize(0), nDeleted(0), nAllocated(0)
+    {
+        for (const_iterator it = other.begin(); it != other.end(); it++)
+            insert(*it);
+    }
+    pooledmap &operator=(const pooledmap &other)
+    {
+        if (this != &other)
+        {
+            pooledmap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    ~pooledmap() { clear(); }
+
+    iterator begin() { return iterator(this, NextUsed(0)); }
+    iterator end() { return iterator(this, NO_ENTRY); }
+    const_iterator begin() const { return const_iterator(this, NextUsed(0)); }
+    const_iterator end() const { return const_iterator(this, NO_ENTRY); }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    iterator find(const K &key)
+    {
+        size_t pos = FindSlot(key);
+        return iterator(this, pos == NO_ENTRY ? NO_ENTRY : slots[pos].index);
+    }
+
+    const_iterator find(const K &key) const
+    {
+        size_t pos = FindSlot(key);
+        return const_iterator(this, pos == NO_ENTRY ? NO_ENTRY : slots[pos].index);
+    }
+
+    size_t count(const K &key) const
+    {
+        return FindSlot(key) == NO_ENTRY ? 0 : 1;
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value)
+    {
+        size_t pos = FindSlot(value.first);
+        if (pos != NO_ENTRY)
+            return std::make_pair(iterator(this, slots[pos].index), false);
+
+        // keep at least a quarter of the slots empty, growing if over half are in use
+        if ((nSize + nDeleted + 1) * 4 > slots.size() * 3)
+        {
+            size_t nSlots = slots.empty() ? ((size_t)1 << MIN_CHUNK_BITS) * 2 : slots.size();
+            while ((nSize + 1) * 2 > nSlots)
+                nSlots *= 2;
+            Rehash(nSlots);
+        }
+
+        size_t index = AllocateEntry();
+        try {
+            new (Entry(index)) value_type(value);
+        } catch (...) {
+            freeIndexes.push_back(index);
+            throw;
+        }
+        SetUsed(index, true);
+        PlaceSlot(hasher(value.first), index);
+        nSize++;
+        return std::make_pair(iterator(this, index), true);
+    }
+
+    T &operator[](const K &key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            it = insert(value_type(key, T())).first;
+        return it->second;
+    }
+
+    void erase(const_iterator it)
+    {
+        size_t pos = FindSlot(it->first);
+        assert(pos != NO_ENTRY && slots[pos].index == it.index);
+        slots[pos].index = SLOT_DELETED;
+        nDeleted++;
+        Entry(it.index)->~value_type();
+        SetUsed(it.index, false);
+        freeIndexes.push_back(it.index);
+        nSize--;
+    }
+
+    size_t erase(const K &key)
+    {
+        const_iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    //! remove all entries and release all memory
+    void clear()
+    {
+        for (size_t c = 0; c < chunks.size(); c++)
+        {
+            size_t n = (size_t)1 << ChunkBits(c);
+            for (size_t i = 0; i < n; i++)
+            {
+                if (chunks[c].used[i])
+                    chunks[c].values[i].~value_type();
+            }
+            free(chunks[c].values);
+            free(chunks[c].used);
+        }
+        std::vector<chunk>().swap(chunks);
+        std::vector<slot>().swap(slots);
+        std::vector<uint32_t>().swap(freeIndexes);
+        nSize = 0;
+        nDeleted = 0;
+        nAllocated = 0;
+    }
+
+    void swap(pooledmap &other)
+    {
+        std::swap(hasher, other.hasher);
+        slots.swap(other.slots);
+        chunks.swap(other.chunks);
+        freeIndexes.swap(other.freeIndexes);
+        std::swap(nSize, other.nSize);
+        std::swap(nDeleted, other.nDeleted);
+        std::swap(nAllocated, other.nAllocated);
+    }
+
+    //! the memory allocated by the map itself, not including memory owned by the entries
+    size_t DynamicMemoryUsage() const
+    {
+        size_t usage = memusage::MallocUsage(slots.capacity() * sizeof(slot)) +
+                       memusage::MallocUsage(chunks.capacity() * sizeof(chunk)) +
+                       memusage::MallocUsage(freeIndexes.capacity() * sizeof(uint32_t));
+        for (size_t c = 0; c < chunks.size(); c++)
+        {
+            size_t n = (size_t)1 << ChunkBits(c);
+            usage += memusage::MallocUsage(n * sizeof(value_type)) + memusage::MallocUsage(n);
+        }
+        return usage;
+    }
+};
+
+namespace memusage
+{
+
+template<typename K, typename T, typename Hash>
+static inline size_t DynamicUsage(const pooledmap<K, T, Hash>& m)
+{
+    return m.DynamicMemoryUsage();
+}
+
+}
+
+#endif // BITCOIN_POOLEDMAP_H
@@ -524,41 +524,78 @@ BlockMMRange CBlock::GetBlockMMRTree() const
     return BuildBlockMMRTree();
 }
 
-CPartialTransactionProof CBlock::GetPartialTransactionProof(const CTransaction &tx, int txIndex, const std::vector<std::pair<int16_t, int16_t>> &partIndexes) const
+bool CBlock::GetTransactionProofs(const std::vector<int> &txIndexes, std::vector<CMMRProof> &txProofs) const
 {
-    std::vector<CTransactionComponentProof> components;
+    txProofs.clear();
+    txProofs.reserve(txIndexes.size());
 
     if (IsPBaaS() != 0)
     {
-        // make a partial transaction proof for the export opret only
         BlockMMRange blockMMR(BuildBlockMMRTree());
         BlockMMView blockMMV(blockMMR);
-        CMMRProof txProof;
 
-        if (!blockMMV.GetProof(txProof, txIndex))
+        for (int txIndex : txIndexes)
+        {
+            txProofs.push_back(CMMRProof());
+            if (!blockMMV.GetProof(txProofs.back(), txIndex))
+            {
+                LogPrintf("%s: Cannot make transaction proof in block\n", __func__);
+                return false;
+            }
+        }
+    }
+    else
+    {
+        if (vMerkleTree.empty())
+            BuildMerkleTree();
+        for (int txIndex : txIndexes)
         {
-            LogPrintf("%s: Cannot make transaction proof in block\n", __func__);
-            printf("%s: Cannot make transaction proof in block\n", __func__);
-            return CPartialTransactionProof();
+            if (txIndex < 0 || txIndex >= (int)vtx.size())
+            {
+                LogPrintf("%s: Cannot make transaction proof in block\n", __func__);
+                return false;
+            }
+            txProofs.push_back(CMMRProof() << CMerkleBranch<CHashWriter>(txIndex, ::GetMerkleBranch(txIndex, vtx.size(), vMerkleTree)));
         }
+    }
+    return true;
+}
 
+CPartialTransactionProof CBlock::MakePartialTransactionProof(bool isPBaaS,
+                                                             const CMMRProof &txProof,
+                                                             const CTransaction &tx,
+                                                             const std::vector<std::pair<int16_t, int16_t>> &partIndexes)
+{
+    if (isPBaaS)
+    {
+        // prove only the requested parts of the transaction
+        std::vector<CTransactionComponentProof> components;
         CTransactionMap txMap(tx);
         TransactionMMView txMMV(txMap.transactionMMR);
-        
+
         for (auto &partIdx : partIndexes)
         {
             components.push_back(CTransactionComponentProof(txMMV, txMap, tx, partIdx.first, partIdx.second));
         }
-
         return CPartialTransactionProof(txProof, components);
     }
     else
     {
         // make a proof of the whole transaction
-        CMMRProof exportProof = CMMRProof() << CMerkleBranch<CHashWriter>(txIndex, GetMerkleBranch(txIndex));
-        return CPartialTransactionProof(exportProof, tx);
+        return CPartialTransactionProof(txProof, tx);
+    }
+}
+
+CPartialTransactionProof CBlock::GetPartialTransactionProof(const CTransaction &tx, int txIndex, const std::vector<std::pair<int16_t, int16_t>> &partIndexes) const
+{
+    std::vector<CMMRProof> txProofs;
+    if (!GetTransactionProofs(std::vector<int>({txIndex}), txProofs))
+    {
+        printf("%s: Cannot make transaction proof in block\n", __func__);
+        return CPartialTransactionProof();
     }
-}            
+    return MakePartialTransactionProof(IsPBaaS() != 0, txProofs[0], tx, partIndexes);
+}
 
 
 std::vector<uint256> GetMerkleBranch(int nIndex, int nLeaves, const std::vector<uint256> &vMerkleTree)
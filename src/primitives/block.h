@@ -466,6 +466,16 @@ public:
 
     CPartialTransactionProof GetPartialTransactionProof(const CTransaction &tx, int txIndex, const std::vector<std::pair<int16_t, int16_t>> &partIndexes) const;
 
+    // proofs of several transactions in this block, building the block's MMR or merkle tree only once
+    bool GetTransactionProofs(const std::vector<int> &txIndexes, std::vector<CMMRProof> &txProofs) const;
+
+    // make a partial transaction proof from a proof of the transaction in its block, which may have been stored
+    // when the block was connected so that the proof can still be made once the block has been pruned
+    static CPartialTransactionProof MakePartialTransactionProof(bool isPBaaS,
+                                                                const CMMRProof &txProof,
+                                                                const CTransaction &tx,
+                                                                const std::vector<std::pair<int16_t, int16_t>> &partIndexes);
+
     std::vector<uint256> GetMerkleBranch(int nIndex) const;
     static uint256 CheckMerkleBranch(uint256 hash, const std::vector<uint256>& vMerkleBranch, int nIndex);
     std::string ToString() const;
@@ -0,0 +1,48 @@
+// Copyright (c) 2019 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_PROOFINDEX_H
+#define BITCOIN_PROOFINDEX_H
+
+#include "uint256.h"
+#include "mmr.h"
+#include "primitives/transaction.h"
+
+#include <vector>
+
+/**
+ * A transaction kept when its block is pruned, along with the proof of the transaction in its block. The
+ * chain MMR is stored in the block index and is never pruned, so this is all that is needed to keep making
+ * cross-chain proofs of the transaction once the raw block is gone.
+ */
+struct CRetainedTransaction {
+    uint256 blockHash;
+    int blockHeight;
+    uint32_t txIndex;                   // position of the transaction in its block
+    CMMRProof txProof;                  // proof in the block MMR, or merkle branch before PBaaS
+    CTransaction tx;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(blockHash);
+        READWRITE(blockHeight);
+        READWRITE(txIndex);
+        READWRITE(txProof);
+        READWRITE(tx);
+    }
+
+    CRetainedTransaction() : blockHeight(0), txIndex(0) {}
+    CRetainedTransaction(const uint256 &hash, int height, uint32_t index, const CMMRProof &proof, const CTransaction &transaction) :
+        blockHash(hash), blockHeight(height), txIndex(index), txProof(proof), tx(transaction) {}
+
+    bool IsNull() const {
+        return blockHash.IsNull();
+    }
+};
+
+typedef std::pair<uint256, CRetainedTransaction> CRetainedTransactionDbEntry;
+
+#endif // BITCOIN_PROOFINDEX_H
@@ -59,6 +59,7 @@ struct CCoin {
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern void blockToJSON(UniValueWriter& writer, const CBlock& block, const CBlockIndex* blockindex, bool txDetails);
 extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
@@ -206,6 +207,7 @@ static bool rest_block(HTTPRequest* req,
 
     CBlock block;
     CBlockIndex* pblockindex = NULL;
+    std::shared_ptr<const std::vector<unsigned char> > pRawBlock;
     {
         LOCK(cs_main);
         if (mapBlockIndex.count(hash) == 0)
@@ -215,12 +217,19 @@ static bool rest_block(HTTPRequest* req,
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), 1))
+        // binary and hex replies are the block as stored, so they don't need to decode it
+        if (rf == RF_BINARY || rf == RF_HEX)
+            pRawBlock = GetRawBlock(pblockindex, Params().MessageStart());
+
+        if (!pRawBlock && !ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), 1))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
     CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
+    if (pRawBlock)
+        ssBlock.write((const char *)pRawBlock->data(), pRawBlock->size());
+    else
+        ssBlock << block;
 
     switch (rf) {
     case RF_BINARY: {
@@ -238,8 +247,10 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        string strJSON = objBlock.write() + "\n";
+        string strJSON;
+        UniValueWriter writer(strJSON);
+        blockToJSON(writer, block, pblockindex, showTxDetails);
+        strJSON += "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strJSON);
         return true;
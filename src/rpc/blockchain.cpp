@@ -127,7 +127,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("finalsaplingroot", blockindex->hashFinalSaplingRoot.GetHex()));
     result.push_back(Pair("time", (int64_t)blockindex->nTime));
     result.push_back(Pair("nonce", blockindex->nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(blockindex->nSolution)));
+    result.push_back(Pair("solution", HexStr(blockindex->GetSolution())));
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->chainPower.chainWork.GetHex()));
@@ -262,9 +262,46 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+static void blockTxsToJSON(UniValue& result, const CBlock& block, bool txDetails)
+{
+    UniValue txs(UniValue::VARR);
+    BOOST_FOREACH(const CTransaction&tx, block.vtx)
+    {
+        if(txDetails)
+        {
+            UniValue objTx(UniValue::VOBJ);
+            TxToJSON(tx, uint256(), objTx);
+            txs.push_back(objTx);
+        }
+        else
+            txs.push_back(tx.GetHash().GetHex());
+    }
+    result.push_back(Pair("tx", txs));
+}
+
+static void blockTxsToJSON(UniValueWriter& result, const CBlock& block, bool txDetails)
+{
+    // only one transaction is held as a tree at a time
+    result.key("tx");
+    result.beginArray();
+    BOOST_FOREACH(const CTransaction&tx, block.vtx)
+    {
+        if(txDetails)
+        {
+            UniValue objTx(UniValue::VOBJ);
+            TxToJSON(tx, uint256(), objTx);
+            result.push_back(objTx);
+        }
+        else
+            result.push_back(tx.GetHash().GetHex());
+    }
+    result.endArray();
+}
+
+// Result is a UniValue object being built, or a UniValueWriter inside an object
+template <typename Result>
+static void blockFieldsToJSON(Result& result, const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
 {
-    UniValue result(UniValue::VOBJ);
     int32_t height = blockindex->GetHeight();
     result.push_back(Pair("hash", block.GetHash().GetHex()));
     if (block.IsVerusPOSBlock())
@@ -320,19 +357,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
     result.push_back(Pair("segid", (int64_t)blockindex->segid));
     result.push_back(Pair("finalsaplingroot", block.hashFinalSaplingRoot.GetHex()));
-    UniValue txs(UniValue::VARR);
-    BOOST_FOREACH(const CTransaction&tx, block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx.GetHash().GetHex());
-    }
-    result.push_back(Pair("tx", txs));
+    blockTxsToJSON(result, block, txDetails);
     result.push_back(Pair("time", block.GetBlockTime()));
     result.push_back(Pair("nonce", block.nNonce.GetHex()));
     result.push_back(Pair("solution", HexStr(block.nSolution)));
@@ -353,9 +378,22 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    UniValue result(UniValue::VOBJ);
+    blockFieldsToJSON(result, block, blockindex, txDetails);
     return result;
 }
 
+void blockToJSON(UniValueWriter& writer, const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
+{
+    writer.beginObject();
+    blockFieldsToJSON(writer, block, blockindex, txDetails);
+    writer.endObject();
+}
+
 UniValue getblockcount(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -426,6 +464,33 @@ bool myIsutxo_spentinmempool(uint256 txid,int32_t vout)
     return(false);
 }
 
+static UniValue mempoolEntryToJSON(const CTxMemPoolEntry& e)
+{
+    UniValue info(UniValue::VOBJ);
+    info.push_back(Pair("size", (int)e.GetTxSize()));
+    info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
+    info.push_back(Pair("time", e.GetTime()));
+    info.push_back(Pair("height", (int)e.GetHeight()));
+    info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
+    info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
+    const CTransaction& tx = e.GetTx();
+    set<string> setDepends;
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    {
+        if (mempool.exists(txin.prevout.hash))
+            setDepends.insert(txin.prevout.hash.ToString());
+    }
+
+    UniValue depends(UniValue::VARR);
+    BOOST_FOREACH(const string& dep, setDepends)
+    {
+        depends.push_back(dep);
+    }
+
+    info.push_back(Pair("depends", depends));
+    return info;
+}
+
 UniValue mempoolToJSON(bool fVerbose = false)
 {
     if (fVerbose)
@@ -434,30 +499,7 @@ UniValue mempoolToJSON(bool fVerbose = false)
         UniValue o(UniValue::VOBJ);
         BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
         {
-            const uint256& hash = e.GetTx().GetHash();
-            UniValue info(UniValue::VOBJ);
-            info.push_back(Pair("size", (int)e.GetTxSize()));
-            info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
-            info.push_back(Pair("time", e.GetTime()));
-            info.push_back(Pair("height", (int)e.GetHeight()));
-            info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
-            const CTransaction& tx = e.GetTx();
-            set<string> setDepends;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
-            {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
-            }
-
-            UniValue depends(UniValue::VARR);
-            BOOST_FOREACH(const string& dep, setDepends)
-            {
-                depends.push_back(dep);
-            }
-
-            info.push_back(Pair("depends", depends));
-            o.push_back(Pair(hash.ToString(), info));
+            o.push_back(Pair(e.GetTx().GetHash().ToString(), mempoolEntryToJSON(e)));
         }
         return o;
     }
@@ -515,6 +557,34 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
     return mempoolToJSON(fVerbose);
 }
 
+void getrawmempool_stream(const UniValue& params, UniValueWriter& writer)
+{
+    if (params.size() > 1)
+        getrawmempool(params, true);        // throws the usage message
+
+    LOCK(cs_main);
+
+    bool fVerbose = false;
+    if (params.size() > 0)
+        fVerbose = params[0].get_bool();
+
+    if (!fVerbose)
+    {
+        writer.value(mempoolToJSON(false));
+        return;
+    }
+
+    {
+        LOCK(mempool.cs);
+        writer.beginObject();
+        BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+        {
+            writer.pushKV(e.GetTx().GetHash().ToString(), mempoolEntryToJSON(e));
+        }
+        writer.endObject();
+    }
+}
+
 UniValue getblockdeltas(const UniValue& params, bool fHelp)
 {
     std::string enableArg = "insightexplorer";
@@ -767,6 +837,62 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     return blockheaderToJSON(pblockindex);
 }
 
+// Read the block requested by getblock, returning the verbosity. requires LOCK(cs_main)
+static int ReadBlockForRPC(const UniValue& params, CBlock& block, CBlockIndex*& pblockindex)
+{
+    std::string strHash = params[0].get_str();
+
+    // If height is supplied, find the hash
+    if (strHash.size() < (2 * sizeof(uint256))) {
+        // std::stoi allows characters, whereas we want to be strict
+        regex r("[[:digit:]]+");
+        if (!regex_match(strHash, r)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        int nHeight = -1;
+        try {
+            nHeight = std::stoi(strHash);
+        }
+        catch (const std::exception &e) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        if (nHeight < 0 || nHeight > chainActive.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+    }
+
+    uint256 hash(uint256S(strHash));
+
+    int verbosity = 1;
+    if (params.size() > 1) {
+        if(params[1].isNum()) {
+            verbosity = params[1].get_int();
+        } else {
+            verbosity = params[1].get_bool() ? 1 : 0;
+        }
+    }
+
+    if (verbosity < 0 || verbosity > 2) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
+    }
+
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    pblockindex = mapBlockIndex[hash];
+
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+
+    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), 1))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
+    return verbosity;
+}
+
 UniValue getblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -817,66 +943,41 @@ UniValue getblock(const UniValue& params, bool fHelp)
 
     LOCK(cs_main);
 
-    std::string strHash = params[0].get_str();
-
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        // std::stoi allows characters, whereas we want to be strict
-        regex r("[[:digit:]]+");
-        if (!regex_match(strHash, r)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        int nHeight = -1;
-        try {
-            nHeight = std::stoi(strHash);
-        }
-        catch (const std::exception &e) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
+    CBlock block;
+    CBlockIndex* pblockindex;
+    int verbosity = ReadBlockForRPC(params, block, pblockindex);
 
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
-        }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+    if (verbosity == 0)
+    {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        ssBlock << block;
+        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+        return strHex;
     }
 
-    uint256 hash(uint256S(strHash));
-
-    int verbosity = 1;
-    if (params.size() > 1) {
-        if(params[1].isNum()) {
-            verbosity = params[1].get_int();
-        } else {
-            verbosity = params[1].get_bool() ? 1 : 0;
-        }
-    }
+    return blockToJSON(block, pblockindex, verbosity >= 2);
+}
 
-    if (verbosity < 0 || verbosity > 2) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
-    }
+void getblock_stream(const UniValue& params, UniValueWriter& writer)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getblock(params, true);             // throws the usage message
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    LOCK(cs_main);
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
-
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), 1))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    CBlockIndex* pblockindex;
+    int verbosity = ReadBlockForRPC(params, block, pblockindex);
 
     if (verbosity == 0)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
         ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        writer.value(HexStr(ssBlock.begin(), ssBlock.end()));
+        return;
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    blockToJSON(writer, block, pblockindex, verbosity >= 2);
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -1497,6 +1598,93 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     return obj;
 }
 
+UniValue getdbstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns the tuning profile, access counters and LevelDB internal statistics of each open database.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"name\",              (string) the tuning profile name of the database\n"
+            "    \"path\": \"path\",              (string) location of the database\n"
+            "    \"profile\": {...},               (object) block size, restart interval, bloom bits, compression and cache split\n"
+            "    \"blockcachesize\": n,            (numeric) block cache capacity in bytes\n"
+            "    \"writebuffersize\": n,           (numeric) write buffer size in bytes\n"
+            "    \"reads\": n,                     (numeric) point reads since startup\n"
+            "    \"readmisses\": n,                (numeric) point reads of keys that were not found\n"
+            "    \"batches\": n,                   (numeric) write batches since startup\n"
+            "    \"batchbytes\": n,                (numeric) approximate bytes written in batches\n"
+            "    \"blockcachehits\": n,            (numeric) block cache hits\n"
+            "    \"blockcachemisses\": n,          (numeric) block cache misses\n"
+            "    \"blockcachehitrate\": x.xxx,     (numeric) fraction of block cache lookups that hit\n"
+            "    \"readamplification\": n,         (numeric) tables a point read may need to check, one for each level 0 file and non-empty deeper level\n"
+            "    \"levels\": [                     (array) one entry for each non-empty level\n"
+            "      {\n"
+            "        \"level\": n, \"files\": n, \"sizemb\": x.x,\n"
+            "        \"compactionsec\": x.x, \"compactionreadmb\": x.x, \"compactionwritemb\": x.x\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (auto &stats : GetAllDBStats())
+    {
+        UniValue db(UniValue::VOBJ);
+        db.push_back(Pair("name", stats.name));
+        db.push_back(Pair("path", stats.path));
+
+        UniValue profile(UniValue::VOBJ);
+        profile.push_back(Pair("blocksize", (uint64_t)stats.profile.nBlockSize));
+        profile.push_back(Pair("restartinterval", stats.profile.nBlockRestartInterval));
+        profile.push_back(Pair("bloombits", stats.profile.nBloomBits));
+        profile.push_back(Pair("compression", stats.profile.fCompression));
+        profile.push_back(Pair("blockcachepct", stats.profile.nBlockCachePercent));
+        profile.push_back(Pair("writebufferpct", stats.profile.nWriteBufferPercent));
+        profile.push_back(Pair("maxopenfiles", stats.profile.nMaxOpenFiles));
+        db.push_back(Pair("profile", profile));
+
+        db.push_back(Pair("blockcachesize", (uint64_t)stats.nBlockCacheSize));
+        db.push_back(Pair("writebuffersize", (uint64_t)stats.nWriteBufferSize));
+        db.push_back(Pair("reads", stats.nReads));
+        db.push_back(Pair("readmisses", stats.nReadMisses));
+        db.push_back(Pair("batches", stats.nBatches));
+        db.push_back(Pair("batchbytes", stats.nBatchBytes));
+        db.push_back(Pair("blockcachehits", stats.nBlockCacheHits));
+        db.push_back(Pair("blockcachemisses", stats.nBlockCacheMisses));
+        uint64_t lookups = stats.nBlockCacheHits + stats.nBlockCacheMisses;
+        db.push_back(Pair("blockcachehitrate", lookups ? (double)stats.nBlockCacheHits / lookups : 0.0));
+
+        int readAmplification = 0;
+        UniValue levels(UniValue::VARR);
+        for (auto &level : stats.levels)
+        {
+            UniValue levelObj(UniValue::VOBJ);
+            levelObj.push_back(Pair("level", level.nLevel));
+            levelObj.push_back(Pair("files", level.nFiles));
+            levelObj.push_back(Pair("sizemb", level.sizeMB));
+            levelObj.push_back(Pair("compactionsec", level.compactionSeconds));
+            levelObj.push_back(Pair("compactionreadmb", level.compactionReadMB));
+            levelObj.push_back(Pair("compactionwritemb", level.compactionWriteMB));
+            levels.push_back(levelObj);
+            if (level.nFiles)
+            {
+                readAmplification += level.nLevel == 0 ? level.nFiles : 1;
+            }
+        }
+        db.push_back(Pair("readamplification", readAmplification));
+        db.push_back(Pair("levels", levels));
+        ret.push_back(db);
+    }
+    return ret;
+}
+
 /** Comparison function for sorting the getchaintips heads.  */
 struct CompareBlocksByHeight
 {
@@ -1619,6 +1807,27 @@ UniValue mempoolInfoToJSON()
         ret.push_back(Pair("fullyNotified", mempool.IsFullyNotified()));
     }
 
+    CTxRelayStats relayStats;
+    GetTxRelayStats(relayStats);
+    UniValue relay(UniValue::VOBJ);
+    relay.push_back(Pair("prechecked", relayStats.nPrechecked));
+    relay.push_back(Pair("precheckfailed", relayStats.nPrecheckFailed));
+    relay.push_back(Pair("avgprecheckms", relayStats.nPrechecked ? 0.001 * relayStats.nPrecheckMicros / relayStats.nPrechecked : 0.0));
+    relay.push_back(Pair("accepts", relayStats.nAccepts));
+    relay.push_back(Pair("avgacceptms", relayStats.nAccepts ? 0.001 * relayStats.nAcceptMicros / relayStats.nAccepts : 0.0));
+    relay.push_back(Pair("queued", relayStats.nQueued));
+    relay.push_back(Pair("precheckpending", relayStats.nPrecheckPending));
+    relay.push_back(Pair("queuedpeers", relayStats.nQueuedPeers));
+    ret.push_back(Pair("relayvalidation", relay));
+
+    uint64_t descHits, descMisses, descEntries;
+    CReserveTransactionDescriptor::GetCacheStats(descHits, descMisses, descEntries);
+    UniValue descCache(UniValue::VOBJ);
+    descCache.push_back(Pair("hits", descHits));
+    descCache.push_back(Pair("misses", descMisses));
+    descCache.push_back(Pair("entries", descEntries));
+    ret.push_back(Pair("reservedescriptorcache", descCache));
+
     return ret;
 }
 
@@ -1633,6 +1842,21 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"relayvalidation\": {          (object) Validation of transactions relayed by peers\n"
+            "    \"prechecked\": xxxxx          (numeric) Transactions checked before taking the chain state lock\n"
+            "    \"precheckfailed\": xxxxx      (numeric) Transactions rejected by those checks\n"
+            "    \"avgprecheckms\": x.xxx       (numeric) Average time of those checks in milliseconds\n"
+            "    \"accepts\": xxxxx             (numeric) Relayed transactions processed under the chain state lock\n"
+            "    \"avgacceptms\": x.xxx         (numeric) Average time the chain state lock was held for them in milliseconds\n"
+            "    \"queued\": xxxxx              (numeric) Relayed transactions waiting to be prechecked or accepted\n"
+            "    \"precheckpending\": xxxxx     (numeric) Queued transactions not prechecked yet\n"
+            "    \"queuedpeers\": xxxxx         (numeric) Peers with queued transactions\n"
+            "  }\n"
+            "  \"reservedescriptorcache\": {   (object) Reuse of reserve transaction descriptors across mempool, mining and block connection\n"
+            "    \"hits\": xxxxx                (numeric) Descriptors found in the cache\n"
+            "    \"misses\": xxxxx              (numeric) Descriptors that had to be built\n"
+            "    \"entries\": xxxxx             (numeric) Descriptors currently cached\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmempoolinfo", "")
@@ -1725,15 +1949,16 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
+    { "blockchain",         "getblock",               &getblock,               true,  &getblock_stream },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  &getrawmempool_stream },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
     // insightexplorer
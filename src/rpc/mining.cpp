@@ -416,6 +416,23 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
             "  \"numthreads\": n            (numeric) Number of CPU threads mining\n"
             "  \"mergemining\": n           (numeric) Number of blockchains we are merge mining with\n"
             "  \"mergeminedchains\": []     (optional, list of names) Blockchain names that are being merge mined with this blockchain\n"
+            "  \"blocktemplates\": {         (object) Block templates used by the mining threads\n"
+            "    \"built\": n                (numeric) Templates built\n"
+            "    \"shared\": n               (numeric) Copies of an already built template handed to a mining thread\n"
+            "    \"avgbuildms\": x.xxx       (numeric) Average time to build a template in milliseconds\n"
+            "    \"avglockms\": x.xxx        (numeric) Average time cs_main and the mempool were locked while building in milliseconds\n"
+            "    \"validated\": n            (numeric) Templates and proposals checked by TestBlockValidity\n"
+            "    \"avgvalidatems\": x.xxx    (numeric) Average time to check a template in milliseconds\n"
+            "    \"reusedtxs\": n            (numeric) Transactions whose script and proof checks from mempool acceptance were reused\n"
+            "    \"checkedtxs\": n           (numeric) Transactions that were fully checked again\n"
+            "  }\n"
+            "  \"miningthreads\": {         (object) Work done by the local mining threads\n"
+            "    \"hashes\": [n, ...]        (array) Hashes computed by each mining thread\n"
+            "    \"templatems\": n           (numeric) Total time spent getting block templates in milliseconds\n"
+            "    \"hashingms\": n            (numeric) Total time spent hashing, excluding key generation, in milliseconds\n"
+            "    \"keygenms\": n             (numeric) Total time spent generating hash keys in milliseconds\n"
+            "    \"staleworkrate\": x.xxx    (numeric) Fraction of templates abandoned because a new block arrived\n"
+            "  }\n"
 #endif
             "}\n"
             "\nExamples:\n"
@@ -538,6 +555,40 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
         }
         obj.push_back(Pair("mergeminedchains", chainNames));
     }
+
+    CBlockTemplateStats templateStats;
+    GetBlockTemplateStats(templateStats);
+    UniValue templates(UniValue::VOBJ);
+    templates.push_back(Pair("built", templateStats.nBuilt));
+    templates.push_back(Pair("shared", templateStats.nShared));
+    templates.push_back(Pair("avgbuildms", templateStats.nBuilt ? 0.001 * templateStats.nBuildMicros / templateStats.nBuilt : 0.0));
+    templates.push_back(Pair("avglockms", templateStats.nBuilt ? 0.001 * templateStats.nLockMicros / templateStats.nBuilt : 0.0));
+    CTemplateValidationStats validationStats;
+    GetTemplateValidationStats(validationStats);
+    templates.push_back(Pair("validated", validationStats.nValidated));
+    templates.push_back(Pair("avgvalidatems", validationStats.nValidated ? 0.001 * validationStats.nValidateMicros / validationStats.nValidated : 0.0));
+    templates.push_back(Pair("reusedtxs", validationStats.nTxReused));
+    templates.push_back(Pair("checkedtxs", validationStats.nTxChecked));
+    obj.push_back(Pair("blocktemplates", templates));
+
+    uint64_t templateCount = 0, staleCount = 0, templateMicros = 0, hashingMicros = 0, keyMicros = 0;
+    UniValue threadHashes(UniValue::VARR);
+    for (auto &threadStats : GetMiningThreadStats())
+    {
+        threadHashes.push_back(threadStats.hashes);
+        templateCount += threadStats.templates;
+        staleCount += threadStats.staleTemplates;
+        templateMicros += threadStats.templateMicros;
+        hashingMicros += threadStats.hashingMicros;
+        keyMicros += threadStats.keyMicros;
+    }
+    UniValue miningThreads(UniValue::VOBJ);
+    miningThreads.push_back(Pair("hashes", threadHashes));
+    miningThreads.push_back(Pair("templatems", templateMicros / 1000));
+    miningThreads.push_back(Pair("hashingms", (hashingMicros - std::min(keyMicros, hashingMicros)) / 1000));
+    miningThreads.push_back(Pair("keygenms", keyMicros / 1000));
+    miningThreads.push_back(Pair("staleworkrate", templateCount ? (double)staleCount / templateCount : 0.0));
+    obj.push_back(Pair("miningthreads", miningThreads));
 #endif
     return obj;
 }
@@ -1413,6 +1413,75 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
     return result;
 }
 
+// Parse the arguments of getaddressutxos and look up the outputs, sorted by height
+static void getAddressUtxosForRPC(const UniValue& params, bool& includeChainInfo,
+                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs)
+{
+    includeChainInfo = false;
+    if (params[0].isObject()) {
+        UniValue chainInfo = find_value(params[0].get_obj(), "chainInfo");
+        if (chainInfo.isBool()) {
+            includeChainInfo = chainInfo.get_bool();
+        }
+    }
+
+    std::vector<std::pair<uint160, int> > addresses;
+
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+}
+
+static UniValue addressUtxoToJSON(const std::pair<CAddressUnspentKey, CAddressUnspentValue>& utxo)
+{
+    UniValue output(UniValue::VOBJ);
+    
+    std::string address = "";
+
+    if (utxo.second.script.IsPayToCryptoCondition())
+    {
+        txnouttype outType;
+        std::vector<CTxDestination> addresses;
+        int required;
+        if (ExtractDestinations(utxo.second.script, outType, addresses, required))
+        {
+            UniValue addressesUni(UniValue::VARR);
+            for (auto addr : addresses)
+            {
+                addressesUni.push_back(EncodeDestination(addr));
+                if (GetDestinationID(addr) == utxo.first.hashBytes)
+                {
+                    address = EncodeDestination(addr);
+                }
+            }
+            if (addressesUni.size() > 1)
+            {
+                output.push_back(Pair("addresses", addressesUni));
+            }
+        }
+    }
+    if (address == "" && !getAddressFromIndex(utxo.first.type, utxo.first.hashBytes, address)) 
+    {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    output.push_back(Pair("address", address));
+    output.push_back(Pair("txid", utxo.first.txhash.GetHex()));
+    output.push_back(Pair("outputIndex", (int)utxo.first.index));
+    output.push_back(Pair("script", HexStr(utxo.second.script.begin(), utxo.second.script.end())));
+    output.push_back(Pair("satoshis", utxo.second.satoshis));
+    output.push_back(Pair("height", utxo.second.blockHeight));
+    return output;
+}
+
 UniValue getaddressutxos(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1444,71 +1513,14 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
             );
 
-    bool includeChainInfo = false;
-    if (params[0].isObject()) {
-        UniValue chainInfo = find_value(params[0].get_obj(), "chainInfo");
-        if (chainInfo.isBool()) {
-            includeChainInfo = chainInfo.get_bool();
-        }
-    }
-
-    std::vector<std::pair<uint160, int> > addresses;
-
-    if (!getAddressesFromParams(params, addresses)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
-    }
-
+    bool includeChainInfo;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    getAddressUtxosForRPC(params, includeChainInfo, unspentOutputs);
 
     UniValue utxos(UniValue::VARR);
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
-        UniValue output(UniValue::VOBJ);
-        
-        std::string address = "";
-
-        if (it->second.script.IsPayToCryptoCondition())
-        {
-            txnouttype outType;
-            std::vector<CTxDestination> addresses;
-            int required;
-            if (ExtractDestinations(it->second.script, outType, addresses, required))
-            {
-                UniValue addressesUni(UniValue::VARR);
-                for (auto addr : addresses)
-                {
-                    addressesUni.push_back(EncodeDestination(addr));
-                    if (GetDestinationID(addr) == it->first.hashBytes)
-                    {
-                        address = EncodeDestination(addr);
-                    }
-                }
-                if (addressesUni.size() > 1)
-                {
-                    output.push_back(Pair("addresses", addressesUni));
-                }
-            }
-        }
-        if (address == "" && !getAddressFromIndex(it->first.type, it->first.hashBytes, address)) 
-        {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
-
-        output.push_back(Pair("address", address));
-        output.push_back(Pair("txid", it->first.txhash.GetHex()));
-        output.push_back(Pair("outputIndex", (int)it->first.index));
-        output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
-        output.push_back(Pair("satoshis", it->second.satoshis));
-        output.push_back(Pair("height", it->second.blockHeight));
-        utxos.push_back(output);
+        utxos.push_back(addressUtxoToJSON(*it));
     }
 
     if (includeChainInfo) {
@@ -1524,50 +1536,49 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
     }
 }
 
-UniValue getaddressdeltas(const UniValue& params, bool fHelp)
+void getaddressutxos_stream(const UniValue& params, UniValueWriter& writer)
 {
-    if (fHelp || params.size() != 1 || !params[0].isObject())
-        throw runtime_error(
-            "getaddressdeltas\n"
-            "\nReturns all changes for an address (requires addressindex to be enabled).\n"
-            "\nArguments:\n"
-            "{\n"
-            "  \"addresses\"\n"
-            "    [\n"
-            "      \"address\"  (string) The base58check encoded address\n"
-            "      ,...\n"
-            "    ]\n"
-            "  \"start\" (number) The start block height\n"
-            "  \"end\" (number) The end block height\n"
-            "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
-            "}\n"
-            "\nResult:\n"
-            "[\n"
-            "  {\n"
-            "    \"satoshis\"  (number) The difference of satoshis\n"
-            "    \"txid\"  (string) The related txid\n"
-            "    \"index\"  (number) The related input or output index\n"
-            "    \"height\"  (number) The block height\n"
-            "    \"address\"  (string) The base58check encoded address\n"
-            "  }\n"
-            "]\n"
-            "\nExamples:\n"
-            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
-            + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
-        );
+    if (params.size() != 1)
+        getaddressutxos(params, true);      // throws the usage message
 
+    bool includeChainInfo;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    getAddressUtxosForRPC(params, includeChainInfo, unspentOutputs);
 
+    if (includeChainInfo) {
+        writer.beginObject();
+        writer.key("utxos");
+    }
+
+    writer.beginArray();
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
+        writer.push_back(addressUtxoToJSON(*it));
+    }
+    writer.endArray();
+
+    if (includeChainInfo) {
+        LOCK(cs_main);
+        writer.push_back(Pair("hash", chainActive.LastTip()->GetBlockHash().GetHex()));
+        writer.push_back(Pair("height", (int)chainActive.Height()));
+        writer.endObject();
+    }
+}
+
+// Parse the arguments of getaddressdeltas and look up the deltas
+static void getAddressDeltasForRPC(const UniValue& params, int& start, int& end, bool& includeChainInfo,
+                                   std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex)
+{
     UniValue startValue = find_value(params[0].get_obj(), "start");
     UniValue endValue = find_value(params[0].get_obj(), "end");
 
     UniValue chainInfo = find_value(params[0].get_obj(), "chainInfo");
-    bool includeChainInfo = false;
+    includeChainInfo = false;
     if (chainInfo.isBool()) {
         includeChainInfo = chainInfo.get_bool();
     }
 
-    int start = 0;
-    int end = 0;
+    start = 0;
+    end = 0;
 
     if (startValue.isNum() && endValue.isNum()) {
         start = startValue.get_int();
@@ -1586,8 +1597,6 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
             if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
@@ -1599,45 +1608,95 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             }
         }
     }
+}
 
-    UniValue deltas(UniValue::VARR);
+static UniValue addressDeltaToJSON(const std::pair<CAddressIndexKey, CAmount>& entry)
+{
+    std::string address;
+    if (!getAddressFromIndex(entry.first.type, entry.first.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.push_back(Pair("satoshis", entry.second));
+    delta.push_back(Pair("txid", entry.first.txhash.GetHex()));
+    delta.push_back(Pair("index", (int)entry.first.index));
+    delta.push_back(Pair("blockindex", (int)entry.first.txindex));
+    delta.push_back(Pair("height", entry.first.blockHeight));
+    delta.push_back(Pair("address", address));
+    return delta;
+}
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
+// The "start" and "end" members of a getaddressdeltas result with chain info
+static void addressDeltasRangeToJSON(int start, int end, UniValue& startInfo, UniValue& endInfo)
+{
+    LOCK(cs_main);
 
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("satoshis", it->second));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("blockindex", (int)it->first.txindex));
-        delta.push_back(Pair("height", it->first.blockHeight));
-        delta.push_back(Pair("address", address));
-        deltas.push_back(delta);
+    if (start > chainActive.Height() || end > chainActive.Height()) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
     }
 
-    UniValue result(UniValue::VOBJ);
+    CBlockIndex* startIndex = chainActive[start];
+    CBlockIndex* endIndex = chainActive[end];
 
-    if (includeChainInfo && start > 0 && end > 0) {
-        LOCK(cs_main);
+    startInfo.setObject();
+    endInfo.setObject();
+
+    startInfo.push_back(Pair("hash", startIndex->GetBlockHash().GetHex()));
+    startInfo.push_back(Pair("height", start));
+
+    endInfo.push_back(Pair("hash", endIndex->GetBlockHash().GetHex()));
+    endInfo.push_back(Pair("height", end));
+}
+
+UniValue getaddressdeltas(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1 || !params[0].isObject())
+        throw runtime_error(
+            "getaddressdeltas\n"
+            "\nReturns all changes for an address (requires addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\" (number) The start block height\n"
+            "  \"end\" (number) The end block height\n"
+            "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"satoshis\"  (number) The difference of satoshis\n"
+            "    \"txid\"  (string) The related txid\n"
+            "    \"index\"  (number) The related input or output index\n"
+            "    \"height\"  (number) The block height\n"
+            "    \"address\"  (string) The base58check encoded address\n"
+            "  }\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
+            + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
+        );
 
-        if (start > chainActive.Height() || end > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
-        }
 
-        CBlockIndex* startIndex = chainActive[start];
-        CBlockIndex* endIndex = chainActive[end];
+    int start, end;
+    bool includeChainInfo;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressDeltasForRPC(params, start, end, includeChainInfo, addressIndex);
 
-        UniValue startInfo(UniValue::VOBJ);
-        UniValue endInfo(UniValue::VOBJ);
+    UniValue deltas(UniValue::VARR);
 
-        startInfo.push_back(Pair("hash", startIndex->GetBlockHash().GetHex()));
-        startInfo.push_back(Pair("height", start));
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        deltas.push_back(addressDeltaToJSON(*it));
+    }
 
-        endInfo.push_back(Pair("hash", endIndex->GetBlockHash().GetHex()));
-        endInfo.push_back(Pair("height", end));
+    if (includeChainInfo && start > 0 && end > 0) {
+        UniValue result(UniValue::VOBJ);
+        UniValue startInfo, endInfo;
+        addressDeltasRangeToJSON(start, end, startInfo, endInfo);
 
         result.push_back(Pair("deltas", deltas));
         result.push_back(Pair("start", startInfo));
@@ -1649,6 +1708,37 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
     }
 }
 
+void getaddressdeltas_stream(const UniValue& params, UniValueWriter& writer)
+{
+    if (params.size() != 1 || !params[0].isObject())
+        getaddressdeltas(params, true);     // throws the usage message
+
+    int start, end;
+    bool includeChainInfo;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressDeltasForRPC(params, start, end, includeChainInfo, addressIndex);
+
+    bool fRange = includeChainInfo && start > 0 && end > 0;
+    if (fRange) {
+        writer.beginObject();
+        writer.key("deltas");
+    }
+
+    writer.beginArray();
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        writer.push_back(addressDeltaToJSON(*it));
+    }
+    writer.endArray();
+
+    if (fRange) {
+        UniValue startInfo, endInfo;
+        addressDeltasRangeToJSON(start, end, startInfo, endInfo);
+        writer.push_back(Pair("start", startInfo));
+        writer.push_back(Pair("end", endInfo));
+        writer.endObject();
+    }
+}
+
 UniValue getaddressbalance(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1904,8 +1994,8 @@ static const CRPCCommand commands[] =
     /* Address index */
     { "addressindex",       "getaddresstxids",        &getaddresstxids,        false }, /* insight explorer */
     { "addressindex",       "getaddressbalance",      &getaddressbalance,      false }, /* insight explorer */
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false }, /* insight explorer */
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false }, /* insight explorer */
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, &getaddressdeltas_stream }, /* insight explorer */
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false, &getaddressutxos_stream }, /* insight explorer */
     { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  }, /* insight explorer */
     { "blockchain",         "getspentinfo",           &getspentinfo,           false }, /* insight explorer */
     // END insightexplorer
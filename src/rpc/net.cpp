@@ -405,7 +405,15 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
-            "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"timemillis\": t,       (numeric) Total cpu time\n"
+            "  \"pingresponse\": {      (json object) Time from receiving a ping to queuing its pong\n"
+            "    \"count\": n,          (numeric) Pings answered\n"
+            "    \"fastpath\": n,       (numeric) Pings answered by the socket thread\n"
+            "    \"avgusec\": n,        (numeric) Average response time in microseconds\n"
+            "    \"medianusec\": n,     (numeric) Median response time, rounded up to a power of two\n"
+            "    \"p99usec\": n,        (numeric) 99th percentile response time, rounded up to a power of two\n"
+            "    \"maxusec\": n         (numeric) Longest response time\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getnettotals", "")
@@ -416,6 +424,16 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     obj.push_back(Pair("totalbytesrecv", CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent", CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis", GetTimeMillis()));
+
+    CPingResponseStats pingStats = CNode::GetPingResponseStats();
+    UniValue pingObj(UniValue::VOBJ);
+    pingObj.push_back(Pair("count", pingStats.nCount));
+    pingObj.push_back(Pair("fastpath", pingStats.nFastPath));
+    pingObj.push_back(Pair("avgusec", pingStats.nAvgUsec));
+    pingObj.push_back(Pair("medianusec", pingStats.nMedianUsec));
+    pingObj.push_back(Pair("p99usec", pingStats.nP99Usec));
+    pingObj.push_back(Pair("maxusec", pingStats.nMaxUsec));
+    obj.push_back(Pair("pingresponse", pingObj));
     return obj;
 }
 
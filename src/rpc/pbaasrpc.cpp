@@ -882,29 +882,21 @@ bool CConnectedChains::CreateLatestImports(const CCurrencyDefinition &currencyDe
             availableTokenInput = leftoverCurrency;
 
             // add a proof of the export transaction at the notarization height
-            CBlock block;
-            if (!ReadBlockFromDisk(block, chainActive[aixIt->second.first.blockHeight], Params().GetConsensus(), false))
-            {
-                LogPrintf("%s: POSSIBLE CORRUPTION cannot read block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
-                printf("%s: POSSIBLE CORRUPTION cannot read block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
-                return false;
-            }
-
             // prove ccx input 0, export output, and opret
             std::vector<std::pair<int16_t, int16_t>> parts({{CTransactionHeader::TX_HEADER, (int16_t)0},
                                                             {CTransactionHeader::TX_PREVOUTSEQ, (int16_t)0},
                                                             {CTransactionHeader::TX_OUTPUT, ccxOutputNum},
                                                             {CTransactionHeader::TX_OUTPUT, (int16_t)(aixIt->second.second.vout.size() - 1)}});
 
-            // prove our transaction up to the MMR root of the last transaction
-            CPartialTransactionProof exportProof = block.GetPartialTransactionProof(aixIt->second.second, aixIt->second.first.txindex, parts);
-            if (!exportProof.components.size())
+            // prove our transaction up to the MMR root of the last transaction, from the retained proof if the block is pruned
+            CPartialTransactionProof exportProof;
+            if (!GetPartialTransactionProof(chainActive[aixIt->second.first.blockHeight], aixIt->second.second, aixIt->second.first.txindex, parts, exportProof))
             {
                 LogPrintf("%s: could not create partial transaction proof in block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
                 printf("%s: could not create partial transaction proof in block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
                 return false;
             }
-            exportProof.txProof << block.MMRProofBridge();
+            exportProof.txProof << chainActive[aixIt->second.first.blockHeight]->MMRProofBridge();
 
             // TODO: don't include chain MMR proof for exports from the same chain
             ChainMerkleMountainView mmv(chainActive.GetMMR(), lastConfirmed.notarizationHeight);
@@ -2658,12 +2650,11 @@ UniValue getcrossnotarization(const UniValue& params, bool fHelp)
             uint256 preHash = mmv.mmr.GetNode(proofheight).hash;
 
             // prove the last notarization txid with new MMR, which also provides its blockhash and power as part of proof
-            CBlock block;
             CBlockIndex *pnindex = mapBlockIndex.find(blkHash)->second;
 
-            if(!pnindex || !ReadBlockFromDisk(block, pnindex, Params().GetConsensus(), 0))
+            if(!pnindex)
             {
-                throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't find block of prior notarization");
             }
 
             int32_t prevHeight = pnindex->GetHeight();
@@ -2737,7 +2728,11 @@ UniValue getcrossnotarization(const UniValue& params, bool fHelp)
                     }
                 }
             }
-            CPartialTransactionProof txProof = block.GetPartialTransactionProof(tx, txIndex, txComponents);
+            CPartialTransactionProof txProof;
+            if (!GetPartialTransactionProof(pnindex, tx, txIndex, txComponents, txProof))
+            {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't prove prior notarization, its block may be pruned without -pruneretain");
+            }
 
             // add the cross transaction from this chain to return
             CChainObject<CPartialTransactionProof> strippedTxObj(CHAINOBJ_TRANSACTION_PROOF, txProof);
@@ -4159,29 +4154,21 @@ bool RefundFailedLaunch(uint160 currencyID, CTransaction &lastImportTx, std::vec
                 }
 
                 // add a proof of the export transaction at the notarization height
-                CBlock block;
-                if (!ReadBlockFromDisk(block, chainActive[aixIt->second.first.blockHeight], Params().GetConsensus(), false))
-                {
-                    LogPrintf("%s: POSSIBLE CORRUPTION cannot read block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
-                    printf("%s: POSSIBLE CORRUPTION cannot read block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
-                    return false;
-                }
-
                 // prove ccx input 0, export output, and opret
                 std::vector<std::pair<int16_t, int16_t>> parts({{CTransactionHeader::TX_HEADER, (int16_t)0},
                                                                 {CTransactionHeader::TX_PREVOUTSEQ, (int16_t)0},
                                                                 {CTransactionHeader::TX_OUTPUT, ccxOutputNum},
                                                                 {CTransactionHeader::TX_OUTPUT, (int16_t)(aixIt->second.second.vout.size() - 1)}});
 
-                // prove our transaction up to the MMR root of the last transaction
-                CPartialTransactionProof exportProof = block.GetPartialTransactionProof(aixIt->second.second, aixIt->second.first.txindex, parts);
-                if (!exportProof.components.size())
+                // prove our transaction up to the MMR root of the last transaction, from the retained proof if the block is pruned
+                CPartialTransactionProof exportProof;
+                if (!GetPartialTransactionProof(chainActive[aixIt->second.first.blockHeight], aixIt->second.second, aixIt->second.first.txindex, parts, exportProof))
                 {
                     LogPrintf("%s: could not create partial transaction proof in block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
                     printf("%s: could not create partial transaction proof in block %s\n", __func__, chainActive[aixIt->second.first.blockHeight]->GetBlockHash().GetHex().c_str());
                     return false;
                 }
-                exportProof.txProof << block.MMRProofBridge();
+                exportProof.txProof << chainActive[aixIt->second.first.blockHeight]->MMRProofBridge();
 
                 // TODO: don't include chain MMR proof for exports from the same chain
                 ChainMerkleMountainView(chainActive.GetMMR(), nHeight).GetProof(exportProof.txProof, aixIt->second.first.blockHeight);
@@ -6041,6 +6028,32 @@ UniValue listidentities(const UniValue& params, bool fHelp)
     }
 }
 
+UniValue getcrosschainrpcstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+    {
+        throw runtime_error(
+            "getcrosschainrpcstats\n"
+            "\nReturns statistics of RPC calls this daemon has made to other daemons, such as its notary chain, by method.\n"
+
+            "\nResult:\n"
+            "   {\n"
+            "       \"method\": {\n"
+            "           \"calls\": n            (numeric) number of calls\n"
+            "           \"errors\": n           (numeric) calls that failed or returned an error\n"
+            "           \"avgms\": x.xxx        (numeric) average call latency in milliseconds\n"
+            "           \"latency\": {...}      (object) number of calls by latency range\n"
+            "       }, ...\n"
+            "   }\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getcrosschainrpcstats", "")
+            + HelpExampleRpc("getcrosschainrpcstats", "")
+        );
+    }
+    return GetRPCCallStats();
+}
+
 UniValue addmergedblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 5)
@@ -6547,7 +6560,8 @@ static const CRPCCommand commands[] =
     { "multichain",   "refundfailedlaunch",           &refundfailedlaunch,     true  },
     { "multichain",   "refundfailedlaunch",           &refundfailedlaunch,     true  },
     { "multichain",   "getmergedblocktemplate",       &getmergedblocktemplate, true  },
-    { "multichain",   "addmergedblock",               &addmergedblock,         true  }
+    { "multichain",   "addmergedblock",               &addmergedblock,         true  },
+    { "multichain",   "getcrosschainrpcstats",        &getcrosschainrpcstats,  true  }
 };
 
 void RegisterPBaaSRPCCommands(CRPCTable &tableRPC)
@@ -118,6 +118,7 @@ void RPCUnregisterTimerInterface(RPCTimerInterface *iface);
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds);
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
+typedef void(*rpcstreamfn_type)(const UniValue& params, UniValueWriter& writer);
 
 class CRPCCommand
 {
@@ -126,6 +127,11 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    rpcstreamfn_type streamActor;       // optional, writes large results without building them first
+
+    CRPCCommand(const std::string &categoryIn, const std::string &nameIn, rpcfn_type actorIn, bool okSafeModeIn,
+                rpcstreamfn_type streamActorIn = NULL) :
+        category(categoryIn), name(nameIn), actor(actorIn), okSafeMode(okSafeModeIn), streamActor(streamActorIn) {}
 };
 
 /**
@@ -149,6 +155,13 @@ public:
      */
     UniValue execute(const std::string &method, const UniValue &params) const;
 
+    /**
+     * Execute a method, writing its result. Methods with a streamActor write it directly,
+     * the result of any other method is written once it returns.
+     * @throws an exception (UniValue) when an error happens, the writer's output must then be discarded.
+     */
+    void execute(const std::string &method, const UniValue &params, UniValueWriter &writer) const;
+
 
     /**
      * Appends a CRPCCommand to the dispatch table.
@@ -190,7 +203,9 @@ extern std::string experimentalDisabledHelpMsg(const std::string& rpc, const std
 extern UniValue getconnectioncount(const UniValue& params, bool fHelp); // in rpcnet.cpp
 extern UniValue getaddressmempool(const UniValue& params, bool fHelp);
 extern UniValue getaddressutxos(const UniValue& params, bool fHelp);
+extern void getaddressutxos_stream(const UniValue& params, UniValueWriter& writer);
 extern UniValue getaddressdeltas(const UniValue& params, bool fHelp);
+extern void getaddressdeltas_stream(const UniValue& params, UniValueWriter& writer);
 extern UniValue getaddresstxids(const UniValue& params, bool fHelp);
 extern UniValue getsnapshot(const UniValue& params, bool fHelp);
 extern UniValue getaddressbalance(const UniValue& params, bool fHelp);
@@ -367,12 +382,15 @@ extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue settxfee(const UniValue& params, bool fHelp);
 extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
+extern void getrawmempool_stream(const UniValue& params, UniValueWriter& writer);
 extern UniValue getblockhashes(const UniValue& params, bool fHelp);
 extern UniValue getblockdeltas(const UniValue& params, bool fHelp);
 extern UniValue getblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblockheader(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
+extern void getblock_stream(const UniValue& params, UniValueWriter& writer);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp);
+extern UniValue getdbstats(const UniValue& params, bool fHelp);
 extern UniValue gettxout(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
 extern UniValue getchaintips(const UniValue& params, bool fHelp);
@@ -15,6 +15,8 @@
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 
+#include <mutex>
+
 using namespace std;
 
 CC *MakeCCcondMofN(const std::vector<CTxDestination> &dests, int M);
@@ -1166,8 +1168,100 @@ uint256 GetShieldedOutputsHash(const CTransaction& txTo) {
     return ss.GetHash();
 }
 
+// Everything in an Overwinter or Sapling signature hash that comes before the hash type. It depends
+// on the input being signed only for SIGHASH_SINGLE.
+void WriteSigHashPrefix(
+    CBLAKE2bWriter& ss,
+    const CTransaction& txTo,
+    unsigned int nIn,
+    int nHashType,
+    SigVersion sigversion,
+    const PrecomputedTransactionData* cache)
+{
+    uint256 hashPrevouts;
+    uint256 hashSequence;
+    uint256 hashOutputs;
+    uint256 hashJoinSplits;
+    uint256 hashShieldedSpends;
+    uint256 hashShieldedOutputs;
+
+    if (!(nHashType & SIGHASH_ANYONECANPAY)) {
+        hashPrevouts = cache ? cache->hashPrevouts : GetPrevoutHash(txTo);
+    }
+
+    if (!(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        hashSequence = cache ? cache->hashSequence : GetSequenceHash(txTo);
+    }
+
+    if ((nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        hashOutputs = cache ? cache->hashOutputs : GetOutputsHash(txTo);
+    } else if ((nHashType & 0x1f) == SIGHASH_SINGLE && nIn < txTo.vout.size()) {
+        CBLAKE2bWriter ss(SER_GETHASH, 0, ZCASH_OUTPUTS_HASH_PERSONALIZATION);
+        ss << txTo.vout[nIn];
+        hashOutputs = ss.GetHash();
+    }
+
+    if (!txTo.vJoinSplit.empty()) {
+        hashJoinSplits = cache ? cache->hashJoinSplits : GetJoinSplitsHash(txTo);
+    }
+
+    if (!txTo.vShieldedSpend.empty()) {
+        hashShieldedSpends = cache ? cache->hashShieldedSpends : GetShieldedSpendsHash(txTo);
+    }
+
+    if (!txTo.vShieldedOutput.empty()) {
+        hashShieldedOutputs = cache ? cache->hashShieldedOutputs : GetShieldedOutputsHash(txTo);
+    }
+
+    // Header
+    ss << txTo.GetHeader();
+    // Version group ID
+    ss << txTo.nVersionGroupId;
+    // Input prevouts/nSequence (none/all, depending on flags)
+    ss << hashPrevouts;
+    ss << hashSequence;
+    // Outputs (none/one/all, depending on flags)
+    ss << hashOutputs;
+    // JoinSplits
+    ss << hashJoinSplits;
+    if (sigversion == SIGVERSION_SAPLING) {
+        // Spend descriptions
+        ss << hashShieldedSpends;
+        // Output descriptions
+        ss << hashShieldedOutputs;
+    }
+    // Locktime
+    ss << txTo.nLockTime;
+    // Expiry height
+    ss << txTo.nExpiryHeight;
+    if (sigversion == SIGVERSION_SAPLING) {
+        // Sapling value balance
+        ss << txTo.valueBalance;
+    }
+}
+
 } // anon namespace
 
+class CSigHashMidstates
+{
+public:
+    // a transaction normally uses one or two hash types, so only a few are kept, which also bounds
+    // what a transaction with a different hash type on each signature can make us store
+    static const size_t MAX_MIDSTATES = 8;
+
+    struct CMidstate
+    {
+        uint32_t consensusBranchId;
+        int nHashType;
+        // the libsodium state is declared 64 byte aligned, which heap storage does not guarantee,
+        // so it is kept as bytes and copied in and out
+        unsigned char state[CBLAKE2bWriter::STATE_SIZE];
+    };
+
+    std::mutex cs;
+    std::vector<CMidstate> midstates;
+};
+
 PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
 {
     hashPrevouts = GetPrevoutHash(txTo);
@@ -1176,6 +1270,7 @@ PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
     hashJoinSplits = GetJoinSplitsHash(txTo);
     hashShieldedSpends = GetShieldedSpendsHash(txTo);
     hashShieldedOutputs = GetShieldedOutputsHash(txTo);
+    sigHashMidstates = std::make_shared<CSigHashMidstates>();
 }
 
 SigVersion SignatureHashVersion(const CTransaction& txTo)
@@ -1191,6 +1286,31 @@ SigVersion SignatureHashVersion(const CTransaction& txTo)
     }
 }
 
+void PrecomputedTransactionData::ResumeSigHash(CBLAKE2bWriter& ss, const CTransaction& txTo, int nHashType, uint32_t consensusBranchId) const
+{
+    assert((nHashType & 0x1f) != SIGHASH_SINGLE);
+
+    std::lock_guard<std::mutex> lock(sigHashMidstates->cs);
+    for (auto &midstate : sigHashMidstates->midstates)
+    {
+        if (midstate.nHashType == nHashType && midstate.consensusBranchId == consensusBranchId)
+        {
+            ss.RestoreState(midstate.state);
+            return;
+        }
+    }
+
+    WriteSigHashPrefix(ss, txTo, NOT_AN_INPUT, nHashType, SignatureHashVersion(txTo), this);
+    if (sigHashMidstates->midstates.size() < CSigHashMidstates::MAX_MIDSTATES)
+    {
+        CSigHashMidstates::CMidstate midstate;
+        midstate.consensusBranchId = consensusBranchId;
+        midstate.nHashType = nHashType;
+        ss.SaveState(midstate.state);
+        sigHashMidstates->midstates.push_back(midstate);
+    }
+}
+
 uint256 SignatureHash(
     const CScript& scriptCode,
     const CTransaction& txTo,
@@ -1208,71 +1328,18 @@ uint256 SignatureHash(
     auto sigversion = SignatureHashVersion(txTo);
 
     if (sigversion == SIGVERSION_OVERWINTER || sigversion == SIGVERSION_SAPLING) {
-        uint256 hashPrevouts;
-        uint256 hashSequence;
-        uint256 hashOutputs;
-        uint256 hashJoinSplits;
-        uint256 hashShieldedSpends;
-        uint256 hashShieldedOutputs;
-
-        if (!(nHashType & SIGHASH_ANYONECANPAY)) {
-            hashPrevouts = cache ? cache->hashPrevouts : GetPrevoutHash(txTo);
-        }
-
-        if (!(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
-            hashSequence = cache ? cache->hashSequence : GetSequenceHash(txTo);
-        }
-
-        if ((nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
-            hashOutputs = cache ? cache->hashOutputs : GetOutputsHash(txTo);
-        } else if ((nHashType & 0x1f) == SIGHASH_SINGLE && nIn < txTo.vout.size()) {
-            CBLAKE2bWriter ss(SER_GETHASH, 0, ZCASH_OUTPUTS_HASH_PERSONALIZATION);
-            ss << txTo.vout[nIn];
-            hashOutputs = ss.GetHash();
-        }
-
-        if (!txTo.vJoinSplit.empty()) {
-            hashJoinSplits = cache ? cache->hashJoinSplits : GetJoinSplitsHash(txTo);
-        }
-
-        if (!txTo.vShieldedSpend.empty()) {
-            hashShieldedSpends = cache ? cache->hashShieldedSpends : GetShieldedSpendsHash(txTo);
-        }
-
-        if (!txTo.vShieldedOutput.empty()) {
-            hashShieldedOutputs = cache ? cache->hashShieldedOutputs : GetShieldedOutputsHash(txTo);
-        }
-
         uint32_t leConsensusBranchId = htole32(consensusBranchId);
         unsigned char personalization[16] = {};
         memcpy(personalization, "ZcashSigHash", 12);
         memcpy(personalization+12, &leConsensusBranchId, 4);
 
         CBLAKE2bWriter ss(SER_GETHASH, 0, personalization);
-        // Header
-        ss << txTo.GetHeader();
-        // Version group ID
-        ss << txTo.nVersionGroupId;
-        // Input prevouts/nSequence (none/all, depending on flags)
-        ss << hashPrevouts;
-        ss << hashSequence;
-        // Outputs (none/one/all, depending on flags)
-        ss << hashOutputs;
-        // JoinSplits
-        ss << hashJoinSplits;
-        if (sigversion == SIGVERSION_SAPLING) {
-            // Spend descriptions
-            ss << hashShieldedSpends;
-            // Output descriptions
-            ss << hashShieldedOutputs;
-        }
-        // Locktime
-        ss << txTo.nLockTime;
-        // Expiry height
-        ss << txTo.nExpiryHeight;
-        if (sigversion == SIGVERSION_SAPLING) {
-            // Sapling value balance
-            ss << txTo.valueBalance;
+        // Everything up to the hash type is the same for all inputs signed with the same hash type,
+        // except with SIGHASH_SINGLE
+        if (cache && cache->sigHashMidstates && (nHashType & 0x1f) != SIGHASH_SINGLE) {
+            cache->ResumeSigHash(ss, txTo, nHashType, consensusBranchId);
+        } else {
+            WriteSigHashPrefix(ss, txTo, nIn, nHashType, sigversion, cache);
         }
         // Sighash type
         ss << nHashType;
@@ -1394,7 +1461,7 @@ std::map<uint160, pair<int, std::vector<std::vector<unsigned char>>>> BaseSignat
     return idAddresses;
 }
 
-TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL)
+TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL), idMapSet(false)
 {
     if (pScriptPubKeyIn && pKeyStore)
     {
@@ -1402,7 +1469,7 @@ TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txT
     }
 }
 
-TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL)
+TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(&txdataIn), idMapSet(false)
 {
     if (pScriptPubKeyIn && pKeyStore)
     {
@@ -1410,6 +1477,21 @@ TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txT
     }
 }
 
+uint256 TransactionSignatureChecker::GetSignatureHash(const CScript& scriptCode, int nHashType, uint32_t consensusBranchId) const
+{
+    // each signature of a multisig or identity spend is checked against the same hash
+    if (nHashType == lastHashType && consensusBranchId == lastBranchId && scriptCode == lastScriptCode)
+    {
+        return lastSigHash;
+    }
+    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, consensusBranchId, this->txdata);
+    lastScriptCode = scriptCode;
+    lastHashType = nHashType;
+    lastBranchId = consensusBranchId;
+    lastSigHash = sighash;
+    return sighash;
+}
+
 bool TransactionSignatureChecker::VerifySignature(
     const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
@@ -1435,7 +1517,7 @@ bool TransactionSignatureChecker::CheckSig(
 
     uint256 sighash;
     try {
-        sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, consensusBranchId, this->txdata);
+        sighash = GetSignatureHash(scriptCode, nHashType, consensusBranchId);
     } catch (logic_error ex) {
         return false;
     }
@@ -1770,7 +1852,7 @@ int TransactionSignatureChecker::CheckCryptoCondition(
 
     uint256 sighash;
     try {
-        sighash = SignatureHash(signScript, *txTo, nIn, nHashType, amount, consensusBranchId, this->txdata);
+        sighash = GetSignatureHash(signScript, nHashType, consensusBranchId);
     } catch (logic_error ex) {
         cc_free(cond);
         return 0;
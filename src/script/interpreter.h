@@ -14,10 +14,12 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <stdint.h>
 #include <string>
 #include <climits>
 
+class CBLAKE2bWriter;
 class CPubKey;
 class CScript;
 class CTransaction;
@@ -94,11 +96,22 @@ enum
 
 bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror);
 
+class CSigHashMidstates;
+
 struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs, hashJoinSplits, hashShieldedSpends, hashShieldedOutputs;
 
+    // Overwinter and Sapling signature hash states, hashed up to the hash type for each consensus branch
+    // and hash type used. Shared by the checks of all inputs and signers of the transaction, which may
+    // run on different threads.
+    std::shared_ptr<CSigHashMidstates> sigHashMidstates;
+
     PrecomputedTransactionData(const CTransaction& tx);
+
+    // resume ss, started with the personalization for consensusBranchId, from the hash state
+    // that comes before the hash type, computing it on first use. Not for SIGHASH_SINGLE.
+    void ResumeSigHash(CBLAKE2bWriter& ss, const CTransaction& txTo, int nHashType, uint32_t consensusBranchId) const;
 };
 
 enum SigVersion
@@ -336,6 +349,14 @@ protected:
     std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> idMap;
     bool idMapSet;
 
+    // the last signature hash computed, which the signers of multisig and identity spends share
+    mutable CScript lastScriptCode;
+    mutable int lastHashType = -1;
+    mutable uint32_t lastBranchId = 0;
+    mutable uint256 lastSigHash;
+    // throws std::logic_error like SignatureHash
+    uint256 GetSignatureHash(const CScript& scriptCode, int nHashType, uint32_t consensusBranchId) const;
+
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
@@ -10,6 +10,7 @@
 #include "test/test_bitcoin.h"
 #include "consensus/validation.h"
 #include "main.h"
+#include "txdb.h"
 #include "undo.h"
 #include "primitives/transaction.h"
 #include "pubkey.h"
@@ -1091,4 +1092,133 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(blockundo_serialization)
+{
+    CBlockUndo undo(CBlockUndo::FORMAT_LEGACY);
+    undo.old_sprout_tree_root = GetRandHash();
+    CScript commonScript = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    for (int i = 0; i < 20; i++) {
+        CTxUndo txundo;
+        for (int j = 0; j <= i % 4; j++) {
+            CScript script = (j % 2) ? commonScript : CScript() << OP_RETURN << ToByteVector(GetRandHash());
+            unsigned int nHeight = (j == 0) ? 0 : 100000 + insecure_rand() % 1000;
+            txundo.vprevout.push_back(CTxInUndo(CTxOut(insecure_rand() % 100000000, script), i == 7, nHeight, nHeight ? 4 : 0));
+        }
+        undo.vtxundo.push_back(txundo);
+    }
+
+    // the legacy format is the plain vector of undo records
+    CDataStream ssLegacy(SER_DISK, CLIENT_VERSION);
+    ssLegacy << undo;
+    CDataStream ssPlain(SER_DISK, CLIENT_VERSION);
+    ssPlain << undo.vtxundo << undo.old_sprout_tree_root;
+    BOOST_CHECK(HexStr(ssLegacy.begin(), ssLegacy.end()) == HexStr(ssPlain.begin(), ssPlain.end()));
+
+    undo.nFormat = CBlockUndo::FORMAT_COLUMNAR;
+    CDataStream ssColumnar(SER_DISK, CLIENT_VERSION);
+    ssColumnar << undo;
+    BOOST_CHECK(ssColumnar.size() < ssLegacy.size());
+
+    for (CDataStream *ss : {&ssLegacy, &ssColumnar}) {
+        CDataStream ssCopy(*ss);
+        CBlockUndo undo2;
+        *ss >> undo2;
+        BOOST_CHECK(ss->empty());
+        BOOST_CHECK_EQUAL(undo2.nFormat, ss == &ssLegacy ? CBlockUndo::FORMAT_LEGACY : CBlockUndo::FORMAT_COLUMNAR);
+        BOOST_CHECK(undo2.old_sprout_tree_root == undo.old_sprout_tree_root);
+        BOOST_CHECK_EQUAL(undo2.vtxundo.size(), undo.vtxundo.size());
+        for (size_t i = 0; i < undo.vtxundo.size(); i++) {
+            BOOST_CHECK_EQUAL(undo2.vtxundo[i].vprevout.size(), undo.vtxundo[i].vprevout.size());
+            for (size_t j = 0; j < undo.vtxundo[i].vprevout.size(); j++) {
+                const CTxInUndo &a = undo.vtxundo[i].vprevout[j], &b = undo2.vtxundo[i].vprevout[j];
+                BOOST_CHECK(a.txout == b.txout);
+                BOOST_CHECK_EQUAL(a.fCoinBase, b.fCoinBase);
+                BOOST_CHECK_EQUAL(a.nHeight, b.nHeight);
+                BOOST_CHECK_EQUAL(a.nVersion, b.nVersion);
+            }
+        }
+
+        // written back in the format it was read in, so the checksum of the undo file still matches
+        CDataStream ssAgain(SER_DISK, CLIENT_VERSION);
+        ssAgain << undo2;
+        BOOST_CHECK(HexStr(ssAgain.begin(), ssAgain.end()) == HexStr(ssCopy.begin(), ssCopy.end()));
+    }
+
+    // a script index beyond the scripts of the block
+    CDataStream ssBad(ParseHex("ff01" + std::string(64, '0') + "01" + "01" + "00" + "05"), SER_DISK, CLIENT_VERSION);
+    try {
+        CBlockUndo undo3;
+        ssBad >> undo3;
+        BOOST_CHECK_MESSAGE(false, "We should have thrown");
+    } catch (const std::ios_base::failure& e) {
+    }
+}
+
+BOOST_AUTO_TEST_CASE(coins_map_stability)
+{
+    CCoinsMap map;
+    std::map<uint256, CAmount> result;
+    std::vector<const CCoinsCacheEntry *> entries;
+    for (int i = 0; i < 5000; i++) {
+        uint256 txid = GetRandHash();
+        CCoinsCacheEntry &entry = map[txid];
+        entry.coins.vout.push_back(CTxOut(i, CScript()));
+        entries.push_back(&entry);
+        result[txid] = i;
+    }
+    BOOST_CHECK_EQUAL(map.size(), 5000);
+
+    // erase while iterating, and the remaining entries have not moved as the table grew
+    for (CCoinsMap::iterator it = map.begin(); it != map.end(); ) {
+        if (it->second.coins.vout[0].nValue % 2) {
+            result.erase(it->first);
+            map.erase(it++);
+        } else {
+            BOOST_CHECK(&it->second == entries[it->second.coins.vout[0].nValue]);
+            it++;
+        }
+    }
+    BOOST_CHECK_EQUAL(map.size(), result.size());
+    for (std::map<uint256, CAmount>::iterator it = result.begin(); it != result.end(); it++) {
+        CCoinsMap::const_iterator found = map.find(it->first);
+        BOOST_CHECK(found != map.end() && found->second.coins.vout[0].nValue == it->second);
+    }
+    BOOST_CHECK(map.find(GetRandHash()) == map.end());
+    BOOST_CHECK(memusage::DynamicUsage(map) > 0);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_db_async_write, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true, false, true);
+    CCoinsViewCache cache(&db);
+    uint256 txid = GetRandHash();
+    uint256 hashBlock = GetRandHash();
+    {
+        CCoinsModifier coins = cache.ModifyNewCoins(txid);
+        coins->vout.push_back(CTxOut(12345, CScript() << OP_TRUE));
+    }
+    cache.SetBestBlock(hashBlock);
+    BOOST_CHECK(cache.Flush());
+
+    // the flushed entries are readable whether or not they are on disk yet
+    CCoins coins;
+    BOOST_CHECK(db.GetCoins(txid, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 12345);
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+
+    // spending them in a second write, which waits for the first
+    cache.ModifyCoins(txid)->Clear();
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!db.HaveCoins(txid));
+    BOOST_CHECK(db.SyncWrites());
+    BOOST_CHECK_EQUAL(db.PendingWriteUsage(), 0);
+    BOOST_CHECK(!db.HaveCoins(txid));
+    BOOST_CHECK(!db.GetCoins(txid, coins));
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
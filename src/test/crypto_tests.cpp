@@ -8,6 +8,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/verus_hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
@@ -248,4 +249,16 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+BOOST_AUTO_TEST_CASE(haraka_kernels) {
+    load_constants();
+    BOOST_CHECK(haraka_kernel_supported(HARAKA_KERNEL_X4));
+    for (int kernel = 0; kernel < HARAKA_KERNEL_COUNT; kernel++) {
+        if (haraka_kernel_supported(kernel)) {
+            BOOST_CHECK_MESSAGE(haraka_kernel_matches_reference(kernel), haraka_kernel_name(kernel));
+        } else {
+            BOOST_CHECK(!haraka_kernel_matches_reference(kernel));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
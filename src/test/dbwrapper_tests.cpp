@@ -230,5 +230,43 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 }
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_tuning_profiles)
+{
+    mapMultiArgs["-dbtuning"].push_back("tuningtest:bloombits=14");
+    mapMultiArgs["-dbtuning"].push_back("tuningtest:blocksize=32768");
+    mapMultiArgs["-dbtuning"].push_back("othertest:bloombits=2");
+    mapMultiArgs["-dbtuning"].push_back("tuningtest:nosuchoption=1");
+
+    CDBTuningProfile profile = GetDBTuningProfile("tuningtest", true, 64);
+    BOOST_CHECK_EQUAL(profile.nBloomBits, 14);
+    BOOST_CHECK_EQUAL(profile.nBlockSize, 32768);
+    BOOST_CHECK(profile.fCompression);
+
+    // profiles of other databases are unaffected
+    profile = GetDBTuningProfile("chainstate", false, 64);
+    BOOST_CHECK_EQUAL(profile.nBloomBits, 12);
+    BOOST_CHECK(!profile.fCompression);
+
+    {
+        path ph = temp_directory_path() / unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, false, 64, "tuningtest");
+        char key = 'k';
+        uint256 in = GetRandHash();
+        uint256 res;
+
+        BOOST_CHECK(dbw.Write(key, in));
+        BOOST_CHECK(dbw.Read(key, res));
+        BOOST_CHECK(!dbw.Read('m', res));
+
+        CDBStats stats = dbw.GetStats();
+        BOOST_CHECK_EQUAL(stats.name, "tuningtest");
+        BOOST_CHECK_EQUAL(stats.profile.nBloomBits, 14);
+        BOOST_CHECK_EQUAL(stats.nReads, 2);
+        BOOST_CHECK_EQUAL(stats.nReadMisses, 1);
+        BOOST_CHECK_EQUAL(stats.nBatches, 1);
+    }
+
+    mapMultiArgs.erase("-dbtuning");
+}
 
 BOOST_AUTO_TEST_SUITE_END()
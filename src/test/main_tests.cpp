@@ -127,4 +127,28 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     BOOST_CHECK(Test());
 }
 
+BOOST_AUTO_TEST_CASE(header_hashes_report_first_mismatch)
+{
+    std::vector<CBlockHeader> headers(8, Params().GenesisBlock().GetBlockHeader());
+    std::vector<uint256> expected;
+    for (int i = 0; i < headers.size(); i++)
+    {
+        headers[i].nTime += i;
+        expected.push_back(headers[i].GetHash());
+    }
+
+    std::vector<uint256> hashes;
+    int failed = -1;
+    BOOST_CHECK(GetBlockHeaderHashes(headers, hashes, &expected, &failed));
+    BOOST_CHECK_EQUAL(failed, -1);
+    BOOST_CHECK(hashes == expected);
+
+    // the checks after a failure may be skipped and leave their hashes null, so the failing check reports itself
+    expected[3] = uint256();
+    expected[3].begin()[0] = 1;
+    BOOST_CHECK(!GetBlockHeaderHashes(headers, hashes, &expected, &failed));
+    BOOST_CHECK_EQUAL(failed, 3);
+    BOOST_CHECK(hashes[3] == headers[3].GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
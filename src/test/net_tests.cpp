@@ -0,0 +1,82 @@
+// Copyright (c) 2012-2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "chainparams.h"
+#include "hash.h"
+#include "net.h"
+#include "protocol.h"
+#include "serialize.h"
+#include "streams.h"
+#include "version.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+static std::vector<char> PingMessage(uint64_t nonce)
+{
+    CDataStream ssPayload(SER_NETWORK, PROTOCOL_VERSION);
+    ssPayload << nonce;
+
+    CMessageHeader hdr(Params().MessageStart(), "ping", ssPayload.size());
+    uint256 hash = Hash(ssPayload.begin(), ssPayload.end());
+    memcpy(&hdr.nChecksum, &hash, sizeof(hdr.nChecksum));
+
+    CDataStream ssMsg(SER_NETWORK, PROTOCOL_VERSION);
+    ssMsg << hdr;
+    ssMsg.write(&ssPayload[0], ssPayload.size());
+    return std::vector<char>(ssMsg.begin(), ssMsg.end());
+}
+
+BOOST_FIXTURE_TEST_SUITE(net_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(fast_ping_waits_for_getdata)
+{
+    CAddress addr(CService("10.0.0.1", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    node.nVersion = PROTOCOL_VERSION;
+    node.fSuccessfullyConnected = true;
+    std::vector<char> vPing = PingMessage(42);
+
+    // a ping behind a getdata backlog stays queued, so its pong follows the replies to the getdata
+    node.vRecvGetData.push_back(CInv(MSG_BLOCK, uint256()));
+    {
+        LOCK(node.cs_vRecvMsg);
+        BOOST_CHECK(node.ReceiveMsgBytes(&vPing[0], vPing.size()));
+        BOOST_CHECK_EQUAL(node.vRecvMsg.size(), 1U);
+        BOOST_CHECK(node.vRecvMsg.front().complete());
+        BOOST_CHECK_EQUAL(node.vRecvMsg.front().hdr.GetCommand(), "ping");
+    }
+    BOOST_CHECK(node.vSendMsg.empty());
+
+    // once the backlog is served, a lone ping is answered from the socket thread
+    node.vRecvGetData.clear();
+    {
+        LOCK(node.cs_vRecvMsg);
+        node.vRecvMsg.clear();
+        BOOST_CHECK(node.ReceiveMsgBytes(&vPing[0], vPing.size()));
+        BOOST_CHECK(node.vRecvMsg.empty());
+    }
+    BOOST_CHECK_EQUAL(node.vSendMsg.size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(fast_ping_waits_for_earlier_messages)
+{
+    CAddress addr(CService("10.0.0.2", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    node.nVersion = PROTOCOL_VERSION;
+    node.fSuccessfullyConnected = true;
+    std::vector<char> vPing = PingMessage(7);
+
+    LOCK(node.cs_vRecvMsg);
+    // the handler hasn't taken the first ping yet when the second arrives
+    node.vRecvGetData.push_back(CInv(MSG_TX, uint256()));
+    BOOST_CHECK(node.ReceiveMsgBytes(&vPing[0], vPing.size()));
+    node.vRecvGetData.clear();
+    BOOST_CHECK(node.ReceiveMsgBytes(&vPing[0], vPing.size()));
+    BOOST_CHECK_EQUAL(node.vRecvMsg.size(), 2U);
+    BOOST_CHECK(node.vSendMsg.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
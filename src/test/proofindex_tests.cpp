@@ -0,0 +1,132 @@
+// Copyright (c) 2020 The VerusCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "cc/CCinclude.h"
+#include "crypto/equihash.h"
+#include "key.h"
+#include "main.h"
+#include "pbaas/notarization.h"
+#include "primitives/block.h"
+#include "proofindex.h"
+#include "script/standard.h"
+#include "streams.h"
+#include "txdb.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+static const std::vector<std::pair<uint256, CDiskTxPos> > noTxIndex;
+static const std::vector<CAddressIndexDbEntry> noAddressIndex;
+static const std::vector<CAddressUnspentDbEntry> noAddressUnspentIndex;
+static const std::vector<CSpentIndexDbEntry> noSpentIndex;
+static const std::vector<CAssetIndexDbEntry> noAssetIndex;
+static const std::vector<COracleSampleDbEntry> noOracleSamples;
+
+// a coinbase, a transaction with a notarization finalization output, which is retained, and a plain payment
+static CBlock RetainedTxBlock(bool fPBaaS)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CTxDestination dest = key.GetPubKey().GetID();
+    CScript script = GetScriptForDestination(dest);
+
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.push_back(CTxIn());
+    coinbase.vin[0].scriptSig = CScript() << 10 << OP_0;
+    coinbase.vout.push_back(CTxOut(10 * COIN, script));
+    block.vtx.push_back(coinbase);
+
+    CMutableTransaction finalizeTx;
+    finalizeTx.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0)));
+    CTransactionFinalization nf(0);
+    std::vector<CTxDestination> dests({dest});
+    finalizeTx.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CTransactionFinalization>(EVAL_FINALIZE_NOTARIZATION, dests, 1, &nf))));
+    finalizeTx.vout.push_back(CTxOut(COIN, script));
+    block.vtx.push_back(finalizeTx);
+
+    CMutableTransaction payment;
+    payment.vin.push_back(CTxIn(COutPoint(GetRandHash(), 1)));
+    payment.vout.push_back(CTxOut(2 * COIN, script));
+    block.vtx.push_back(payment);
+
+    if (fPBaaS)
+    {
+        block.nVersion = CBlockHeader::VERUS_V2;
+        block.nSolution.resize(Eh200_9.SolutionWidth);
+        CVerusSolutionVector(block.nSolution).SetVersion(CActivationHeight::ACTIVATE_PBAAS);
+    }
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+static void CheckRetainedProof(bool fPBaaS)
+{
+    CBlock block = RetainedTxBlock(fPBaaS);
+    BOOST_CHECK_EQUAL(block.IsPBaaS() != 0, fPBaaS);
+    const CTransaction &tx = block.vtx[1];
+
+    std::vector<CRetainedTransactionDbEntry> retainedTxs;
+    BOOST_CHECK(GetRetainedTransactions(block, block.GetHash(), 10, PRUNE_RETAIN_PBAAS, retainedTxs));
+    BOOST_REQUIRE_EQUAL(retainedTxs.size(), 1U);
+    BOOST_CHECK(retainedTxs[0].first == tx.GetHash());
+    BOOST_CHECK_EQUAL(retainedTxs[0].second.txIndex, 1U);
+
+    // the entry written when the block is connected is what the proof is made from once the block is pruned
+    BOOST_CHECK(pblocktree->WriteBlockIndexes(noTxIndex, noAddressIndex, noAddressUnspentIndex, noSpentIndex,
+                                              noAssetIndex, noAssetIndex, noOracleSamples, retainedTxs));
+    CRetainedTransaction retained;
+    BOOST_REQUIRE(pblocktree->ReadRetainedTransaction(tx.GetHash(), retained));
+    BOOST_CHECK(retained.blockHash == block.GetHash());
+
+    std::vector<std::pair<int16_t, int16_t>> partIndexes;
+    partIndexes.push_back(std::make_pair((int16_t)CTransactionHeader::TX_HEADER, (int16_t)0));
+    partIndexes.push_back(std::make_pair((int16_t)CTransactionHeader::TX_OUTPUT, (int16_t)0));
+
+    CPartialTransactionProof fromBlock = block.GetPartialTransactionProof(tx, 1, partIndexes);
+    CPartialTransactionProof fromRetained = CBlock::MakePartialTransactionProof(fPBaaS, retained.txProof, retained.tx, partIndexes);
+
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION), ssRetained(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << fromBlock;
+    ssRetained << fromRetained;
+    BOOST_CHECK(ssBlock.str() == ssRetained.str());
+
+    // and it proves the transaction against the block
+    CTransaction outTx;
+    uint256 root = fromRetained.CheckPartialTransaction(outTx);
+    if (fPBaaS)
+    {
+        BlockMMRange blockMMR(block.BuildBlockMMRTree());
+        BlockMMView blockMMV(blockMMR);
+        BOOST_CHECK(root == blockMMV.GetRoot());
+    }
+    else
+    {
+        BOOST_CHECK(root == block.hashMerkleRoot);
+        BOOST_CHECK(outTx.GetHash() == tx.GetHash());
+    }
+
+    // disconnecting the block erases the entry
+    std::vector<uint256> retainedTxids;
+    GetRetainedTransactionIds(block, retainedTxids);
+    BOOST_CHECK(std::find(retainedTxids.begin(), retainedTxids.end(), tx.GetHash()) != retainedTxids.end());
+    BOOST_CHECK(pblocktree->EraseBlockIndexes(noAddressIndex, noAddressUnspentIndex, noSpentIndex,
+                                              noAssetIndex, noAssetIndex, noOracleSamples, retainedTxids));
+    BOOST_CHECK(!pblocktree->ReadRetainedTransaction(tx.GetHash(), retained));
+}
+
+BOOST_FIXTURE_TEST_SUITE(proofindex_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(retained_proof_merkle_branch)
+{
+    CheckRetainedProof(false);
+}
+
+BOOST_AUTO_TEST_CASE(retained_proof_block_mmr)
+{
+    CheckRetainedProof(true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The VerusCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "coins.h"
+#include "key.h"
+#include "pbaas/reserves.h"
+#include "primitives/transaction.h"
+#include "script/standard.h"
+#include "uint256.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(reserves_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(descriptor_cache_non_reserve)
+{
+    CActivationHeight savedHeights = CConstVerusSolutionVector::activationHeight;
+    CConstVerusSolutionVector::activationHeight.SetActivationHeight(CActivationHeight::ACTIVATE_IDENTITY, 1);
+
+    CKey key;
+    key.MakeNewKey(true);
+    CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+
+    CCoinsView viewBase;
+    CCoinsViewCache view(&viewBase);
+    uint256 prevHash = GetRandHash();
+    {
+        CCoinsModifier coins = view.ModifyNewCoins(prevHash);
+        coins->nHeight = 1;
+        coins->nVersion = 1;
+        coins->vout.push_back(CTxOut(10 * COIN, script));
+    }
+
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn(COutPoint(prevHash, 0)));
+    mtx.vout.push_back(CTxOut(9 * COIN, script));
+
+    CReserveTransactionDescriptor::ClearCache();
+    uint64_t hits, misses, entries;
+    CReserveTransactionDescriptor::GetCacheStats(hits, misses, entries);
+    BOOST_CHECK_EQUAL(entries, 0U);
+
+    // the transaction the descriptor was first built from is gone by the time the cached copy is used
+    CTransaction *pFirst = new CTransaction(mtx);
+    CReserveTransactionDescriptor first = CReserveTransactionDescriptor::GetCached(*pFirst, view, 2);
+    BOOST_CHECK(first.IsValid());
+    BOOST_CHECK(!first.IsReserve());
+    delete pFirst;
+
+    uint64_t hitsAfter, missesAfter, entriesAfter;
+    CReserveTransactionDescriptor::GetCacheStats(hitsAfter, missesAfter, entriesAfter);
+    BOOST_CHECK_EQUAL(missesAfter, misses + 1);
+    BOOST_CHECK_EQUAL(entriesAfter, 1U);
+
+    CTransaction second(mtx);
+    CReserveTransactionDescriptor cached = CReserveTransactionDescriptor::GetCached(second, view, 2);
+    CReserveTransactionDescriptor::GetCacheStats(hitsAfter, missesAfter, entriesAfter);
+    BOOST_CHECK_EQUAL(hitsAfter, hits + 1);
+    BOOST_CHECK(cached.ptx == &second);
+    BOOST_CHECK_EQUAL(cached.flags, first.flags);
+    BOOST_CHECK_EQUAL(cached.nativeIn, first.nativeIn);
+    BOOST_CHECK_EQUAL(cached.nativeOut, first.nativeOut);
+
+    // a different height is described again
+    CReserveTransactionDescriptor::GetCached(second, view, 3);
+    CReserveTransactionDescriptor::GetCacheStats(hitsAfter, missesAfter, entriesAfter);
+    BOOST_CHECK_EQUAL(missesAfter, misses + 2);
+    BOOST_CHECK_EQUAL(entriesAfter, 2U);
+
+    CReserveTransactionDescriptor::ClearCache();
+    CReserveTransactionDescriptor::GetCacheStats(hitsAfter, missesAfter, entriesAfter);
+    BOOST_CHECK_EQUAL(entriesAfter, 0U);
+
+    CConstVerusSolutionVector::activationHeight = savedHeights;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -331,6 +331,13 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
 
         sh = SignatureHash(scriptCode, tx, nIn, nHashType, 0, consensusBranchId);
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
+
+        // with precomputed data, both when the midstate is first hashed and when it is resumed
+        PrecomputedTransactionData txdata(tx);
+        for (int pass = 0; pass < 2; pass++) {
+            sh = SignatureHash(scriptCode, tx, nIn, nHashType, 0, consensusBranchId, &txdata);
+            BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
+        }
     }
 }
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+// Copyright (c) 2020 The VerusCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "addressindex.h"
+#include "amount.h"
+#include "random.h"
+#include "spentindex.h"
+#include "txdb.h"
+#include "uint256.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+static const std::vector<std::pair<uint256, CDiskTxPos> > noTxIndex;
+static const std::vector<CAddressUnspentDbEntry> noAddressUnspentIndex;
+static const std::vector<CSpentIndexDbEntry> noSpentIndex;
+static const std::vector<CAssetIndexDbEntry> noAssetIndex;
+static const std::vector<COracleSampleDbEntry> noOracleSamples;
+static const std::vector<CRetainedTransactionDbEntry> noRetainedTxs;
+static const std::vector<uint256> noRetainedTxids;
+
+static size_t CountAddressIndex(CBlockTreeDB &db, const uint160 &addressHash)
+{
+    std::vector<CAddressIndexDbEntry> entries;
+    BOOST_CHECK(db.ReadAddressIndex(addressHash, 1, entries));
+    return entries.size();
+}
+
+static void CheckIndexOverlay(bool fAsync)
+{
+    CBlockTreeDB db(1 << 20, true, false, true, 1000, fAsync);
+    uint256 randHash = GetRandHash();
+    uint160 addressHash = uint160(std::vector<unsigned char>(randHash.begin(), randHash.begin() + 20));
+    uint256 txid1 = GetRandHash();
+    uint256 txid2 = GetRandHash();
+
+    // the first block pays the address twice and is written to disk
+    std::vector<CAddressIndexDbEntry> block1;
+    block1.push_back(std::make_pair(CAddressIndexKey(1, addressHash, 1, 0, txid1, 0, false), 5 * COIN));
+    block1.push_back(std::make_pair(CAddressIndexKey(1, addressHash, 1, 0, txid1, 1, false), 3 * COIN));
+    BOOST_CHECK(db.WriteBlockIndexes(noTxIndex, block1, noAddressUnspentIndex, noSpentIndex,
+                                     noAssetIndex, noAssetIndex, noOracleSamples, noRetainedTxs));
+    BOOST_CHECK(db.SyncIndexes());
+
+    // the second block spends one of the outputs and is only held in memory
+    std::vector<CAddressIndexDbEntry> block2;
+    block2.push_back(std::make_pair(CAddressIndexKey(1, addressHash, 2, 0, txid2, 0, true), -5 * COIN));
+    std::vector<CSpentIndexDbEntry> spent2;
+    spent2.push_back(std::make_pair(CSpentIndexKey(txid1, 0), CSpentIndexValue(txid2, 0, 2, 5 * COIN, 1, addressHash)));
+    BOOST_CHECK(db.WriteBlockIndexes(noTxIndex, block2, noAddressUnspentIndex, spent2,
+                                     noAssetIndex, noAssetIndex, noOracleSamples, noRetainedTxs));
+
+    // reads see both blocks
+    BOOST_CHECK_EQUAL(CountAddressIndex(db, addressHash), 3U);
+    CSpentIndexKey spentKey(txid1, 0);
+    CSpentIndexValue spentValue;
+    BOOST_CHECK(db.ReadSpentIndex(spentKey, spentValue));
+    BOOST_CHECK(spentValue.txid == txid2);
+
+    // disconnecting the second block before it is written leaves the first one
+    std::vector<CSpentIndexDbEntry> spentUndo2;
+    spentUndo2.push_back(std::make_pair(CSpentIndexKey(txid1, 0), CSpentIndexValue()));
+    BOOST_CHECK(db.EraseBlockIndexes(block2, noAddressUnspentIndex, spentUndo2,
+                                     noAssetIndex, noAssetIndex, noOracleSamples, noRetainedTxids));
+    BOOST_CHECK_EQUAL(CountAddressIndex(db, addressHash), 2U);
+    BOOST_CHECK(!db.ReadSpentIndex(spentKey, spentValue));
+
+    // erasing the first block hides the entries that are on disk, before and after the erase is written
+    BOOST_CHECK(db.EraseBlockIndexes(block1, noAddressUnspentIndex, noSpentIndex,
+                                     noAssetIndex, noAssetIndex, noOracleSamples, noRetainedTxids));
+    BOOST_CHECK_EQUAL(CountAddressIndex(db, addressHash), 0U);
+    BOOST_CHECK(db.SyncIndexes());
+    BOOST_CHECK_EQUAL(CountAddressIndex(db, addressHash), 0U);
+}
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(index_overlay)
+{
+    CheckIndexOverlay(false);
+}
+
+BOOST_AUTO_TEST_CASE(index_overlay_async)
+{
+    CheckIndexOverlay(true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
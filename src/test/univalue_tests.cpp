@@ -316,5 +316,70 @@ BOOST_AUTO_TEST_CASE(univalue_readwrite)
     BOOST_CHECK_EQUAL(strJson1, v.write());
 }
 
+BOOST_AUTO_TEST_CASE(univalue_keyindex)
+{
+    // large enough for findKey to use the key index
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < 100; i++)
+        BOOST_CHECK(obj.pushKV("key" + std::to_string(i), i));
+    BOOST_CHECK(obj.pushKV("key7", "duplicate"));
+
+    BOOST_CHECK_EQUAL(obj.size(), 101);
+    BOOST_CHECK_EQUAL(obj["key0"].getValStr(), "0");
+    BOOST_CHECK_EQUAL(obj["key99"].getValStr(), "99");
+    // the first of duplicate keys is found, as in a small object
+    BOOST_CHECK_EQUAL(find_value(obj, "key7").getValStr(), "7");
+    BOOST_CHECK(!obj.exists("key100"));
+
+    UniValue copy = obj;
+    BOOST_CHECK(copy.pushKV("key100", 100));
+    BOOST_CHECK(copy.exists("key100"));
+    BOOST_CHECK(!obj.exists("key100"));
+    BOOST_CHECK_EQUAL(copy["key42"].getValStr(), "42");
+
+    UniValue read;
+    BOOST_CHECK(read.read(obj.write()));
+    BOOST_CHECK_EQUAL(read["key63"].getValStr(), "63");
+    BOOST_CHECK_EQUAL(read["key7"].getValStr(), "7");
+    BOOST_CHECK_EQUAL(read.write(), obj.write());
+
+    obj.setObject();
+    BOOST_CHECK(!obj.exists("key0"));
+    BOOST_CHECK(obj.pushKV("key0", "again"));
+    BOOST_CHECK_EQUAL(obj["key0"].getValStr(), "again");
+}
+
+BOOST_AUTO_TEST_CASE(univalue_writer)
+{
+    UniValue v;
+    BOOST_CHECK(v.read(json1));
+
+    // the same value written member by member, with an element given as a tree
+    std::string s;
+    UniValueWriter writer(s);
+    writer.beginArray();
+    writer.push_back(v[0]);
+    writer.beginObject();
+    writer.pushKV("key1", v[1]["key1"]);
+    writer.push_back(Pair("key2", 800));
+    writer.key("key3");
+    writer.value(v[1]["key3"]);
+    writer.endObject();
+    writer.endArray();
+    BOOST_CHECK_EQUAL(s, v.write());
+
+    std::string empty;
+    UniValueWriter emptyWriter(empty);
+    emptyWriter.beginObject();
+    emptyWriter.key("a");
+    emptyWriter.beginArray();
+    emptyWriter.endArray();
+    emptyWriter.key("b");
+    emptyWriter.beginObject();
+    emptyWriter.endObject();
+    emptyWriter.endObject();
+    BOOST_CHECK_EQUAL(empty, "{\"a\":[],\"b\":{}}");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
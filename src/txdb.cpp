@@ -9,8 +9,13 @@
 #include "hash.h"
 #include "main.h"
 #include "pow.h"
+#include "ui_interface.h"
 #include "uint256.h"
 #include "core_io.h"
+#include "init.h"
+#include "memusage.h"
+#include "util.h"
+#include "utiltime.h"
 
 #include <stdint.h>
 
@@ -33,6 +38,11 @@ static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_ASSETOUTPUT = 'k';
+static const char DB_ASSETBALANCE = 'K';
+static const char DB_ASSETORDER = 'o';
+static const char DB_ORACLESAMPLE = 'O';
+static const char DB_RETAINEDTX = 'r';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_SPROUT_ANCHOR = 'a';
@@ -41,16 +51,53 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+// block index entries whose header hashes are verified together while loading
+static const size_t BLOCK_INDEX_HASH_BATCH = 2000;
+
 // Zcash defines are slightly different - commenting rather than removing
 // in case there is ever a related error
 //static const char DB_TIMESTAMPINDEX = 'T';
 //static const char DB_BLOCKHASHINDEX = 'h';
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe),
+    fAsyncWrite(false), fPending(false), fWriteFailed(false), fStopWriter(false), nWrites(0), nWriteMicros(0), nStallMicros(0)
+{
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe, bool fAsync) :
+    db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe),
+    fAsyncWrite(fAsync), fPending(false), fWriteFailed(false), fStopWriter(false), nWrites(0), nWriteMicros(0), nStallMicros(0)
+{
+    if (fAsyncWrite)
+        writerThread = boost::thread(boost::bind(&CCoinsViewDB::ThreadWriteCoins, this));
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (fAsyncWrite)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs_pending);
+            fStopWriter = true;
+            condPending.notify_all();
+        }
+        // the writer finishes any pending write before it exits
+        writerThread.join();
+    }
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe) 
+void CCoinsViewDB::CPendingWrite::Swap(CPendingWrite &other)
 {
+    mapCoins.swap(other.mapCoins);
+    std::swap(hashBlock, other.hashBlock);
+    std::swap(hashSproutAnchor, other.hashSproutAnchor);
+    std::swap(hashSaplingAnchor, other.hashSaplingAnchor);
+    mapSproutAnchors.swap(other.mapSproutAnchors);
+    mapSaplingAnchors.swap(other.mapSaplingAnchors);
+    mapSproutNullifiers.swap(other.mapSproutNullifiers);
+    mapSaplingNullifiers.swap(other.mapSaplingNullifiers);
+    std::swap(nUsage, other.nUsage);
 }
 
 
@@ -61,6 +108,18 @@ bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree)
         return true;
     }
 
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending) {
+            CAnchorsSproutMap::const_iterator it = pending.mapSproutAnchors.find(rt);
+            if (it != pending.mapSproutAnchors.end() && (it->second.flags & CAnchorsSproutCacheEntry::DIRTY)) {
+                if (it->second.entered)
+                    tree = it->second.tree;
+                return it->second.entered;
+            }
+        }
+    }
+
     bool read = db.Read(make_pair(DB_SPROUT_ANCHOR, rt), tree);
 
     return read;
@@ -73,6 +132,18 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree
         return true;
     }
 
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending) {
+            CAnchorsSaplingMap::const_iterator it = pending.mapSaplingAnchors.find(rt);
+            if (it != pending.mapSaplingAnchors.end() && (it->second.flags & CAnchorsSaplingCacheEntry::DIRTY)) {
+                if (it->second.entered)
+                    tree = it->second.tree;
+                return it->second.entered;
+            }
+        }
+    }
+
     bool read = db.Read(make_pair(DB_SAPLING_ANCHOR, rt), tree);
 
     return read;
@@ -81,28 +152,64 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree
 bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
     bool spent = false;
     char dbChar;
+    const CNullifiersMap *pendingNullifiers;
     switch (type) {
         case SPROUT:
             dbChar = DB_NULLIFIER;
+            pendingNullifiers = &pending.mapSproutNullifiers;
             break;
         case SAPLING:
             dbChar = DB_SAPLING_NULLIFIER;
+            pendingNullifiers = &pending.mapSaplingNullifiers;
             break;
         default:
             throw runtime_error("Unknown shielded type");
     }
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending) {
+            CNullifiersMap::const_iterator it = pendingNullifiers->find(nf);
+            if (it != pendingNullifiers->end() && (it->second.flags & CNullifiersCacheEntry::DIRTY))
+                return it->second.entered;
+        }
+    }
     return db.Read(make_pair(dbChar, nf), spent);
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending) {
+            CCoinsMap::const_iterator it = pending.mapCoins.find(txid);
+            if (it != pending.mapCoins.end() && (it->second.flags & CCoinsCacheEntry::DIRTY)) {
+                if (it->second.coins.IsPruned())
+                    return false;
+                coins = it->second.coins;
+                return true;
+            }
+        }
+    }
     return db.Read(make_pair(DB_COINS, txid), coins);
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending) {
+            CCoinsMap::const_iterator it = pending.mapCoins.find(txid);
+            if (it != pending.mapCoins.end() && (it->second.flags & CCoinsCacheEntry::DIRTY))
+                return !it->second.coins.IsPruned();
+        }
+    }
     return db.Exists(make_pair(DB_COINS, txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending && !pending.hashBlock.IsNull())
+            return pending.hashBlock;
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -111,6 +218,16 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 
 uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
     uint256 hashBestAnchor;
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending) {
+            if (type == SPROUT && !pending.hashSproutAnchor.IsNull())
+                return pending.hashSproutAnchor;
+            if (type == SAPLING && !pending.hashSaplingAnchor.IsNull())
+                return pending.hashSaplingAnchor;
+        }
+    }
     
     switch (type) {
         case SPROUT:
@@ -128,9 +245,9 @@ uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
     return hashBestAnchor;
 }
 
-void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char& dbChar)
+void BatchWriteNullifiers(CDBBatch& batch, const CNullifiersMap& mapToUse, const char& dbChar)
 {
-    for (CNullifiersMap::iterator it = mapToUse.begin(); it != mapToUse.end();) {
+    for (CNullifiersMap::const_iterator it = mapToUse.begin(); it != mapToUse.end(); it++) {
         if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
             if (!it->second.entered)
                 batch.Erase(make_pair(dbChar, it->first));
@@ -138,15 +255,13 @@ void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char&
                 batch.Write(make_pair(dbChar, it->first), true);
             // TODO: changed++? ... See comment in CCoinsViewDB::BatchWrite. If this is needed we could return an int
         }
-        CNullifiersMap::iterator itOld = it++;
-        mapToUse.erase(itOld);
     }
 }
 
 template<typename Map, typename MapIterator, typename MapEntry, typename Tree>
-void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
+void BatchWriteAnchors(CDBBatch& batch, const Map& mapToUse, const char& dbChar)
 {
-    for (MapIterator it = mapToUse.begin(); it != mapToUse.end();) {
+    for (MapIterator it = mapToUse.begin(); it != mapToUse.end(); it++) {
         if (it->second.flags & MapEntry::DIRTY) {
             if (!it->second.entered)
                 batch.Erase(make_pair(dbChar, it->first));
@@ -157,23 +272,14 @@ void BatchWriteAnchors(CDBBatch& batch, Map& mapToUse, const char& dbChar)
             }
             // TODO: changed++?
         }
-        MapIterator itOld = it++;
-        mapToUse.erase(itOld);
     }
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
-                              const uint256 &hashBlock,
-                              const uint256 &hashSproutAnchor,
-                              const uint256 &hashSaplingAnchor,
-                              CAnchorsSproutMap &mapSproutAnchors,
-                              CAnchorsSaplingMap &mapSaplingAnchors,
-                              CNullifiersMap &mapSproutNullifiers,
-                              CNullifiersMap &mapSaplingNullifiers) {
+bool CCoinsViewDB::WritePending(const CPendingWrite &write) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = write.mapCoins.begin(); it != write.mapCoins.end(); it++) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             if (it->second.coins.IsPruned())
                 batch.Erase(make_pair(DB_COINS, it->first));
@@ -182,28 +288,469 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
     }
 
-    ::BatchWriteAnchors<CAnchorsSproutMap, CAnchorsSproutMap::iterator, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, mapSproutAnchors, DB_SPROUT_ANCHOR);
-    ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
+    ::BatchWriteAnchors<CAnchorsSproutMap, CAnchorsSproutMap::const_iterator, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, write.mapSproutAnchors, DB_SPROUT_ANCHOR);
+    ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::const_iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, write.mapSaplingAnchors, DB_SAPLING_ANCHOR);
 
-    ::BatchWriteNullifiers(batch, mapSproutNullifiers, DB_NULLIFIER);
-    ::BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER);
+    ::BatchWriteNullifiers(batch, write.mapSproutNullifiers, DB_NULLIFIER);
+    ::BatchWriteNullifiers(batch, write.mapSaplingNullifiers, DB_SAPLING_NULLIFIER);
 
-    if (!hashBlock.IsNull())
-        batch.Write(DB_BEST_BLOCK, hashBlock);
-    if (!hashSproutAnchor.IsNull())
-        batch.Write(DB_BEST_SPROUT_ANCHOR, hashSproutAnchor);
-    if (!hashSaplingAnchor.IsNull())
-        batch.Write(DB_BEST_SAPLING_ANCHOR, hashSaplingAnchor);
+    // the best block is written in the same batch as the coins, so the database is always consistent with it
+    if (!write.hashBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, write.hashBlock);
+    if (!write.hashSproutAnchor.IsNull())
+        batch.Write(DB_BEST_SPROUT_ANCHOR, write.hashSproutAnchor);
+    if (!write.hashSaplingAnchor.IsNull())
+        batch.Write(DB_BEST_SAPLING_ANCHOR, write.hashSaplingAnchor);
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
+                              const uint256 &hashBlock,
+                              const uint256 &hashSproutAnchor,
+                              const uint256 &hashSaplingAnchor,
+                              CAnchorsSproutMap &mapSproutAnchors,
+                              CAnchorsSaplingMap &mapSaplingAnchors,
+                              CNullifiersMap &mapSproutNullifiers,
+                              CNullifiersMap &mapSaplingNullifiers) {
+    CPendingWrite write;
+    write.mapCoins.swap(mapCoins);
+    write.hashBlock = hashBlock;
+    write.hashSproutAnchor = hashSproutAnchor;
+    write.hashSaplingAnchor = hashSaplingAnchor;
+    write.mapSproutAnchors.swap(mapSproutAnchors);
+    write.mapSaplingAnchors.swap(mapSaplingAnchors);
+    write.mapSproutNullifiers.swap(mapSproutNullifiers);
+    write.mapSaplingNullifiers.swap(mapSaplingNullifiers);
+
+    if (!fAsyncWrite)
+        return WritePending(write);
+
+    size_t nCoinsUsage = 0;
+    for (CCoinsMap::const_iterator it = write.mapCoins.begin(); it != write.mapCoins.end(); it++)
+        nCoinsUsage += it->second.coins.DynamicMemoryUsage();
+    write.nUsage = memusage::DynamicUsage(write.mapCoins) +
+                   memusage::DynamicUsage(write.mapSproutAnchors) +
+                   memusage::DynamicUsage(write.mapSaplingAnchors) +
+                   memusage::DynamicUsage(write.mapSproutNullifiers) +
+                   memusage::DynamicUsage(write.mapSaplingNullifiers) +
+                   nCoinsUsage;
+
+    // wait for the previous write, which is the only time the caller is held up
+    int64_t nStart = GetTimeMicros();
+    boost::unique_lock<boost::mutex> lock(cs_pending);
+    while (fPending && !fWriteFailed)
+        condPending.wait(lock);
+    int64_t nStall = GetTimeMicros() - nStart;
+    nStallMicros += nStall;
+    LogPrint("bench", "    - Coin database write stall: %.2fms [%.2fs]\n", 0.001 * nStall, nStallMicros * 0.000001);
+    if (fWriteFailed)
+        return false;
+
+    // hand the write over, leaving the caller the emptied maps of the last one
+    pending.Swap(write);
+    fPending = true;
+    condPending.notify_all();
+    return true;
+}
+
+void CCoinsViewDB::ThreadWriteCoins()
+{
+    RenameThread("verus-coinswrite");
+
+    while (true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs_pending);
+            while (!fPending && !fStopWriter)
+                condPending.wait(lock);
+            if (!fPending)
+                return;
+        }
+
+        // readers only look entries up in the pending write, and it is not changed until it is on disk
+        int64_t nStart = GetTimeMicros();
+        bool fOk;
+        try {
+            fOk = WritePending(pending);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: error writing coin database: %s\n", __func__, e.what());
+            fOk = false;
+        }
+        int64_t nTime = GetTimeMicros() - nStart;
+
+        if (!fOk)
+        {
+            // the write is left pending, so lookups still see it, and nothing more is accepted
+            {
+                boost::unique_lock<boost::mutex> lock(cs_pending);
+                fWriteFailed = true;
+                condPending.notify_all();
+            }
+            strMiscWarning = "Failed to write to coin database";
+            LogPrintf("*** %s\n", strMiscWarning);
+            uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+                                             "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+            return;
+        }
+
+        CPendingWrite written;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_pending);
+            written.Swap(pending);
+            fPending = false;
+            nWrites++;
+            nWriteMicros += nTime;
+            condPending.notify_all();
+        }
+        LogPrint("bench", "Coin database write %u: %u transactions in %.2fms [%.2fs]\n",
+                 (unsigned int)nWrites, (unsigned int)written.mapCoins.size(), 0.001 * nTime, nWriteMicros * 0.000001);
+        // the written maps are freed here, outside the lock
+    }
+}
+
+bool CCoinsViewDB::WaitForPending() const
+{
+    boost::unique_lock<boost::mutex> lock(cs_pending);
+    while (fPending && !fWriteFailed)
+        condPending.wait(lock);
+    return !fWriteFailed;
+}
+
+bool CCoinsViewDB::SyncWrites()
+{
+    return WaitForPending();
+}
+
+size_t CCoinsViewDB::PendingWriteUsage() const
+{
+    boost::unique_lock<boost::mutex> lock(cs_pending);
+    return fPending ? pending.nUsage : 0;
+}
+
+const CIndexWriteSet::CEntry *CIndexWriteSet::Find(const std::string &key) const
+{
+    EntryMap::const_iterator it = mapEntries.find(key);
+    return it == mapEntries.end() ? NULL : &it->second;
+}
+
+void CIndexWriteSet::Put(const std::string &key, bool fErase, const std::string &value)
+{
+    std::pair<EntryMap::iterator, bool> ret = mapEntries.insert(std::make_pair(key, CEntry()));
+    if (ret.second)
+        nSize += key.size();
+    else
+        nSize -= ret.first->second.value.size();
+    ret.first->second.fErase = fErase;
+    ret.first->second.value = value;
+    nSize += value.size();
+}
+
+void CIndexWriteSet::Clear()
+{
+    mapEntries.clear();
+    nBlocks = 0;
+    nSize = 0;
+}
+
+void CIndexWriteSet::Swap(CIndexWriteSet &other)
+{
+    mapEntries.swap(other.mapEntries);
+    std::swap(nBlocks, other.nBlocks);
+    std::swap(nSize, other.nSize);
+}
+
+/**
+ * Iterates over the block database as it will be once the write sets that are not on disk yet are written. Keys
+ * are compared bytewise, as the database compares them. It holds the index lock while it exists, so that the sets
+ * it walks stay in place.
+ */
+class CIndexOverlayIterator
+{
+private:
+    boost::unique_lock<boost::mutex> lock;
+    boost::scoped_ptr<CDBIterator> pdbiter;
+    std::vector<const CIndexWriteSet*> vSets;   // newest first
+    std::vector<CIndexWriteSet::EntryMap::const_iterator> vPos;
+    int nSource;                                // set the current entry comes from, or -1 for the database
+    bool fValid;
+
+    leveldb::Slice CurrentKey()
+    {
+        return nSource < 0 ? pdbiter->GetKeySlice() : leveldb::Slice(vPos[nSource]->first);
+    }
+
+    leveldb::Slice CurrentValue()
+    {
+        return nSource < 0 ? pdbiter->GetValueSlice() : leveldb::Slice(vPos[nSource]->second.value);
+    }
+
+    //! move every source past the given key
+    void Skip(const std::string &key)
+    {
+        for (size_t i = 0; i < vSets.size(); i++) {
+            if (vPos[i] != vSets[i]->mapEntries.end() && vPos[i]->first == key)
+                vPos[i]++;
+        }
+        if (pdbiter->Valid() && pdbiter->GetKeySlice() == leveldb::Slice(key))
+            pdbiter->Next();
+    }
+
+    //! find the smallest key of all sources, skipping keys the newest set that has them erases
+    void Settle()
+    {
+        while (true) {
+            int nBest = -2;
+            leveldb::Slice best;
+            // on equal keys the newest set wins, and the database loses to any set
+            for (size_t i = 0; i < vSets.size(); i++) {
+                if (vPos[i] == vSets[i]->mapEntries.end())
+                    continue;
+                leveldb::Slice key(vPos[i]->first);
+                if (nBest == -2 || key.compare(best) < 0) {
+                    best = key;
+                    nBest = i;
+                }
+            }
+            if (pdbiter->Valid() && (nBest == -2 || pdbiter->GetKeySlice().compare(best) < 0)) {
+                best = pdbiter->GetKeySlice();
+                nBest = -1;
+            }
+            if (nBest == -2) {
+                fValid = false;
+                return;
+            }
+            if (nBest >= 0 && vPos[nBest]->second.fErase) {
+                Skip(best.ToString());
+                continue;
+            }
+            nSource = nBest;
+            fValid = true;
+            return;
+        }
+    }
+
+public:
+    CIndexOverlayIterator(CBlockTreeDB &db) : lock(db.cs_indexes), pdbiter(db.NewIterator()), nSource(-1), fValid(false)
+    {
+        vSets.push_back(&db.indexWrites);
+        if (db.fIndexWriting)
+            vSets.push_back(&db.indexWriting);
+        for (size_t i = 0; i < vSets.size(); i++)
+            vPos.push_back(vSets[i]->mapEntries.end());
+    }
+
+    bool Valid() { return fValid; }
+
+    template<typename K> void Seek(const K& key) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        std::string strKey = ssKey.str();
+        for (size_t i = 0; i < vSets.size(); i++)
+            vPos[i] = vSets[i]->mapEntries.lower_bound(strKey);
+        pdbiter->Seek(key);
+        Settle();
+    }
+
+    void Next() {
+        Skip(CurrentKey().ToString());
+        Settle();
+    }
+
+    template<typename K> bool GetKey(K& key) {
+        leveldb::Slice slKey = CurrentKey();
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> key;
+        } catch(std::exception &e) {
+            return false;
+        }
+        return true;
+    }
+
+    template<typename V> bool GetValue(V& value) {
+        leveldb::Slice slValue = CurrentValue();
+        try {
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> value;
+        } catch(std::exception &e) {
+            return false;
+        }
+        return true;
+    }
+};
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles, bool fAsync) :
+    CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles, "blockindex"),
+    fAsyncIndexes(fAsync), fIndexWriting(false), fIndexWriteFailed(false), fStopIndexWriter(false), nIndexWrites(0), nIndexWriteMicros(0)
+{
+    if (fAsyncIndexes)
+        indexWriterThread = boost::thread(boost::bind(&CBlockTreeDB::ThreadWriteIndexes, this));
+}
+
+CBlockTreeDB::~CBlockTreeDB()
+{
+    // whatever was gathered since the last flush is written before the database is closed
+    try {
+        SyncIndexes();
+    } catch (const std::exception& e) {
+        LogPrintf("%s: error writing block indexes: %s\n", __func__, e.what());
+    }
+    if (fAsyncIndexes)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs_indexes);
+            fStopIndexWriter = true;
+            condIndexes.notify_all();
+        }
+        indexWriterThread.join();
+    }
+}
+
+bool CBlockTreeDB::WriteIndexSet(const CIndexWriteSet &set)
+{
+    CDBBatch batch(*this);
+    for (CIndexWriteSet::EntryMap::const_iterator it = set.mapEntries.begin(); it != set.mapEntries.end(); it++) {
+        if (it->second.fErase)
+            batch.EraseSerialized(it->first);
+        else
+            batch.WriteSerialized(it->first, it->second.value);
+    }
+    LogPrint("coindb", "Committing %u index entries of %d blocks to block database...\n", (unsigned int)set.mapEntries.size(), set.nBlocks);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::HandOverIndexes(boost::unique_lock<boost::mutex> &lock)
+{
+    // a set is only handed over once the one before it is on disk, so runs are committed in order
+    while (fIndexWriting && !fIndexWriteFailed)
+        condIndexes.wait(lock);
+    if (fIndexWriteFailed)
+        return false;
+    if (indexWrites.IsEmpty()) {
+        indexWrites.Clear();
+        return true;
+    }
+
+    if (!fAsyncIndexes) {
+        if (!WriteIndexSet(indexWrites))
+            return false;
+        indexWrites.Clear();
+        return true;
+    }
+
+    indexWriting.Swap(indexWrites);
+    fIndexWriting = true;
+    condIndexes.notify_all();
+    return true;
+}
+
+void CBlockTreeDB::ThreadWriteIndexes()
+{
+    RenameThread("verus-indexwrite");
+
+    while (true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs_indexes);
+            while (!fIndexWriting && !fStopIndexWriter)
+                condIndexes.wait(lock);
+            if (!fIndexWriting)
+                return;
+        }
+
+        int64_t nStart = GetTimeMicros();
+        bool fOk;
+        try {
+            fOk = WriteIndexSet(indexWriting);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: error writing block indexes: %s\n", __func__, e.what());
+            fOk = false;
+        }
+        int64_t nTime = GetTimeMicros() - nStart;
+
+        if (!fOk)
+        {
+            // the set stays in the overlay, so reads still see it, and nothing more is accepted
+            {
+                boost::unique_lock<boost::mutex> lock(cs_indexes);
+                fIndexWriteFailed = true;
+                condIndexes.notify_all();
+            }
+            strMiscWarning = "Failed to write to block index database";
+            LogPrintf("*** %s\n", strMiscWarning);
+            uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+                                             "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+            return;
+        }
+
+        CIndexWriteSet written;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_indexes);
+            written.Swap(indexWriting);
+            fIndexWriting = false;
+            nIndexWrites++;
+            nIndexWriteMicros += nTime;
+            condIndexes.notify_all();
+        }
+        LogPrint("bench", "Block index write %u: %d blocks, %u entries in %.2fms [%.2fs]\n",
+                 (unsigned int)nIndexWrites, written.nBlocks, (unsigned int)written.mapEntries.size(), 0.001 * nTime, nIndexWriteMicros * 0.000001);
+        // the written set is freed here, outside the lock
+    }
+}
+
+bool CBlockTreeDB::FlushIndexes()
+{
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    return HandOverIndexes(lock);
+}
+
+bool CBlockTreeDB::SyncIndexes()
+{
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    if (!HandOverIndexes(lock))
+        return false;
+    while (fIndexWriting && !fIndexWriteFailed)
+        condIndexes.wait(lock);
+    return !fIndexWriteFailed;
+}
+
+template <typename K, typename V>
+bool CBlockTreeDB::ReadIndex(const K &key, V &value) const
+{
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        std::string strKey = ssKey.str();
+
+        boost::unique_lock<boost::mutex> lock(cs_indexes);
+        const CIndexWriteSet::CEntry *pentry = indexWrites.Find(strKey);
+        if (!pentry && fIndexWriting)
+            pentry = indexWriting.Find(strKey);
+        if (pentry) {
+            if (pentry->fErase)
+                return false;
+            try {
+                CDataStream ssValue(pentry->value.data(), pentry->value.data() + pentry->value.size(), SER_DISK, CLIENT_VERSION);
+                ssValue >> value;
+            } catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        }
+    }
+    // a set is only dropped from the overlay once it is on disk, so a key it held is found in one or the other
+    return Read(key, value);
+}
+
+CIndexOverlayIterator *CBlockTreeDB::NewOverlayIterator()
+{
+    return new CIndexOverlayIterator(*this);
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -227,6 +774,10 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
+    // the statistics are read straight from the database
+    if (!WaitForPending())
+        return false;
+
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
@@ -292,23 +843,34 @@ bool CBlockTreeDB::EraseBatchSync(const std::vector<const CBlockIndex*>& blockin
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex) {
+    return Read(make_pair(DB_BLOCK_INDEX, blockhash), dbindex);
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
-    return Read(make_pair(DB_TXINDEX, txid), pos);
+    return ReadIndex(make_pair(DB_TXINDEX, txid), pos);
 }
 
-bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
-    CDBBatch batch(*this);
+template <typename Batch>
+static void BatchWriteTxIndex(Batch &batch, const std::vector<std::pair<uint256, CDiskTxPos> >&vect)
+{
     for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_TXINDEX, it->first), it->second);
-    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    BatchWriteTxIndex(indexWrites, vect);
+    return !fIndexWriteFailed;
 }
 
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(make_pair(DB_SPENTINDEX, key), value);
+    return ReadIndex(make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
+template <typename Batch>
+static void BatchUpdateSpentIndex(Batch &batch, const std::vector<CSpentIndexDbEntry> &vect)
+{
     for (std::vector<CSpentIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_SPENTINDEX, it->first));
@@ -316,11 +878,17 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect)
             batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect) {
-    CDBBatch batch(*this);
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect) {
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    BatchUpdateSpentIndex(indexWrites, vect);
+    return !fIndexWriteFailed;
+}
+
+template <typename Batch>
+static void BatchUpdateAddressUnspentIndex(Batch &batch, const std::vector<CAddressUnspentDbEntry> &vect)
+{
     for (std::vector<CAddressUnspentDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
@@ -328,12 +896,17 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDb
             batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect) {
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    BatchUpdateAddressUnspentIndex(indexWrites, vect);
+    return !fIndexWriteFailed;
 }
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CIndexOverlayIterator> pcursor(NewOverlayIterator());
 
     pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
 
@@ -365,18 +938,216 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::v
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
+template <typename Batch>
+static void BatchWriteAddressIndex(Batch &batch, const std::vector<CAddressIndexDbEntry> &vect)
+{
     for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
+template <typename Batch>
+static void BatchEraseAddressIndex(Batch &batch, const std::vector<CAddressIndexDbEntry> &vect)
+{
     for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    BatchWriteAddressIndex(indexWrites, vect);
+    return !fIndexWriteFailed;
+}
+
+bool CBlockTreeDB::EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    BatchEraseAddressIndex(indexWrites, vect);
+    return !fIndexWriteFailed;
+}
+
+// output records are kept while an output is spent, so disconnecting the spending block can restore its entries
+template <typename Batch>
+static void BatchWriteAssetOutputs(Batch &batch, const std::vector<CAssetIndexDbEntry> &vect, bool fRecords)
+{
+    for (std::vector<CAssetIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (fRecords)
+            batch.Write(make_pair(DB_ASSETOUTPUT, it->first), it->second);
+        if (it->second.IsBalance())
+            batch.Write(make_pair(DB_ASSETBALANCE, CAssetBalanceKey(it->second.tokenid, it->second.hashBytes, it->first)), it->second.satoshis);
+        if (it->second.IsOrder())
+            batch.Write(make_pair(DB_ASSETORDER, CAssetOrderKey(it->first, it->second)), it->second);
+    }
+}
+
+template <typename Batch>
+static void BatchEraseAssetOutputs(Batch &batch, const std::vector<CAssetIndexDbEntry> &vect, bool fRecords)
+{
+    for (std::vector<CAssetIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (fRecords)
+            batch.Erase(make_pair(DB_ASSETOUTPUT, it->first));
+        if (it->second.IsBalance())
+            batch.Erase(make_pair(DB_ASSETBALANCE, CAssetBalanceKey(it->second.tokenid, it->second.hashBytes, it->first)));
+        if (it->second.IsOrder())
+            batch.Erase(make_pair(DB_ASSETORDER, CAssetOrderKey(it->first, it->second)));
+    }
+}
+
+bool CBlockTreeDB::ReadAssetOutput(const COutPoint &output, CAssetOutputValue &value) {
+    return ReadIndex(make_pair(DB_ASSETOUTPUT, output), value);
+}
+
+bool CBlockTreeDB::ReadAssetBalances(const uint256 &tokenid, const uint160 &addressHash, std::vector<CAssetBalanceDbEntry> &vect)
+{
+    boost::scoped_ptr<CIndexOverlayIterator> pcursor(NewOverlayIterator());
+
+    pcursor->Seek(make_pair(DB_ASSETBALANCE, CAssetBalanceIteratorKey(tokenid, addressHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CAssetBalanceKey> keyObj;
+            pcursor->GetKey(keyObj);
+            if (keyObj.first != DB_ASSETBALANCE || keyObj.second.tokenid != tokenid || keyObj.second.hashBytes != addressHash) {
+                break;
+            }
+            CAmount nValue;
+            if (!pcursor->GetValue(nValue)) {
+                return error("failed to get asset balance value");
+            }
+            vect.push_back(make_pair(COutPoint(keyObj.second.txhash, keyObj.second.index), nValue));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAssetOrders(const uint256 &tokenid, std::vector<CAssetIndexDbEntry> &vect)
+{
+    boost::scoped_ptr<CIndexOverlayIterator> pcursor(NewOverlayIterator());
+
+    if (tokenid.IsNull()) {
+        pcursor->Seek(DB_ASSETORDER);
+    } else {
+        pcursor->Seek(make_pair(DB_ASSETORDER, CAssetOrderIteratorKey(tokenid)));
+    }
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CAssetOrderKey> keyObj;
+            pcursor->GetKey(keyObj);
+            if (keyObj.first != DB_ASSETORDER || (!tokenid.IsNull() && keyObj.second.tokenid != tokenid)) {
+                break;
+            }
+            CAssetOutputValue value;
+            if (!pcursor->GetValue(value)) {
+                return error("failed to get asset order value");
+            }
+            vect.push_back(make_pair(COutPoint(keyObj.second.txhash, keyObj.second.index), value));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadOracleSamples(const uint256 &oracletxid, std::vector<COracleSampleDbEntry> &vect)
+{
+    boost::scoped_ptr<CIndexOverlayIterator> pcursor(NewOverlayIterator());
+
+    pcursor->Seek(make_pair(DB_ORACLESAMPLE, COracleSampleIteratorKey(oracletxid)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, COracleSampleKey> keyObj;
+            pcursor->GetKey(keyObj);
+            if (keyObj.first != DB_ORACLESAMPLE || keyObj.second.oracletxid != oracletxid) {
+                break;
+            }
+            COracleSampleValue value;
+            if (!pcursor->GetValue(value)) {
+                return error("failed to get oracle sample value");
+            }
+            vect.push_back(make_pair(keyObj.second, value));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadRetainedTransaction(const uint256 &txid, CRetainedTransaction &retained)
+{
+    return ReadIndex(make_pair(DB_RETAINEDTX, txid), retained);
+}
+
+bool CBlockTreeDB::WriteBlockIndexes(const std::vector<std::pair<uint256, CDiskTxPos> > &txIndex,
+                                     const std::vector<CAddressIndexDbEntry> &addressIndex,
+                                     const std::vector<CAddressUnspentDbEntry> &addressUnspentIndex,
+                                     const std::vector<CSpentIndexDbEntry> &spentIndex,
+                                     const std::vector<CAssetIndexDbEntry> &assetOutputs,
+                                     const std::vector<CAssetIndexDbEntry> &assetSpends,
+                                     const std::vector<COracleSampleDbEntry> &oracleSamples,
+                                     const std::vector<CRetainedTransactionDbEntry> &retainedTxs,
+                                     const CTimestampIndexKey *pTimestampIndex,
+                                     const CTimestampBlockIndexKey *pTimestampBlockKey,
+                                     const CTimestampBlockIndexValue *pTimestampBlockValue) {
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    if (fIndexWriteFailed)
+        return false;
+    CIndexWriteSet &batch = indexWrites;
+    BatchWriteTxIndex(batch, txIndex);
+    BatchWriteAddressIndex(batch, addressIndex);
+    BatchUpdateAddressUnspentIndex(batch, addressUnspentIndex);
+    BatchUpdateSpentIndex(batch, spentIndex);
+    // outputs created and spent in the same block are written, then erased
+    BatchWriteAssetOutputs(batch, assetOutputs, true);
+    BatchEraseAssetOutputs(batch, assetSpends, false);
+    for (std::vector<COracleSampleDbEntry>::const_iterator it=oracleSamples.begin(); it!=oracleSamples.end(); it++)
+        batch.Write(make_pair(DB_ORACLESAMPLE, it->first), it->second);
+    for (std::vector<CRetainedTransactionDbEntry>::const_iterator it=retainedTxs.begin(); it!=retainedTxs.end(); it++)
+        batch.Write(make_pair(DB_RETAINEDTX, it->first), it->second);
+    if (pTimestampIndex) {
+        batch.Write(make_pair(DB_TIMESTAMPINDEX, *pTimestampIndex), 0);
+    }
+    if (pTimestampBlockKey && pTimestampBlockValue) {
+        batch.Write(make_pair(DB_BLOCKHASHINDEX, *pTimestampBlockKey), *pTimestampBlockValue);
+    }
+    batch.nBlocks++;
+    if (batch.nSize > MAX_INDEX_WRITE_SET_SIZE)
+        return HandOverIndexes(lock);
+    return true;
+}
+
+bool CBlockTreeDB::EraseBlockIndexes(const std::vector<CAddressIndexDbEntry> &addressIndex,
+                                     const std::vector<CAddressUnspentDbEntry> &addressUnspentIndex,
+                                     const std::vector<CSpentIndexDbEntry> &spentIndex,
+                                     const std::vector<CAssetIndexDbEntry> &assetOutputs,
+                                     const std::vector<CAssetIndexDbEntry> &assetSpends,
+                                     const std::vector<COracleSampleDbEntry> &oracleSamples,
+                                     const std::vector<uint256> &retainedTxids) {
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    if (fIndexWriteFailed)
+        return false;
+    CIndexWriteSet &batch = indexWrites;
+    BatchEraseAddressIndex(batch, addressIndex);
+    BatchUpdateAddressUnspentIndex(batch, addressUnspentIndex);
+    BatchUpdateSpentIndex(batch, spentIndex);
+    // spent outputs are restored before the block's own outputs are removed, in case it spent some of them
+    BatchWriteAssetOutputs(batch, assetSpends, false);
+    BatchEraseAssetOutputs(batch, assetOutputs, true);
+    for (std::vector<COracleSampleDbEntry>::const_iterator it=oracleSamples.begin(); it!=oracleSamples.end(); it++)
+        batch.Erase(make_pair(DB_ORACLESAMPLE, it->first));
+    for (std::vector<uint256>::const_iterator it=retainedTxids.begin(); it!=retainedTxids.end(); it++)
+        batch.Erase(make_pair(DB_RETAINEDTX, *it));
+    batch.nBlocks++;
+    if (batch.nSize > MAX_INDEX_WRITE_SET_SIZE)
+        return HandOverIndexes(lock);
+    return true;
 }
 
 bool CBlockTreeDB::ReadAddressIndex(
@@ -384,7 +1155,7 @@ bool CBlockTreeDB::ReadAddressIndex(
         std::vector<CAddressIndexDbEntry> &addressIndex,
         int start, int end)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CIndexOverlayIterator> pcursor(NewOverlayIterator());
 
     if (start > 0 && end > 0) {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
@@ -430,6 +1201,8 @@ UniValue CBlockTreeDB::Snapshot(int top)
 {
     int64_t total = 0; int64_t totalAddresses = 0; std::string address;
     int64_t utxos = 0; int64_t ignoredAddresses;
+    // this walks the whole database backwards, so the gathered index entries are written out rather than overlaid
+    SyncIndexes();
     boost::scoped_ptr<CDBIterator> iter(NewIterator());
     std::map <std::string, CAmount> addressAmounts;
     std::vector <std::pair<CAmount, std::string>> vaddr;
@@ -561,14 +1334,14 @@ UniValue CBlockTreeDB::Snapshot(int top)
 }
 
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    indexWrites.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    return !fIndexWriteFailed;
 }
 
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CIndexOverlayIterator> pcursor(NewOverlayIterator());
 
     pcursor->Seek(make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
@@ -602,15 +1375,15 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
 }
 
 bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CDBBatch batch(*this);
-    batch.Write(make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
+    boost::unique_lock<boost::mutex> lock(cs_indexes);
+    indexWrites.Write(make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
+    return !fIndexWriteFailed;
 }
 
 bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
 
     CTimestampBlockIndexValue(lts);
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
+    if (!ReadIndex(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
 	    return false;
 
     ltimestamp = lts.ltimestamp;
@@ -648,6 +1421,35 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
 
     pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // header hashes are verified a batch at a time on the header check threads, and each entry's solution is
+    // trimmed only after its hash has been verified
+    std::vector<CBlockIndex *> batchIndexes;
+    std::vector<CBlockHeader> batchHeaders;
+    std::vector<uint256> batchHashes;
+    auto verifyBatch = [&]() -> bool {
+        std::vector<uint256> hashes;
+        int i = -1;
+        if (!GetBlockHeaderHashes(batchHeaders, hashes, &batchHashes, &i))
+        {
+            // the queue skips the checks after a failure, so only the failing check's hash is reliable
+            if (i < 0 || i >= (int)batchIndexes.size())
+                return error("LoadBlockIndex(): block header inconsistency detected");
+            printf("Error -- hashes don't match.\nheader.GetHash: %s\nGetBlockHash(): %s\nin memory: %s\n",
+                   hashes[i].GetHex().c_str(), batchHashes[i].GetHex().c_str(), batchIndexes[i]->ToString().c_str());
+            return error("LoadBlockIndex(): block header inconsistency detected: header hash = %s, in-memory = %s",
+                         hashes[i].GetHex(), batchIndexes[i]->ToString());
+        }
+        for (auto pindex : batchIndexes)
+        {
+            // the entry is on disk, so the solution can be read back when needed
+            pindex->TrimSolution();
+        }
+        batchIndexes.clear();
+        batchHeaders.clear();
+        batchHashes.clear();
+        return true;
+    };
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -675,29 +1477,20 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 pindexNew->nTime          = diskindex.nTime;
                 pindexNew->nBits          = diskindex.nBits;
                 pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nSolution      = diskindex.nSolution;
+                pindexNew->SetSolution(diskindex.GetDiskSolution());
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
                 pindexNew->nTx            = diskindex.nTx;
                 pindexNew->nSproutValue   = diskindex.nSproutValue;
                 pindexNew->nSaplingValue  = diskindex.nSaplingValue;
 
-                // Consistency checks
+                // Consistency checks, the header's hash is checked against the index hash in verifyBatch
                 auto header = pindexNew->GetBlockHeader();
-                uint256 hash = header.GetHash();
-                if (diskindex.hashPrev.IsNull() && hash != Params().consensus.hashGenesisBlock)
+                if (diskindex.hashPrev.IsNull() && pindexNew->GetBlockHash() != Params().consensus.hashGenesisBlock)
                 {
                     return error("LoadBlockIndex(): prior block hash NULL on non-genesis block: %s\n", diskindex.ToString());
                 }
 
-                if (hash != pindexNew->GetBlockHash())
-                {
-                    printf("Error -- hashes don't match.\nheader.GetHash: %s\nGetBlockHash(): %s\non disk: %s\nin memory: %s\n",
-                           hash.GetHex().c_str(), pindexNew->GetBlockHash().GetHex().c_str(), diskindex.ToString().c_str(),  pindexNew->ToString().c_str());
-                    return error("LoadBlockIndex(): block header inconsistency detected: on-disk = %s, in-memory = %s",
-                                 diskindex.ToString(),  pindexNew->ToString());
-                }
-
                 if ( 0 ) // POW will be checked before any block is connected
                 {
                     uint8_t pubkey33[33];
@@ -705,6 +1498,14 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                     if (!CheckProofOfWork(header,pubkey33,pindexNew->GetHeight(),Params().GetConsensus()))
                         return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
                 }
+
+                batchIndexes.push_back(pindexNew);
+                batchHeaders.push_back(header);
+                batchHashes.push_back(pindexNew->GetBlockHash());
+                if (batchIndexes.size() >= BLOCK_INDEX_HASH_BATCH && !verifyBatch())
+                {
+                    return false;
+                }
                 pcursor->Next();
             } else {
                 return error("LoadBlockIndex() : failed to read value");
@@ -714,5 +1515,5 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
         }
     }
 
-    return true;
+    return verifyBatch();
 }
@@ -9,6 +9,10 @@
 #include "coins.h"
 #include "dbwrapper.h"
 #include "chain.h"
+#include "sync.h"
+#include "assetindex.h"
+#include "oracleindex.h"
+#include "proofindex.h"
 
 #include <map>
 #include <string>
@@ -17,6 +21,7 @@
 #include <univalue.h>
 
 #include <boost/function.hpp>
+#include <boost/thread.hpp>
 
 class CBlockIndex;
 struct CDiskTxPos;
@@ -44,6 +49,10 @@ static const int64_t nDefaultDbCache = 450;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -asyncflush default
+static const bool DEFAULT_ASYNC_FLUSH = true;
+//! serialized size of the block index mutations held in memory before they are handed to the database
+static const size_t MAX_INDEX_WRITE_SET_SIZE = 32 << 20;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -70,14 +79,59 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With an asynchronous writer, BatchWrite takes over the maps it is given and returns at once, and a background
+ * thread writes them to the database while the caller goes on with an empty cache. Until that write is done,
+ * lookups of the entries in it are answered from the maps. Only one write is pending at a time, and a second
+ * BatchWrite waits for the first one. Each write carries its best block in the same database batch, so the
+ * chainstate on disk is always consistent with the block it names.
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    //! a write handed to the writer thread, which only reads it until it is on disk
+    struct CPendingWrite
+    {
+        CCoinsMap mapCoins;
+        uint256 hashBlock;
+        uint256 hashSproutAnchor;
+        uint256 hashSaplingAnchor;
+        CAnchorsSproutMap mapSproutAnchors;
+        CAnchorsSaplingMap mapSaplingAnchors;
+        CNullifiersMap mapSproutNullifiers;
+        CNullifiersMap mapSaplingNullifiers;
+        size_t nUsage;
+
+        CPendingWrite() : nUsage(0) {}
+        void Swap(CPendingWrite &other);
+    };
+
+    bool fAsyncWrite;
+    mutable CWaitableCriticalSection cs_pending;
+    mutable CConditionVariable condPending;
+    boost::thread writerThread;
+    bool fPending;                      // a write is waiting for or being written by the writer thread
+    bool fWriteFailed;                  // the pending write failed and stays in place while the node shuts down
+    bool fStopWriter;
+    CPendingWrite pending;
+
+    // totals for the bench log
+    uint64_t nWrites;
+    int64_t nWriteMicros;
+    int64_t nStallMicros;
+
+    bool WritePending(const CPendingWrite &write);
+    bool WaitForPending() const;
+    void ThreadWriteCoins();
+
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool fAsync = false);
+    ~CCoinsViewDB();
 
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
@@ -95,19 +149,107 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    bool SyncWrites();
+    size_t PendingWriteUsage() const;
 };
 
-/** Access to the block database (blocks/index/) */
+/**
+ * Index mutations of a run of connected and disconnected blocks that are not on disk yet. Keys and values are kept
+ * serialized, in the database's own order, and a later write or erase of a key replaces the earlier one, so the
+ * run is merged into a single batch.
+ */
+class CIndexWriteSet
+{
+public:
+    struct CEntry
+    {
+        bool fErase;
+        std::string value;
+    };
+    typedef std::map<std::string, CEntry> EntryMap;
+
+    EntryMap mapEntries;
+    int nBlocks;
+    size_t nSize;
+
+    CIndexWriteSet() : nBlocks(0), nSize(0) {}
+
+    template <typename K, typename V>
+    void Write(const K& key, const V& value)
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << value;
+        Put(ssKey.str(), false, ssValue.str());
+    }
+
+    template <typename K>
+    void Erase(const K& key)
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        Put(ssKey.str(), true, std::string());
+    }
+
+    //! the entry for a serialized key, or NULL if the run doesn't change it
+    const CEntry *Find(const std::string &key) const;
+    bool IsEmpty() const { return mapEntries.empty(); }
+    void Clear();
+    void Swap(CIndexWriteSet &other);
+
+private:
+    void Put(const std::string &key, bool fErase, const std::string &value);
+};
+
+class CIndexOverlayIterator;
+
+/**
+ * Access to the block database (blocks/index/)
+ *
+ * The index entries of connected and disconnected blocks are gathered in a write set, which is handed to the
+ * database when it grows past MAX_INDEX_WRITE_SET_SIZE or when the chain state is flushed. With an asynchronous
+ * writer, a background thread writes each handed over set as one batch, and a set is only handed over once the one
+ * before it is on disk, so runs are committed in order. Index reads see the sets that are not on disk yet through
+ * an overlay.
+ */
 class CBlockTreeDB : public CDBWrapper
 {
+    friend class CIndexOverlayIterator;
+
 public:
-    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = true, int maxOpenFiles = 1000);
+    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = true, int maxOpenFiles = 1000, bool fAsync = false);
+    ~CBlockTreeDB();
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
+
+    bool fAsyncIndexes;
+    mutable CWaitableCriticalSection cs_indexes;
+    mutable CConditionVariable condIndexes;
+    boost::thread indexWriterThread;
+    CIndexWriteSet indexWrites;         // blocks connected or disconnected since the last hand over
+    CIndexWriteSet indexWriting;        // handed to the writer thread, which only reads it until it is on disk
+    bool fIndexWriting;
+    bool fIndexWriteFailed;             // the handed over set failed and stays in the overlay while the node shuts down
+    bool fStopIndexWriter;
+
+    // totals for the bench log
+    uint64_t nIndexWrites;
+    int64_t nIndexWriteMicros;
+
+    bool WriteIndexSet(const CIndexWriteSet &set);
+    bool HandOverIndexes(boost::unique_lock<boost::mutex> &lock);
+    void ThreadWriteIndexes();
+    //! read a key from the sets that are not on disk yet, newest first, or else from the database
+    template <typename K, typename V>
+    bool ReadIndex(const K &key, V &value) const;
+    CIndexOverlayIterator *NewOverlayIterator();
+
 public:
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
+    bool ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
@@ -121,6 +263,32 @@ public:
     bool WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
     bool EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
     bool ReadAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
+    bool ReadAssetOutput(const COutPoint &output, CAssetOutputValue &value);
+    bool ReadAssetBalances(const uint256 &tokenid, const uint160 &addressHash, std::vector<CAssetBalanceDbEntry> &vect);
+    //! open orders for one token, or for all tokens if tokenid is null
+    bool ReadAssetOrders(const uint256 &tokenid, std::vector<CAssetIndexDbEntry> &vect);
+    bool ReadOracleSamples(const uint256 &oracletxid, std::vector<COracleSampleDbEntry> &vect);
+    bool ReadRetainedTransaction(const uint256 &txid, CRetainedTransaction &retained);
+    //! write all index entries produced by connecting one block in a single batch
+    bool WriteBlockIndexes(const std::vector<std::pair<uint256, CDiskTxPos> > &txIndex,
+                           const std::vector<CAddressIndexDbEntry> &addressIndex,
+                           const std::vector<CAddressUnspentDbEntry> &addressUnspentIndex,
+                           const std::vector<CSpentIndexDbEntry> &spentIndex,
+                           const std::vector<CAssetIndexDbEntry> &assetOutputs,
+                           const std::vector<CAssetIndexDbEntry> &assetSpends,
+                           const std::vector<COracleSampleDbEntry> &oracleSamples,
+                           const std::vector<CRetainedTransactionDbEntry> &retainedTxs,
+                           const CTimestampIndexKey *pTimestampIndex = NULL,
+                           const CTimestampBlockIndexKey *pTimestampBlockKey = NULL,
+                           const CTimestampBlockIndexValue *pTimestampBlockValue = NULL);
+    //! remove or restore all index entries for one disconnected block in a single batch
+    bool EraseBlockIndexes(const std::vector<CAddressIndexDbEntry> &addressIndex,
+                           const std::vector<CAddressUnspentDbEntry> &addressUnspentIndex,
+                           const std::vector<CSpentIndexDbEntry> &spentIndex,
+                           const std::vector<CAssetIndexDbEntry> &assetOutputs,
+                           const std::vector<CAssetIndexDbEntry> &assetSpends,
+                           const std::vector<COracleSampleDbEntry> &oracleSamples,
+                           const std::vector<uint256> &retainedTxids);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
@@ -130,6 +298,10 @@ public:
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
     bool blockOnchainActive(const uint256 &hash);
     UniValue Snapshot(int top);
+    //! hand the gathered index entries to the database
+    bool FlushIndexes();
+    //! hand the gathered index entries to the database and wait until they are on disk
+    bool SyncIndexes();
 };
 
 #endif // BITCOIN_TXDB_H
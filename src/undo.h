@@ -10,6 +10,9 @@
 #include "primitives/transaction.h"
 #include "serialize.h"
 
+#include <limits>
+#include <map>
+
 /** Undo information for a CTxIn
  *
  *  Contains the prevout's CTxOut being spent, and if this was the
@@ -62,19 +65,195 @@ public:
     }
 };
 
-/** Undo information for a CBlock */
+/** Undo information for a CBlock
+ *
+ *  Legacy undo data is the serialized vector of CTxUndo records. The columnar
+ *  format starts with a byte that cannot begin the legacy encoding, followed by
+ *  a format version, then stores the inputs of all transactions column by column:
+ *  the distinct scripts spent in the block once each, an index into them for every
+ *  input, the compressed amounts, the height and coinbase codes as deltas from the
+ *  previous input and the versions of the inputs that carry one. Blocks read in
+ *  either format are hashed and rewritten in that format.
+ */
 class CBlockUndo
 {
 public:
+    enum {
+        FORMAT_LEGACY = 0,
+        FORMAT_COLUMNAR = 1,
+    };
+    // a legacy compact size of 2^32 or more, which is far beyond any block
+    static const uint8_t COLUMNAR_MARKER = 0xff;
+    static const uint8_t COLUMNAR_VERSION = 1;
+
     std::vector<CTxUndo> vtxundo; // for all but the coinbase
     uint256 old_sprout_tree_root;
+    uint8_t nFormat;
 
-    ADD_SERIALIZE_METHODS;
+    CBlockUndo(uint8_t nFormatIn = FORMAT_COLUMNAR) : nFormat(nFormatIn) {}
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(vtxundo);
-        READWRITE(old_sprout_tree_root);
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        if (nFormat == FORMAT_COLUMNAR) {
+            SerializeColumnar(s);
+            return;
+        }
+        ::Serialize(s, vtxundo);
+        ::Serialize(s, old_sprout_tree_root);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        uint8_t chSize = ser_readdata8(s);
+        if (chSize == COLUMNAR_MARKER) {
+            nFormat = FORMAT_COLUMNAR;
+            UnserializeColumnar(s);
+            return;
+        }
+
+        // the first byte was the start of the compact size of vtxundo
+        nFormat = FORMAT_LEGACY;
+        uint64_t nTxUndo = chSize;
+        if (chSize == 253)
+            nTxUndo = ser_readdata16(s);
+        else if (chSize == 254)
+            nTxUndo = ser_readdata32(s);
+        if (nTxUndo > (uint64_t)MAX_SIZE)
+            throw std::ios_base::failure("CBlockUndo::Unserialize(): size too large");
+        vtxundo.clear();
+        for (uint64_t i = 0; i < nTxUndo; i++) {
+            vtxundo.emplace_back();
+            ::Unserialize(s, vtxundo.back());
+        }
+        ::Unserialize(s, old_sprout_tree_root);
+    }
+
+private:
+    static uint64_t ZigZag(int64_t n) { return ((uint64_t)n << 1) ^ (uint64_t)(n >> 63); }
+    static int64_t UnZigZag(uint64_t n) { return (int64_t)(n >> 1) ^ -(int64_t)(n & 1); }
+
+    template<typename Stream>
+    void SerializeColumnar(Stream &s) const {
+        ser_writedata8(s, COLUMNAR_MARKER);
+        ser_writedata8(s, COLUMNAR_VERSION);
+        ::Serialize(s, old_sprout_tree_root);
+
+        WriteCompactSize(s, vtxundo.size());
+        for (const CTxUndo &txundo : vtxundo) {
+            uint64_t nTxInputs = txundo.vprevout.size();
+            ::Serialize(s, VARINT(nTxInputs));
+        }
+
+        // scripts, each stored once in order of first use
+        std::map<CScript, uint64_t> mapScriptIndex;
+        std::vector<const CScript *> vScripts;
+        std::vector<uint64_t> vScriptIndex;
+        for (const CTxUndo &txundo : vtxundo) {
+            for (const CTxInUndo &undo : txundo.vprevout) {
+                auto it = mapScriptIndex.insert(std::make_pair(undo.txout.scriptPubKey, (uint64_t)vScripts.size()));
+                if (it.second)
+                    vScripts.push_back(&it.first->first);
+                vScriptIndex.push_back(it.first->second);
+            }
+        }
+        WriteCompactSize(s, vScripts.size());
+        for (const CScript *pScript : vScripts)
+            ::Serialize(s, CScriptCompressor(REF(*pScript)));
+        for (uint64_t nIndex : vScriptIndex)
+            ::Serialize(s, VARINT(nIndex));
+
+        for (const CTxUndo &txundo : vtxundo) {
+            for (const CTxInUndo &undo : txundo.vprevout) {
+                uint64_t nValue = CTxOutCompressor::CompressAmount(undo.txout.nValue);
+                ::Serialize(s, VARINT(nValue));
+            }
+        }
+
+        // inputs of a transaction are often created at the same height, so the heights are stored as deltas
+        int64_t nPrevCode = 0;
+        for (const CTxUndo &txundo : vtxundo) {
+            for (const CTxInUndo &undo : txundo.vprevout) {
+                int64_t nCode = (int64_t)undo.nHeight * 2 + (undo.fCoinBase ? 1 : 0);
+                uint64_t nDelta = ZigZag(nCode - nPrevCode);
+                ::Serialize(s, VARINT(nDelta));
+                nPrevCode = nCode;
+            }
+        }
+
+        for (const CTxUndo &txundo : vtxundo) {
+            for (const CTxInUndo &undo : txundo.vprevout) {
+                if (undo.nHeight > 0)
+                    ::Serialize(s, VARINT(undo.nVersion));
+            }
+        }
+    }
+
+    template<typename Stream>
+    void UnserializeColumnar(Stream &s) {
+        uint8_t nVersion = ser_readdata8(s);
+        if (nVersion != COLUMNAR_VERSION)
+            throw std::ios_base::failure("CBlockUndo::Unserialize(): unknown undo format version");
+        ::Unserialize(s, old_sprout_tree_root);
+
+        // everything is allocated as it is read, so a corrupt count cannot make us allocate much more
+        // than the data itself
+        uint64_t nTxUndo = ReadCompactSize(s);
+        std::vector<uint64_t> vTxInputs;
+        for (uint64_t i = 0; i < nTxUndo; i++) {
+            uint64_t nTxInputs = 0;
+            ::Unserialize(s, VARINT(nTxInputs));
+            vTxInputs.push_back(nTxInputs);
+        }
+
+        uint64_t nScripts = ReadCompactSize(s);
+        std::vector<CScript> vScripts;
+        for (uint64_t i = 0; i < nScripts; i++) {
+            vScripts.emplace_back();
+            ::Unserialize(s, REF(CScriptCompressor(vScripts.back())));
+        }
+
+        vtxundo.clear();
+        for (uint64_t nTxInputs : vTxInputs) {
+            vtxundo.emplace_back();
+            std::vector<CTxInUndo> &vprevout = vtxundo.back().vprevout;
+            for (uint64_t i = 0; i < nTxInputs; i++) {
+                uint64_t nIndex = 0;
+                ::Unserialize(s, VARINT(nIndex));
+                if (nIndex >= vScripts.size())
+                    throw std::ios_base::failure("CBlockUndo::Unserialize(): script index out of range");
+                vprevout.emplace_back();
+                vprevout.back().txout.scriptPubKey = vScripts[nIndex];
+            }
+        }
+
+        for (CTxUndo &txundo : vtxundo) {
+            for (CTxInUndo &undo : txundo.vprevout) {
+                uint64_t nValue = 0;
+                ::Unserialize(s, VARINT(nValue));
+                undo.txout.nValue = CTxOutCompressor::DecompressAmount(nValue);
+            }
+        }
+
+        int64_t nPrevCode = 0;
+        for (CTxUndo &txundo : vtxundo) {
+            for (CTxInUndo &undo : txundo.vprevout) {
+                uint64_t nDelta = 0;
+                ::Unserialize(s, VARINT(nDelta));
+                int64_t nCode = nPrevCode + UnZigZag(nDelta);
+                if (nCode < 0 || nCode > 2 * (int64_t)std::numeric_limits<unsigned int>::max() + 1)
+                    throw std::ios_base::failure("CBlockUndo::Unserialize(): height out of range");
+                undo.nHeight = nCode / 2;
+                undo.fCoinBase = nCode & 1;
+                nPrevCode = nCode;
+            }
+        }
+
+        for (CTxUndo &txundo : vtxundo) {
+            for (CTxInUndo &undo : txundo.vprevout) {
+                if (undo.nHeight > 0)
+                    ::Unserialize(s, VARINT(undo.nVersion));
+            }
+        }
     }
 };
 
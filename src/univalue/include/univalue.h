@@ -11,6 +11,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <cassert>
 
 #include <sstream>        // .get_int64()
@@ -47,8 +49,13 @@ public:
         std::string s(val_);
         setStr(s);
     }
+    UniValue(const UniValue& other);
+    UniValue(UniValue&& other) = default;
     ~UniValue() {}
 
+    UniValue& operator=(const UniValue& other);
+    UniValue& operator=(UniValue&& other) = default;
+
     void clear();
 
     bool setNull();
@@ -147,11 +154,17 @@ private:
     std::string val;                       // numbers are stored as C++ strings
     std::vector<std::string> keys;
     std::vector<UniValue> values;
+    // position of the first occurrence of each key, only kept for large objects
+    std::unique_ptr<std::unordered_map<std::string, size_t> > keyIndex;
 
+    void indexKey(size_t i);
     bool findKey(const std::string& key, size_t& ret) const;
+    void writeTo(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
+    friend class UniValueWriter;
+
 public:
     // Strict type-specific getters, these throw std::runtime_error if the
     // value is of unexpected type
@@ -172,6 +185,44 @@ public:
     friend const UniValue& find_value( const UniValue& obj, const std::string& name);
 };
 
+/**
+ * Writes compact JSON straight into a string, for results too large to build as a UniValue tree
+ * before serializing them. Members may be ready made UniValue subtrees, and the output is the
+ * same as write() of the equivalent tree.
+ */
+class UniValueWriter {
+public:
+    UniValueWriter(std::string& out) : s(out), fAfterKey(false) {}
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(const std::string& key);
+    void value(const UniValue& val);
+
+    // the same calls used to build objects and arrays of a tree
+    bool pushKV(const std::string& key_, const UniValue& val) {
+        key(key_);
+        value(val);
+        return true;
+    }
+    bool push_back(const UniValue& val) {
+        value(val);
+        return true;
+    }
+    bool push_back(std::pair<std::string,UniValue> pear) {
+        return pushKV(pear.first, pear.second);
+    }
+
+private:
+    std::string& s;
+    std::vector<bool> containerEmpty;   // for each open object or array, whether nothing was written to it yet
+    bool fAfterKey;
+
+    void separate();
+};
+
 //
 // The following were added for compatibility with json_spirit.
 // Most duplicate other methods, and should be removed.
@@ -79,12 +79,31 @@ using namespace std;
 
 const UniValue NullUniValue;
 
+// objects with fewer keys are searched linearly
+static const size_t KEY_INDEX_MIN_KEYS = 32;
+
+UniValue::UniValue(const UniValue& other) : typ(other.typ), val(other.val), keys(other.keys), values(other.values)
+{
+    if (other.keyIndex)
+        keyIndex.reset(new std::unordered_map<std::string, size_t>(*other.keyIndex));
+}
+
+UniValue& UniValue::operator=(const UniValue& other)
+{
+    if (this != &other) {
+        UniValue tmp(other);
+        *this = std::move(tmp);
+    }
+    return *this;
+}
+
 void UniValue::clear()
 {
     typ = VNULL;
     val.clear();
     keys.clear();
     values.clear();
+    keyIndex.reset();
 }
 
 bool UniValue::setNull()
@@ -198,6 +217,7 @@ bool UniValue::pushKV(const std::string& key, const UniValue& val_)
 
     keys.push_back(key);
     values.push_back(val_);
+    indexKey(keys.size() - 1);
     return true;
 }
 
@@ -209,13 +229,38 @@ bool UniValue::pushKVs(const UniValue& obj)
     for (unsigned int i = 0; i < obj.keys.size(); i++) {
         keys.push_back(obj.keys[i]);
         values.push_back(obj.values.at(i));
+        indexKey(keys.size() - 1);
     }
 
     return true;
 }
 
+void UniValue::indexKey(size_t i)
+{
+    if (!keyIndex) {
+        if (keys.size() < KEY_INDEX_MIN_KEYS)
+            return;
+        keyIndex.reset(new std::unordered_map<std::string, size_t>());
+        keyIndex->reserve(keys.size() * 2);
+        for (size_t j = 0; j < keys.size(); j++)
+            keyIndex->emplace(keys[j], j);
+        return;
+    }
+
+    // duplicate keys keep pointing to the first one, as with a linear search
+    keyIndex->emplace(keys[i], i);
+}
+
 bool UniValue::findKey(const std::string& key, size_t& ret) const
 {
+    if (keyIndex) {
+        std::unordered_map<std::string, size_t>::const_iterator it = keyIndex->find(key);
+        if (it == keyIndex->end())
+            return false;
+        ret = it->second;
+        return true;
+    }
+
     for (size_t i = 0; i < keys.size(); i++) {
         if (keys[i] == key) {
             ret = i;
@@ -280,9 +325,9 @@ const char *uvTypeName(UniValue::VType t)
 
 const UniValue& find_value(const UniValue& obj, const std::string& name)
 {
-    for (unsigned int i = 0; i < obj.keys.size(); i++)
-        if (obj.keys[i] == name)
-            return obj.values.at(i);
+    size_t index;
+    if (obj.findKey(name, index))
+        return obj.values.at(index);
 
     return NullUniValue;
 }
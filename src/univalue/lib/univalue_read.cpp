@@ -420,6 +420,7 @@ bool UniValue::read(const char *raw, size_t size)
             if (expect(OBJ_NAME)) {
                 UniValue *top = stack.back();
                 top->keys.push_back(tokenVal);
+                top->indexKey(top->keys.size() - 1);
                 clearExpect(OBJ_NAME);
                 setExpect(COLON);
             } else {
@@ -44,6 +44,11 @@
 #include <sys/resource.h>
 #include <sys/stat.h>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #else
 
 #ifdef _MSC_VER
@@ -77,8 +82,11 @@
 #endif
 
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
+#include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp> // for startswith() and endswith()
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/foreach.hpp>
@@ -1162,3 +1170,120 @@ int GetNumCores()
     return boost::thread::physical_concurrency();
 }
 
+#ifdef __linux__
+// reads a number from a sysfs file, or returns -1
+static int ReadSysfsInt(const boost::filesystem::path &path)
+{
+    boost::filesystem::ifstream file(path);
+    int value;
+    if (!(file >> value))
+    {
+        return -1;
+    }
+    return value;
+}
+
+// orders CPUs so the first logical CPU of every physical core comes before any second SMT sibling, by the core
+// and package ids in sysfs, as the OS numbering does not always do that
+static void SortCPUsByCore(std::vector<int> &cpus)
+{
+    boost::filesystem::path cpuDir("/sys/devices/system/cpu");
+    std::map<std::pair<int, int>, int> siblingsSeen;
+    std::vector<std::pair<int, int>> ranked;
+    std::sort(cpus.begin(), cpus.end());
+    for (int cpu : cpus)
+    {
+        boost::filesystem::path topology = cpuDir / strprintf("cpu%d", cpu) / "topology";
+        std::pair<int, int> core(ReadSysfsInt(topology / "physical_package_id"), ReadSysfsInt(topology / "core_id"));
+        // without a core id each CPU is taken as its own core
+        int rank = core.second < 0 ? 0 : siblingsSeen[core]++;
+        ranked.push_back(std::make_pair(rank, cpu));
+    }
+    std::sort(ranked.begin(), ranked.end());
+    for (size_t i = 0; i < ranked.size(); i++)
+    {
+        cpus[i] = ranked[i].second;
+    }
+}
+#endif
+
+std::vector<std::vector<int>> GetNUMANodeCPUs()
+{
+    std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+    boost::filesystem::path nodeDir("/sys/devices/system/node");
+    boost::system::error_code ec;
+    std::map<int, std::vector<int>> nodeMap;
+    for (boost::filesystem::directory_iterator it(nodeDir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::string name = it->path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") || name.find_first_not_of("0123456789", 4) != std::string::npos)
+        {
+            continue;
+        }
+
+        // cpulist is a comma separated list of CPUs and ranges of CPUs, such as "0-7,16-23"
+        boost::filesystem::ifstream cpuListFile(it->path() / "cpulist");
+        std::string cpuList;
+        if (!std::getline(cpuListFile, cpuList))
+        {
+            continue;
+        }
+        std::vector<std::string> ranges;
+        boost::split(ranges, cpuList, boost::is_any_of(","));
+        std::vector<int> cpus;
+        for (auto &range : ranges)
+        {
+            boost::trim(range);
+            if (range.empty())
+            {
+                continue;
+            }
+            size_t dash = range.find('-');
+            int first = atoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : atoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        if (cpus.size())
+        {
+            SortCPUsByCore(cpus);
+            nodeMap[atoi(name.substr(4))] = cpus;
+        }
+    }
+    for (auto &node : nodeMap)
+    {
+        nodes.push_back(node.second);
+    }
+#endif
+    if (nodes.empty())
+    {
+        std::vector<int> cpus;
+        for (int i = 0; i < (int)boost::thread::hardware_concurrency(); i++)
+        {
+            cpus.push_back(i);
+        }
+        // hardware_concurrency returns 0 when it cannot tell
+        if (cpus.size())
+        {
+            nodes.push_back(cpus);
+        }
+    }
+    return nodes;
+}
+
+bool SetThreadAffinity(int nCPU)
+{
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(nCPU, &cpuSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+    (void)nCPU;
+    return false;
+#endif
+}
+
@@ -254,6 +254,16 @@ int GetNumCores();
 void SetThreadPriority(int nPriority);
 void RenameThread(const char* name);
 
+/**
+ * Return the logical CPUs of each NUMA node, as reported by the OS, with the first CPU of each physical core
+ * ahead of SMT siblings where the core topology can be read. When the NUMA topology cannot be read, all CPUs
+ * are returned as a single node, and if the number of CPUs is unknown, no nodes are returned.
+ */
+std::vector<std::vector<int>> GetNUMANodeCPUs();
+
+/** Pin the calling thread to one logical CPU. Returns false where thread affinity is not supported. */
+bool SetThreadAffinity(int nCPU);
+
 /**
  * .. and a wrapper that just calls func once
  */
@@ -3689,16 +3689,82 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
                 std::vector<double> vals = benchmark_solve_equihash_threaded(nThreads);
                 sample_times.insert(sample_times.end(), vals.begin(), vals.end());
             }
+        } else if (benchmarktype == "verushash") {
+            // compare pinned with unpinned threads to measure -minerthreadaffinity
+            int nThreads = params.size() >= 3 ? params[2].get_int() : 1;
+            if (nThreads <= 0 || nThreads > GetNumCores()) {
+                throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Invalid thread count, must be from 1 to %d", GetNumCores()));
+            }
+            bool fPinned = params.size() >= 4 ? params[3].get_bool() : false;
+            std::vector<double> vals = benchmark_verus_hash_threaded(nThreads, fPinned);
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
 #endif
         } else if (benchmarktype == "verifyequihash") {
             sample_times.push_back(benchmark_verify_equihash());
+        } else if (benchmarktype == "harakakernels") {
+            // one sample per Haraka variant, cycles per byte are logged
+            std::vector<double> vals = benchmark_haraka_kernels();
+            sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+        } else if (benchmarktype == "verifyheaders") {
+            // a full headers message by default, and no more than fit in memory comfortably
+            static const int MAX_BENCHMARK_HEADERS = 100000;
+            int nHeaders = params.size() >= 3 ? params[2].get_int() : MAX_HEADERS_RESULTS;
+            if (nHeaders <= 0 || nHeaders > MAX_BENCHMARK_HEADERS) {
+                throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Invalid header count, must be from 1 to %d", MAX_BENCHMARK_HEADERS));
+            }
+            sample_times.push_back(benchmark_verify_headers(nHeaders));
+        } else if (benchmarktype == "assetindex") {
+            // token balance and order book queries on a chain with this many tokens
+            int nTokens = params.size() >= 3 ? params[2].get_int() : 5000;
+            if (nTokens <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid token count");
+            }
+            sample_times.push_back(benchmark_asset_index(nTokens));
+#ifndef _WIN32
+        } else if (benchmarktype == "socketevents") {
+            // ping latency and process cpu with many idle peers connected to this node, served by its -socketevents loop
+            int nConnections = params.size() >= 3 ? params[2].get_int() : 100;
+            if (nConnections <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid connection count");
+            }
+            try {
+                sample_times.push_back(benchmark_socket_events(nConnections));
+            } catch (const std::runtime_error &e) {
+                throw JSONRPCError(RPC_MISC_ERROR, e.what());
+            }
+#endif
+        } else if (benchmarktype == "crosschainrpc") {
+            // calls to a stand-in daemon on this host, with a connection per call and then with kept-alive connections
+            static const int MAX_BENCHMARK_RPC_CALLS = 100000;
+            int nCalls = params.size() >= 3 ? params[2].get_int() : 1000;
+            if (nCalls <= 0 || nCalls > MAX_BENCHMARK_RPC_CALLS) {
+                throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Invalid call count, must be from 1 to %d", MAX_BENCHMARK_RPC_CALLS));
+            }
+            try {
+                sample_times.push_back(benchmark_crosschain_rpc(nCalls));
+            } catch (const std::runtime_error &e) {
+                throw JSONRPCError(RPC_MISC_ERROR, e.what());
+            }
+        } else if (benchmarktype == "getblockjson") {
+            // getblock verbosity 2 of a block with this many transactions, written directly by default or as a tree
+            int nTxs = params.size() >= 3 ? params[2].get_int() : 10000;
+            bool fStream = params.size() >= 4 ? params[3].get_bool() : true;
+            if (nTxs <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid transaction count");
+            }
+            sample_times.push_back(benchmark_getblock_json(nTxs, fStream));
         } else if (benchmarktype == "validatelargetx") {
             // Number of inputs in the spending transaction that we will simulate
             int nInputs = 11130;
             if (params.size() >= 3) {
                 nInputs = params[2].get_int();
             }
-            sample_times.push_back(benchmark_large_tx(nInputs));
+            // Number of keys that must sign each input, as a bare multisig of up to 20 keys when more than one
+            int nSigners = params.size() >= 4 ? params[3].get_int() : 1;
+            if (nSigners < 1 || nSigners > 20) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of signers");
+            }
+            sample_times.push_back(benchmark_large_tx(nInputs, nSigners));
         } else if (benchmarktype == "trydecryptnotes") {
             int nKeys = params[2].get_int();
             sample_times.push_back(benchmark_try_decrypt_sprout_notes(nKeys));
@@ -3716,6 +3782,29 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
             }
             sample_times.push_back(benchmark_connectblock_slow());
+        } else if (benchmarktype == "disconnectblock") {
+            // restore the inputs of a block of this many transactions from undo data in the columnar or legacy format
+            int nTxs = params.size() >= 3 ? params[2].get_int() : 5000;
+            bool fColumnar = params.size() >= 4 ? params[3].get_bool() : true;
+            if (nTxs <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid transaction count");
+            }
+            sample_times.push_back(benchmark_disconnect_block(nTxs, fColumnar));
+        } else if (benchmarktype == "coinscache") {
+            // the coins cache updates alone of spending and creating transactions, with the cache holding this many
+            int nEntries = params.size() >= 3 ? params[2].get_int() : 1000000;
+            if (nEntries <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid entry count");
+            }
+            sample_times.push_back(benchmark_coins_cache(nEntries));
+        } else if (benchmarktype == "blockindexmemory") {
+            // measure the memory of a block index of this many entries before and after trimming solutions
+            static const int MAX_BENCHMARK_BLOCKS = 10000000;
+            int nBlocks = params.size() >= 3 ? params[2].get_int() : 100000;
+            if (nBlocks <= 0 || nBlocks > MAX_BENCHMARK_BLOCKS) {
+                throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Invalid block count, must be from 1 to %d", MAX_BENCHMARK_BLOCKS));
+            }
+            sample_times.push_back(benchmark_block_index_memory(nBlocks));
         } else if (benchmarktype == "sendtoaddress") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -3737,6 +3826,13 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_verify_sapling_spend());
         } else if (benchmarktype == "verifysaplingoutput") {
             sample_times.push_back(benchmark_verify_sapling_output());
+        } else if (benchmarktype == "mergeminingtargets") {
+            // one merged chain and the most a miner can take are the interesting cases
+            int nChains = params.size() >= 3 ? params[2].get_int() : 10;
+            if (nChains <= 0 || nChains > (int)CPBaaSMergeMinedChainData::MAX_MERGE_CHAINS) {
+                throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Invalid chain count, must be from 1 to %d", CPBaaSMergeMinedChainData::MAX_MERGE_CHAINS));
+            }
+            sample_times.push_back(benchmark_merge_mining_targets(nChains));
         } else {
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid benchmarktype");
         }
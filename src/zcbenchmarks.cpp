@@ -3,26 +3,37 @@
 #include <map>
 #include <thread>
 #include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 #include <boost/filesystem.hpp>
 
+#include "arith_uint256.h"
 #include "coins.h"
 #include "util.h"
 #include "init.h"
 #include "primitives/transaction.h"
 #include "base58.h"
 #include "crypto/equihash.h"
+#include "crypto/verus_hash.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "hash.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
+#include "pbaas/crosschainrpc.h"
+#include "pbaas/pbaas.h"
 #include "pow.h"
+#include "random.h"
 #include "rpc/server.h"
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
+#include "support/events.h"
 #include "txdb.h"
+#include "undo.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
 
@@ -33,6 +44,23 @@
 #include "zcash/Note.hpp"
 #include "librustzcash.h"
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <event2/buffer.h>
+#include <event2/http.h>
+#include <event2/keyvalq_struct.h>
+
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern void blockToJSON(UniValueWriter& writer, const CBlock& block, const CBlockIndex* blockindex, bool txDetails);
+
 using namespace libzcash;
 // This method is based on Shutdown from init.cpp
 void pre_wallet_load()
@@ -223,6 +251,57 @@ std::vector<double> benchmark_solve_equihash_threaded(int nThreads)
     }
     return ret;
 }
+
+bool mine_verus_v2(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
+bool mine_verus_v2_port(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
+
+// hashes 1M nonces with the kernel a VerusHash mining thread uses, pinned to nCPU unless it is negative
+double benchmark_verus_hash(int nCPU)
+{
+    if (nCPU >= 0)
+    {
+        SetThreadAffinity(nCPU);
+    }
+
+    CBlockHeader header = Params().GenesisBlock().GetBlockHeader();
+    header.nVersion = CBlockHeader::VERUS_V2;
+
+    // the writer allocates this thread's hash key, after it has been pinned
+    CVerusHashV2bWriter ss2(SER_GETHASH, PROTOCOL_VERSION, SOLUTION_VERUSHHASH_V2_2);
+    auto mine_verus = IsCPUVerusOptimized() ? &mine_verus_v2 : &mine_verus_v2_port;
+
+    // no hash is at or below a zero target, so every nonce gets hashed
+    uint256 hashResult, target;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (uint64_t i = 0; i < 16; i++)
+    {
+        uint64_t count = 0x10000;
+        (*mine_verus)(header, ss2, hashResult, target, i * count, &count);
+    }
+    return timer_stop(tv_start);
+}
+
+std::vector<double> benchmark_verus_hash_threaded(int nThreads, bool fPinned)
+{
+    std::vector<int> cpus = fPinned ? GetMinerThreadCPUs(nThreads) : std::vector<int>(nThreads, -1);
+    std::vector<double> ret;
+    std::vector<std::future<double>> tasks;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        std::packaged_task<double(void)> task(std::bind(&benchmark_verus_hash, cpus[i]));
+        tasks.emplace_back(task.get_future());
+        threads.emplace_back(std::move(task));
+    }
+    for (auto it = tasks.begin(); it != tasks.end(); it++) {
+        it->wait();
+        ret.push_back(it->get());
+    }
+    for (auto it = threads.begin(); it != threads.end(); it++) {
+        it->join();
+    }
+    return ret;
+}
 #endif // ENABLE_MINING
 
 double benchmark_verify_equihash()
@@ -236,21 +315,499 @@ double benchmark_verify_equihash()
     return timer_stop(tv_start);
 }
 
-double benchmark_large_tx(size_t nInputs)
+// times four lane Haraka512 and Haraka256 with the single lane functions and each four lane kernel this CPU supports,
+// after checking every kernel against the single lane functions, and logs cycles per input byte for each
+std::vector<double> benchmark_haraka_kernels()
+{
+    const int nRounds = 1 << 18;
+    load_constants();
+
+    std::vector<std::pair<std::string, std::pair<haraka_function, haraka_function>>> variants;
+    variants.push_back(std::make_pair(std::string("x1"), std::make_pair(
+        (haraka_function)[](unsigned char *out, const unsigned char *in) { for (int i = 0; i < 4; i++) haraka256(out + 32 * i, in + 32 * i); },
+        (haraka_function)[](unsigned char *out, const unsigned char *in) { for (int i = 0; i < 4; i++) haraka512(out + 32 * i, in + 64 * i); })));
+    for (int kernel = 0; kernel < HARAKA_KERNEL_COUNT; kernel++)
+    {
+        if (!haraka_kernel_supported(kernel))
+        {
+            continue;
+        }
+        if (!haraka_kernel_matches_reference(kernel))
+        {
+            throw std::runtime_error(strprintf("Haraka kernel %s does not match the reference", haraka_kernel_name(kernel)));
+        }
+        haraka_function f256, f512;
+        haraka_get_kernels(kernel, &f256, &f512);
+        variants.push_back(std::make_pair(std::string(haraka_kernel_name(kernel)), std::make_pair(f256, f512)));
+    }
+
+    std::vector<double> ret;
+    alignas(32) unsigned char in[256], out[128];
+    GetRandBytes(in, sizeof(in));
+    for (auto &variant : variants)
+    {
+        double seconds[2];
+        uint64_t cycles[2] = {0, 0};
+        for (int width = 0; width < 2; width++)
+        {
+            haraka_function f = width ? variant.second.second : variant.second.first;
+            struct timeval tv_start;
+            timer_start(tv_start);
+#if defined(__x86_64__) || defined(__i386__)
+            uint64_t startCycles = __rdtsc();
+#endif
+            for (int i = 0; i < nRounds; i++)
+            {
+                f(out, in);
+                in[0] = out[0];
+            }
+#if defined(__x86_64__) || defined(__i386__)
+            cycles[width] = __rdtsc() - startCycles;
+#endif
+            seconds[width] = timer_stop(tv_start);
+        }
+        // four lanes of 32 byte Haraka256 input and 64 byte Haraka512 input per call
+        LogPrintf("%s: %s haraka256 %.2f cycles/byte, haraka512 %.2f cycles/byte, %.3fs\n", __func__, variant.first,
+                  (double)cycles[0] / ((double)nRounds * 128), (double)cycles[1] / ((double)nRounds * 256), seconds[0] + seconds[1]);
+        ret.push_back(seconds[1]);
+    }
+    return ret;
+}
+
+// hashes a headers message worth of distinct headers the way header sync does, in parallel on the header check threads
+double benchmark_verify_headers(size_t nHeaders)
+{
+    CBlockHeader genesis = Params().GenesisBlock().GetBlockHeader();
+    std::vector<CBlockHeader> headers(nHeaders, genesis);
+    for (size_t i = 0; i < nHeaders; i++)
+    {
+        headers[i].nNonce = ArithToUint256(arith_uint256(i));
+    }
+
+    std::vector<uint256> hashes;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    GetBlockHeaderHashes(headers, hashes);
+    double ret = timer_stop(tv_start);
+    LogPrint("bench", "%s: %.0f headers per second\n", __func__, ret > 0 ? nHeaders / ret : 0.0);
+    return ret;
+}
+
+double benchmark_asset_index(size_t nTokens)
+{
+    // one holder with outputs of every token, the worst case for looking up a balance by address
+    static const size_t OUTPUTS_PER_TOKEN = 10;
+    static const size_t ORDERS_PER_TOKEN = 4;
+    static const size_t QUERIES = 1000;
+    CBlockTreeDB db(1 << 23, true);
+    uint160 holder = Hash160(std::vector<unsigned char>(20, 1));
+
+    std::vector<CAssetIndexDbEntry> outputs;
+    std::vector<uint256> tokens;
+    for (size_t i = 0; i < nTokens; i++)
+    {
+        uint256 tokenid = ArithToUint256(arith_uint256(i + 1));
+        tokens.push_back(tokenid);
+        for (size_t j = 0; j < OUTPUTS_PER_TOKEN + ORDERS_PER_TOKEN; j++)
+        {
+            CAssetOutputValue value;
+            value.tokenid = tokenid;
+            value.hashBytes = holder;
+            value.satoshis = 1000 + j;
+            if (j < OUTPUTS_PER_TOKEN)
+            {
+                value.flags = CAssetOutputValue::IS_BALANCE;
+                value.funcid = 't';
+            }
+            else
+            {
+                value.flags = CAssetOutputValue::IS_BALANCE | CAssetOutputValue::IS_ORDER;
+                value.funcid = 's';
+                value.price = COIN * (j + 1);
+                value.orderSatoshis = value.satoshis;
+            }
+            outputs.push_back(std::make_pair(COutPoint(ArithToUint256(arith_uint256(i * 100 + j)), j), value));
+        }
+    }
+    std::vector<CAssetIndexDbEntry> noSpends;
+    bool fWritten = db.WriteBlockIndexes(std::vector<std::pair<uint256, CDiskTxPos> >(),
+                                         std::vector<CAddressIndexDbEntry>(),
+                                         std::vector<CAddressUnspentDbEntry>(),
+                                         std::vector<CSpentIndexDbEntry>(),
+                                         outputs,
+                                         noSpends,
+                                         std::vector<COracleSampleDbEntry>(),
+                                         std::vector<CRetainedTransactionDbEntry>());
+    // queries are timed against the database, not the entries still gathered in memory
+    if (!fWritten || !db.SyncIndexes())
+        throw std::runtime_error("benchmark_asset_index: failed to write the asset index");
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    size_t nFound = 0;
+    for (size_t i = 0; i < QUERIES; i++)
+    {
+        const uint256 &tokenid = tokens[(i * 7919) % nTokens];
+        std::vector<CAssetBalanceDbEntry> balances;
+        std::vector<CAssetIndexDbEntry> orders;
+        bool fRead = db.ReadAssetBalances(tokenid, holder, balances);
+        fRead = db.ReadAssetOrders(tokenid, orders) && fRead;
+        if (!fRead)
+            throw std::runtime_error("benchmark_asset_index: failed to read the asset index");
+        nFound += balances.size() + orders.size();
+    }
+    double ret = timer_stop(tv_start);
+    if (nFound != QUERIES * (OUTPUTS_PER_TOKEN + 2 * ORDERS_PER_TOKEN))
+        throw std::runtime_error("benchmark_asset_index: unexpected number of index entries found");
+    // without the index, every query loads and decodes each CC output of the holder
+    LogPrint("bench", "%s: %.0f balance and order book queries per second over %lu tokens, %lu transactions per query without the index\n",
+             __func__, ret > 0 ? QUERIES / ret : 0.0, nTokens, nTokens * (OUTPUTS_PER_TOKEN + ORDERS_PER_TOKEN));
+    return ret;
+}
+
+#ifndef _WIN32
+// a message as a peer puts it on the wire
+static std::vector<char> BenchPeerMessage(const char *pszCommand, const CDataStream &ssPayload)
+{
+    CMessageHeader hdr(Params().MessageStart(), pszCommand, ssPayload.size());
+    uint256 hash = Hash(ssPayload.begin(), ssPayload.end());
+    memcpy(&hdr.nChecksum, &hash, sizeof(hdr.nChecksum));
+
+    CDataStream ssMsg(SER_NETWORK, PROTOCOL_VERSION);
+    ssMsg << hdr;
+    ssMsg.write(ssPayload.empty() ? NULL : &ssPayload[0], ssPayload.size());
+    return std::vector<char>(ssMsg.begin(), ssMsg.end());
+}
+
+static bool BenchPeerSend(int fd, const std::vector<char> &vMsg)
+{
+    return send(fd, &vMsg[0], vMsg.size(), MSG_NOSIGNAL) == (ssize_t)vMsg.size();
+}
+
+static bool BenchPeerRecvAll(int fd, char *pch, size_t nBytes)
+{
+    while (nBytes)
+    {
+        ssize_t n = recv(fd, pch, nBytes, 0);
+        if (n <= 0)
+            return false;
+        pch += n;
+        nBytes -= n;
+    }
+    return true;
+}
+
+// reads messages from the node until one with the given command arrives, and returns its payload
+static bool BenchPeerRecv(int fd, const std::string &strCommand, std::vector<char> &vPayload)
+{
+    while (true)
+    {
+        char hdrbuf[CMessageHeader::HEADER_SIZE];
+        if (!BenchPeerRecvAll(fd, hdrbuf, sizeof(hdrbuf)))
+            return false;
+        CDataStream ssHdr(hdrbuf, hdrbuf + sizeof(hdrbuf), SER_NETWORK, PROTOCOL_VERSION);
+        CMessageHeader hdr(Params().MessageStart());
+        ssHdr >> hdr;
+        if (hdr.nMessageSize > MAX_PROTOCOL_MESSAGE_LENGTH)
+            return false;
+        vPayload.resize(hdr.nMessageSize);
+        if (hdr.nMessageSize && !BenchPeerRecvAll(fd, &vPayload[0], hdr.nMessageSize))
+            return false;
+        if (hdr.GetCommand() == strCommand)
+            return true;
+    }
+}
+
+// connects to the node's own listening port and completes the version handshake
+static int BenchPeerConnect(const CService &addrNode)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addrNode.GetSockAddr((struct sockaddr*)&sockaddr, &len))
+        return -1;
+    int fd = socket(((struct sockaddr*)&sockaddr)->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    if (fd == -1)
+        return -1;
+    struct timeval timeout;
+    timeout.tv_sec = 10;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int set = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &set, sizeof(set));
+    if (connect(fd, (struct sockaddr*)&sockaddr, len) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // the version message is read before the node knows the peer's version
+    CDataStream ssVersion(SER_NETWORK, INIT_PROTO_VERSION);
+    uint64_t nNonce = GetRand(std::numeric_limits<uint64_t>::max());
+    ssVersion << PROTOCOL_VERSION << (uint64_t)0 << GetTime() << CAddress(addrNode) << CAddress(CService("0.0.0.0", 0)) << nNonce;
+    if (PROTOCOL_VERSION >= MIN_PBAAS_VERSION)
+        ssVersion << CKeyID();
+    ssVersion << std::string("/benchmark/") << 0 << false;
+
+    std::vector<char> vPayload;
+    if (!BenchPeerSend(fd, BenchPeerMessage("version", ssVersion)) ||
+        !BenchPeerRecv(fd, "verack", vPayload) ||
+        !BenchPeerSend(fd, BenchPeerMessage("verack", CDataStream(SER_NETWORK, PROTOCOL_VERSION))))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// opens nConnections inbound connections to this node, which its socket thread serves with the -socketevents loop,
+// then pings one of them at a time and waits for the pong. the node's own message handling answers, so the
+// latency is that of a peer among many idle ones, and the cpu is that of the whole process
+double benchmark_socket_events(size_t nConnections)
+{
+    static const size_t MESSAGES = 2000;
+    static const int OUTBOUND_SLOTS = 5;    // kept free for outbound peers, as AcceptConnection does
+
+    if (!fListen)
+        throw std::runtime_error("the node must listen for connections, see -listen");
+    int nInbound = 0;
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
+            if (pnode->fInbound)
+                nInbound++;
+    }
+    // beyond this the node would evict its other inbound peers to make room
+    int nFree = std::max(nMaxConnections - OUTBOUND_SLOTS - nInbound, 0);
+    if (nConnections > (size_t)nFree)
+        throw std::runtime_error(strprintf("only %d inbound connections are free, raise -maxconnections", nFree));
+    RaiseFileDescriptorLimit(nMaxConnections + nConnections + 150);
+
+    CService addrNode(CNetAddr("127.0.0.1"), GetListenPort());
+    std::vector<int> vPeers;
+    for (size_t i = 0; i < nConnections; i++)
+    {
+        int fd = BenchPeerConnect(addrNode);
+        if (fd == -1)
+            break;
+        vPeers.push_back(fd);
+    }
+    if (vPeers.size() < nConnections)
+    {
+        for (size_t i = 0; i < vPeers.size(); i++)
+            close(vPeers[i]);
+        throw std::runtime_error(strprintf("connected %lu of %lu peers to the node", vPeers.size(), nConnections));
+    }
+
+    size_t nReceived = 0;
+    int64_t nLatency = 0;
+    struct timespec cpu_start, cpu_end;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (size_t m = 0; m < MESSAGES; m++)
+    {
+        int fd = vPeers[(m * 7919) % vPeers.size()];
+        CDataStream ssPing(SER_NETWORK, PROTOCOL_VERSION);
+        uint64_t nPingNonce = m + 1;
+        ssPing << nPingNonce;
+        int64_t nSent = GetTimeMicros();
+        if (!BenchPeerSend(fd, BenchPeerMessage("ping", ssPing)))
+            break;
+        std::vector<char> vPayload;
+        uint64_t nPongNonce = 0;
+        while (nPongNonce != nPingNonce && BenchPeerRecv(fd, "pong", vPayload))
+        {
+            CDataStream ssPong(vPayload.data(), vPayload.data() + vPayload.size(), SER_NETWORK, PROTOCOL_VERSION);
+            if (vPayload.size() >= sizeof(nPongNonce))
+                ssPong >> nPongNonce;
+        }
+        if (nPongNonce != nPingNonce)
+            break;
+        nLatency += GetTimeMicros() - nSent;
+        nReceived++;
+        MilliSleep(1);
+    }
+    double ret = timer_stop(tv_start);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+
+    for (size_t i = 0; i < vPeers.size(); i++)
+        close(vPeers[i]);
+    if (nReceived < MESSAGES)
+        throw std::runtime_error("the node stopped answering pings");
+
+    double cpums = (cpu_end.tv_sec - cpu_start.tv_sec) * 1000.0 + (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1000000.0;
+    LogPrint("bench", "%s: %s with %lu connections, %.1f us average ping latency, %.1f ms process cpu\n",
+             __func__, fSocketEventsEpoll ? "epoll" : "select", nConnections, (double)nLatency / nReceived, cpums);
+    return ret;
+}
+#endif
+
+// answers every call and every call of a batch with an empty result, closing the connection after each reply unless
+// the stand-in daemon keeps connections alive
+static void bench_rpc_request_cb(struct evhttp_request *req, void *arg)
+{
+    bool fKeepAlive = *(bool *)arg;
+    struct evbuffer *input = evhttp_request_get_input_buffer(req);
+    std::string strBody(evbuffer_get_length(input), '\0');
+    if (strBody.size())
+        evbuffer_copyout(input, &strBody[0], strBody.size());
+
+    UniValue request, reply;
+    if (request.read(strBody) && request.isArray())
+    {
+        reply = UniValue(UniValue::VARR);
+        for (size_t i = 0; i < request.size(); i++)
+            reply.push_back(JSONRPCReplyObj(UniValue(UniValue::VOBJ), NullUniValue, find_value(request[i], "id")));
+    }
+    else
+    {
+        reply = JSONRPCReplyObj(UniValue(UniValue::VOBJ), NullUniValue, request.isObject() ? find_value(request, "id") : NullUniValue);
+    }
+    std::string strReply = reply.write() + "\n";
+
+    struct evkeyvalq *headers = evhttp_request_get_output_headers(req);
+    evhttp_add_header(headers, "Content-Type", "application/json");
+    if (!fKeepAlive)
+        evhttp_add_header(headers, "Connection", "close");
+    struct evbuffer *output = evbuffer_new();
+    evbuffer_add(output, strReply.data(), strReply.size());
+    evhttp_send_reply(req, HTTP_OK, "OK", output);
+    evbuffer_free(output);
+}
+
+// times calls to another daemon through RPCCall and RPCCallBatch against a stand-in daemon on this host, first with
+// the stand-in closing each connection, which costs what a connection per call did, then with keep-alive
+// connections from the pool. calls are recorded in getcrosschainrpcstats under the method zcbenchmark
+double benchmark_crosschain_rpc(size_t nCalls)
+{
+    bool fKeepAlive = false;
+    raii_event_base base = obtain_event_base();
+    raii_evhttp http = obtain_evhttp(base.get());
+    evhttp_set_gencb(http.get(), bench_rpc_request_cb, &fKeepAlive);
+    struct evhttp_bound_socket *bound = evhttp_bind_socket_with_handle(http.get(), "127.0.0.1", 0);
+    struct sockaddr_in sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!bound || getsockname(evhttp_bound_socket_get_fd(bound), (struct sockaddr *)&sockaddr, &len) != 0)
+        throw std::runtime_error("benchmark_crosschain_rpc: couldn't start the stand-in daemon");
+    int port = ntohs(sockaddr.sin_port);
+    std::thread server([&base]() { event_base_dispatch(base.get()); });
+
+    UniValue params(UniValue::VARR);
+    std::vector<std::pair<std::string, UniValue>> calls;
+    calls.push_back(std::make_pair(std::string("zcbenchmark"), params));
+    calls.push_back(std::make_pair(std::string("zcbenchmark"), params));
+    double closeTime = 0, keepAliveTime = 0, batchTime = 0;
+    std::string strError;
+    try
+    {
+        struct timeval tv_start;
+        timer_start(tv_start);
+        for (size_t i = 0; i < nCalls; i++)
+            RPCCall("zcbenchmark", params, "user:pass", port, "127.0.0.1");
+        closeTime = timer_stop(tv_start);
+
+        fKeepAlive = true;
+        timer_start(tv_start);
+        for (size_t i = 0; i < nCalls; i++)
+            RPCCall("zcbenchmark", params, "user:pass", port, "127.0.0.1");
+        keepAliveTime = timer_stop(tv_start);
+
+        // the same number of calls, two to a batch
+        timer_start(tv_start);
+        for (size_t i = 0; i < nCalls; i += 2)
+            RPCCallBatch(calls, "user:pass", port, "127.0.0.1");
+        batchTime = timer_stop(tv_start);
+    }
+    catch (const std::exception &e)
+    {
+        strError = e.what();
+    }
+
+    event_base_loopexit(base.get(), NULL);
+    server.join();
+    if (!strError.empty())
+        throw std::runtime_error("benchmark_crosschain_rpc: " + strError);
+
+    LogPrint("bench", "%s: %lu calls, %.1f us per call with a connection each, %.1f us with keep-alive, %.1f us in batches of two\n",
+             __func__, nCalls, closeTime * 1000000 / nCalls, keepAliveTime * 1000000 / nCalls, batchTime * 1000000 / nCalls);
+    return keepAliveTime;
+}
+
+// bytes in use on the heap, including large mmapped blocks, 0 where the C library can't tell
+static size_t heap_in_use()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo mi = mallinfo();
+    return (size_t)mi.uordblks + (size_t)mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+// getblock verbosity 2 of a block with nTxs simple transactions, built as a tree or written directly
+double benchmark_getblock_json(size_t nTxs, bool fStream)
 {
-    // Create priv/pub key
-    CKey priv;
-    priv.MakeNewKey(false);
-    auto pub = priv.GetPubKey();
+    CBlock block;
+    block.nBits = 0x200f0f0f;
+    for (size_t i = 0; i < nTxs; i++)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+        for (int j = 0; j < 2; j++)
+            mtx.vout.push_back(CTxOut(1000 + j, GetScriptForDestination(CKeyID(Hash160(std::vector<unsigned char>(1, j))))));
+        block.vtx.push_back(mtx);
+    }
+    CBlockIndex index(block);
+
+    LOCK(cs_main);
+    size_t nHeapStart = heap_in_use();
+    struct timeval tv_start;
+    timer_start(tv_start);
+
+    std::string strJSON;
+    size_t nHeapPeak;
+    if (fStream)
+    {
+        UniValueWriter writer(strJSON);
+        blockToJSON(writer, block, &index, true);
+        nHeapPeak = heap_in_use();
+    }
+    else
+    {
+        UniValue objBlock = blockToJSON(block, &index, true);
+        strJSON = objBlock.write();
+        nHeapPeak = heap_in_use();
+    }
+
+    double ret = timer_stop(tv_start);
+    LogPrint("bench", "%s: %s, %lu transactions, %lu bytes of JSON, %lu bytes of heap at the end of serialization\n",
+             __func__, fStream ? "streamed" : "tree", nTxs, strJSON.size(), nHeapPeak > nHeapStart ? nHeapPeak - nHeapStart : 0);
+    return ret;
+}
+
+double benchmark_large_tx(size_t nInputs, size_t nSigners)
+{
+    // Create priv/pub keys, one for each signer of every input
     CBasicKeyStore tempKeystore;
-    tempKeystore.AddKey(priv);
+    std::vector<CPubKey> pubkeys;
+    for (size_t i = 0; i < nSigners; i++) {
+        CKey priv;
+        priv.MakeNewKey(false);
+        pubkeys.push_back(priv.GetPubKey());
+        tempKeystore.AddKey(priv);
+    }
 
     // The "original" transaction that the spending transaction will spend
-    // from.
+    // from, paying to one key or to all of the signers
     CMutableTransaction m_orig_tx;
     m_orig_tx.vout.resize(1);
     m_orig_tx.vout[0].nValue = 1000000;
-    CScript prevPubKey = GetScriptForDestination(pub.GetID());
+    CScript prevPubKey = nSigners == 1 ? GetScriptForDestination(pubkeys[0].GetID()) : GetScriptForMultisig(nSigners, pubkeys);
     m_orig_tx.vout[0].scriptPubKey = prevPubKey;
 
     auto orig_tx = CTransaction(m_orig_tx);
@@ -288,7 +845,10 @@ double benchmark_large_tx(size_t nInputs)
                             consensusBranchId,
                             &serror));
     }
-    return timer_stop(tv_start);
+    double elapsed = timer_stop(tv_start);
+    LogPrint("bench", "%s: %lu inputs with %lu signers each, %.2f us per input\n",
+             __func__, nInputs, nSigners, elapsed * 1000000 / nInputs);
+    return elapsed;
 }
 
 // The two benchmarks, try_decrypt_sprout_notes and try_decrypt_sapling_notes,
@@ -576,6 +1136,159 @@ double benchmark_connectblock_slow()
     return duration;
 }
 
+double benchmark_disconnect_block(size_t nTxs, bool fColumnar)
+{
+    // a block of transactions that each spend two outputs of an earlier transaction, paid to a few
+    // hundred recurring addresses
+    std::vector<CScript> vScripts;
+    for (int i = 0; i < 256; i++) {
+        uint160 keyID;
+        GetRandBytes(keyID.begin(), keyID.size());
+        vScripts.push_back(GetScriptForDestination(CKeyID(keyID)));
+    }
+
+    std::vector<CTransaction> vtx;
+    CBlockUndo blockundo(fColumnar ? CBlockUndo::FORMAT_COLUMNAR : CBlockUndo::FORMAT_LEGACY);
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        CTxUndo txundo;
+        uint256 prevHash = GetRandHash();
+        for (int j = 0; j < 2; j++) {
+            mtx.vin.push_back(CTxIn(COutPoint(prevHash, j)));
+            // the last spend of a transaction carries its metadata
+            unsigned int nHeight = j ? 1000000 + GetRand(1000) : 0;
+            txundo.vprevout.push_back(CTxInUndo(CTxOut(GetRand(100000000), vScripts[GetRand(vScripts.size())]), false, nHeight, j));
+        }
+        mtx.vout.push_back(CTxOut(1000, vScripts[GetRand(vScripts.size())]));
+        vtx.push_back(CTransaction(mtx));
+        blockundo.vtxundo.push_back(txundo);
+    }
+    CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
+    ssUndo << blockundo;
+    CDataStream ssRead(ssUndo);
+
+    CCoinsView viewBase;
+    CCoinsViewCache view(&viewBase);
+
+    // read the undo data and restore the inputs of every transaction, as DisconnectBlock does
+    struct timeval tv_start;
+    timer_start(tv_start);
+    CBlockUndo blockundoRead;
+    ssRead >> blockundoRead;
+    for (size_t i = nTxs; i-- > 0;) {
+        assert(ApplyTxUndo(blockundoRead.vtxundo[i], vtx[i], view));
+    }
+    double ret = timer_stop(tv_start);
+    LogPrint("bench", "%s: %s, %lu transactions, %lu bytes of undo data\n",
+             __func__, fColumnar ? "columnar" : "legacy", nTxs, ssUndo.size());
+    return ret;
+}
+
+double benchmark_coins_cache(size_t nEntries)
+{
+    // replay only the coins cache updates of initial block download, with no validation, undo data or database
+    // writes: every transaction spends outputs of two earlier transactions and creates two outputs, so the cache
+    // holds about nEntries transactions
+    std::vector<CScript> vScripts;
+    for (int i = 0; i < 256; i++) {
+        uint160 keyID;
+        GetRandBytes(keyID.begin(), keyID.size());
+        vScripts.push_back(GetScriptForDestination(CKeyID(keyID)));
+    }
+
+    CCoinsView viewBase;
+    CCoinsViewCache view(&viewBase);
+    std::vector<uint256> vLive;
+    vLive.reserve(nEntries);
+
+    const size_t nTxsPerBlock = 2000;
+    size_t nTxs = 0;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int nHeight = 1; nTxs < nEntries * 2; nHeight++) {
+        for (size_t i = 0; i < nTxsPerBlock; i++, nTxs++) {
+            if (vLive.size() >= nEntries) {
+                for (int j = 0; j < 2; j++) {
+                    size_t n = GetRand(vLive.size());
+                    CCoinsModifier coins = view.ModifyCoins(vLive[n]);
+                    for (uint32_t k = 0; k < coins->vout.size(); k++) {
+                        if (!coins->vout[k].IsNull()) {
+                            coins->Spend(k);
+                            break;
+                        }
+                    }
+                    if (coins->IsPruned()) {
+                        vLive[n] = vLive.back();
+                        vLive.pop_back();
+                    }
+                }
+            }
+            uint256 txid = GetRandHash();
+            CCoinsModifier coins = view.ModifyNewCoins(txid);
+            coins->nHeight = nHeight;
+            coins->nVersion = 1;
+            for (int k = 0; k < 2; k++) {
+                coins->vout.push_back(CTxOut(GetRand(100000000), vScripts[GetRand(vScripts.size())]));
+            }
+            vLive.push_back(txid);
+        }
+    }
+    double ret = timer_stop(tv_start);
+
+    size_t nUsage = view.DynamicMemoryUsage();
+    LogPrint("bench", "%s: %u cache entries in %.2fMiB, %.0f entries per GB, %.0f transaction updates per second in the cache alone\n",
+             __func__, view.GetCacheSize(), nUsage * (1.0 / (1 << 20)),
+             view.GetCacheSize() * ((double)(1 << 30) / nUsage), nTxs / ret);
+    return ret;
+}
+
+double benchmark_block_index_memory(size_t nBlocks)
+{
+    // build a block index of nBlocks headers carrying full solutions, then trim the solutions out of memory as is
+    // done once entries have been written to the block tree database, measuring the heap in use at each step
+    CBlockHeader header;
+    header.nVersion = CBlockHeader::CURRENT_VERSION;
+    header.nSolution.resize(CConstVerusSolutionVector::SOLUTION_SIZE);
+    GetRandBytes(header.nSolution.data(), header.nSolution.size());
+
+    size_t nHeapBase = heap_in_use();
+    BlockMap mapIndex;
+    mapIndex.reserve(nBlocks);
+    CBlockIndex *pprev = NULL;
+    for (size_t i = 0; i < nBlocks; i++) {
+        CBlockIndex *pindex = new CBlockIndex(header);
+        BlockMap::iterator mi = mapIndex.insert(std::make_pair(ArithToUint256(arith_uint256(i + 1)), pindex)).first;
+        pindex->phashBlock = &((*mi).first);
+        pindex->pprev = pprev;
+        pindex->SetHeight(i);
+        pprev = pindex;
+    }
+    size_t nHeapFull = heap_in_use();
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (BlockMap::iterator it = mapIndex.begin(); it != mapIndex.end(); ++it) {
+        it->second->TrimSolution();
+    }
+    double ret = timer_stop(tv_start);
+    size_t nHeapTrimmed = heap_in_use();
+
+    for (BlockMap::iterator it = mapIndex.begin(); it != mapIndex.end(); ++it) {
+        delete it->second;
+    }
+
+    if (!nHeapBase || nHeapFull <= nHeapBase || nHeapTrimmed < nHeapBase) {
+        LogPrint("bench", "%s: %lu entries, heap use is not available from the C library\n", __func__, nBlocks);
+        return ret;
+    }
+    size_t nBefore = nHeapFull - nHeapBase;
+    size_t nAfter = nHeapTrimmed - nHeapBase;
+    LogPrint("bench", "%s: %lu entries, %lu heap bytes per entry with solutions, %lu trimmed (%.1f%% less), %.2fMiB -> %.2fMiB\n",
+             __func__, nBlocks, nBefore / nBlocks, nAfter / nBlocks, 100.0 * (nBefore - nAfter) / nBefore,
+             nBefore * (1.0 / (1 << 20)), nAfter * (1.0 / (1 << 20)));
+    return ret;
+}
+
 extern UniValue getnewaddress(const UniValue& params, bool fHelp); // in rpcwallet.cpp
 extern UniValue sendtoaddress(const UniValue& params, bool fHelp);
 
@@ -772,3 +1485,81 @@ double benchmark_verify_sapling_output()
     }
     return timer_stop(tv_start);
 }
+
+// runs the merge mining rounds of one miner against nChains merged chains through CConnectedChains: the template
+// header is combined with the chains' headers whenever they change, each hash is compared with the easiest target,
+// qualifying headers are queued, and the submission thread's side collects them. hashes are random rather than
+// computed, so the figure is the merge mining overhead a miner pays on top of hashing
+double benchmark_merge_mining_targets(size_t nChains)
+{
+    static const int HASHES = 100000;
+    static const int HASHES_PER_UPDATE = 1000;      // how often one of the merged chains has a new block
+    static const int HASHES_PER_COLLECTION = 100;   // how often the submission thread takes queued headers
+
+    CConnectedChains chains;
+    std::vector<CPBaaSMergeMinedChainData> vChainData;
+    for (size_t i = 0; i < nChains; i++)
+    {
+        CCurrencyDefinition chainDef;
+        chainDef.name = strprintf("benchchain%u", (unsigned int)i);
+        CBlock block;
+        block.nSolution.resize(Eh200_9.SolutionWidth);
+        CVerusSolutionVector(block.nSolution).SetVersion(CActivationHeight::ACTIVATE_PBAAS);
+        block.nVersion = CBlockHeader::VERUS_V2;
+        block.nBits = arith_uint256(~arith_uint256(0) >> (8 + i % 8)).GetCompact();
+        block.AddPBaaSHeader(chainDef.GetID());
+        vChainData.push_back(CPBaaSMergeMinedChainData(chainDef, "127.0.0.1", 0, "", block));
+        chains.AddMergedBlock(vChainData.back());
+    }
+
+    CBlockHeader header;
+    header.nSolution.resize(Eh200_9.SolutionWidth);
+    CVerusSolutionVector(header.nSolution).SetVersion(CActivationHeight::ACTIVATE_PBAAS);
+    header.nVersion = CBlockHeader::VERUS_V2;
+    header.AddUpdatePBaaSHeader();
+
+    std::vector<arith_uint256> hashes;
+    for (int i = 0; i < HASHES; i++)
+    {
+        hashes.push_back(UintToArith256(GetRandHash()));
+    }
+
+    size_t nCombined = 0, nQueued = 0, nCollected = 0;
+    arith_uint256 target;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int i = 0; i < HASHES; i++)
+    {
+        if (i % HASHES_PER_UPDATE == HASHES_PER_UPDATE - 1)
+        {
+            CPBaaSMergeMinedChainData &chainData = vChainData[(i / HASHES_PER_UPDATE) % nChains];
+            chainData.block.nTime++;
+            chains.AddMergedBlock(chainData);
+        }
+
+        // pick up new or removed headers, as the miner does on every round
+        if (chains.dirty || header.NumPBaaSHeaders() < chains.numMergeMinedChains + 1)
+        {
+            target.SetCompact(chains.CombineBlocks(header));
+            nCombined++;
+        }
+
+        if (hashes[i] <= target)
+        {
+            header.nNonce = ArithToUint256(hashes[i]);
+            chains.QueueNewBlockHeader(header);
+            nQueued++;
+        }
+
+        if (i % HASHES_PER_COLLECTION == HASHES_PER_COLLECTION - 1 || i == HASHES - 1)
+        {
+            LOCK(chains.cs_mergemining);
+            chains.MoveQueuedHeaders();
+            nCollected += chains.qualifiedHeaders.size();
+            chains.qualifiedHeaders.clear();
+        }
+    }
+    double ret = timer_stop(tv_start);
+    LogPrint("bench", "%s: %lu chains, %lu combines, %lu headers queued, %lu collected\n", __func__, nChains, nCombined, nQueued, nCollected);
+    return ret;
+}
@@ -10,14 +10,27 @@ extern double benchmark_create_joinsplit();
 extern std::vector<double> benchmark_create_joinsplit_threaded(int nThreads);
 extern double benchmark_solve_equihash();
 extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
+extern double benchmark_verus_hash(int nCPU);
+extern std::vector<double> benchmark_verus_hash_threaded(int nThreads, bool fPinned);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
-extern double benchmark_large_tx(size_t nInputs);
+extern double benchmark_verify_headers(size_t nHeaders);
+extern double benchmark_asset_index(size_t nTokens);
+#ifndef _WIN32
+extern double benchmark_socket_events(size_t nConnections);
+#endif
+extern std::vector<double> benchmark_haraka_kernels();
+extern double benchmark_crosschain_rpc(size_t nCalls);
+extern double benchmark_getblock_json(size_t nTxs, bool fStream);
+extern double benchmark_large_tx(size_t nInputs, size_t nSigners = 1);
 extern double benchmark_try_decrypt_sprout_notes(size_t nAddrs);
 extern double benchmark_try_decrypt_sapling_notes(size_t nAddrs);
 extern double benchmark_increment_sprout_note_witnesses(size_t nTxs);
 extern double benchmark_increment_sapling_note_witnesses(size_t nTxs);
 extern double benchmark_connectblock_slow();
+extern double benchmark_disconnect_block(size_t nTxs, bool fColumnar);
+extern double benchmark_coins_cache(size_t nEntries);
+extern double benchmark_block_index_memory(size_t nBlocks);
 extern double benchmark_sendtoaddress(CAmount amount);
 extern double benchmark_loadwallet();
 extern double benchmark_listunspent();
@@ -25,5 +38,6 @@ extern double benchmark_create_sapling_spend();
 extern double benchmark_create_sapling_output();
 extern double benchmark_verify_sapling_spend();
 extern double benchmark_verify_sapling_output();
+extern double benchmark_merge_mining_targets(size_t nChains);
 
 #endif
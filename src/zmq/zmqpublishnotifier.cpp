@@ -4,16 +4,25 @@
 
 #include "chainparams.h"
 #include "zmqpublishnotifier.h"
+#include "key_io.h"
 #include "main.h"
+#include "miner.h"
+#include "pbaas/pbaas.h"
+#include "txmempool.h"
 #include "util.h"
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
+// sockets may be shared by notifiers, and the block template and currency state notifiers send from threads of their own
+static CCriticalSection cs_zmqSend;
+
 static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_CHECKEDBLOCK = "checkedblock";
+static const char *MSG_BLOCKTEMPLATE = "blocktemplate";
+static const char *MSG_CURRENCYSTATE = "currencystate";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -133,6 +142,7 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
 
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
+    LOCK(cs_zmqSend);
     WriteLE32(&msgseq[0], nSequence);
     int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
     if (rc == -1)
@@ -206,3 +216,204 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishBlockTemplateNotifier::Initialize(void *pcontext)
+{
+    if (!IsValidDestination(DecodeDestination(GetArg("-mineraddress", ""))))
+    {
+        LogPrintf("zmq: %s requires a valid -mineraddress to pay block templates to\n", type);
+        return false;
+    }
+    if (!CZMQAbstractPublishNotifier::Initialize(pcontext))
+    {
+        return false;
+    }
+    pthread = new boost::thread(boost::bind(&CZMQPublishBlockTemplateNotifier::ThreadPublishTemplates, this));
+    return true;
+}
+
+void CZMQPublishBlockTemplateNotifier::Shutdown()
+{
+    if (pthread)
+    {
+        pthread->interrupt();
+        pthread->join();
+        delete pthread;
+        pthread = NULL;
+    }
+    CZMQAbstractPublishNotifier::Shutdown();
+}
+
+bool CZMQPublishBlockTemplateNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mtx);
+        fTipChanged = true;
+    }
+    cond.notify_one();
+    return true;
+}
+
+void CZMQPublishBlockTemplateNotifier::ThreadPublishTemplates()
+{
+    RenameThread("zmq-blocktemplate");
+    int64_t nInterval = std::max(GetArg("-zmqpubinterval", DEFAULT_ZMQ_PUB_INTERVAL), (int64_t)1);
+
+    try
+    {
+        while (true)
+        {
+            {
+                boost::unique_lock<boost::mutex> lock(mtx);
+                if (!fTipChanged)
+                {
+                    cond.timed_wait(lock, boost::posix_time::milliseconds(nInterval));
+                }
+                fTipChanged = false;
+            }
+            boost::this_thread::interruption_point();
+
+            if (!IsInitialBlockDownload(Params()) && !PublishTemplate())
+            {
+                LogPrint("zmq", "zmq: Unable to publish block template\n");
+            }
+
+            // rate limit, tip changes that arrive meanwhile are published when we wake
+            MilliSleep(nInterval);
+        }
+    }
+    catch (const boost::thread_interrupted&)
+    {
+    }
+}
+
+bool CZMQPublishBlockTemplateNotifier::PublishTemplate()
+{
+    CBlockIndex *pindexTip = chainActive.LastTip();
+    if (!pindexTip)
+    {
+        return true;
+    }
+
+    unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    bool fNewTip = pindexTip->GetBlockHash() != hashLastPrevBlock;
+    if (!fNewTip && nTransactionsUpdated == nLastTransactionsUpdated)
+    {
+        return true;
+    }
+
+    CScript scriptPubKey = GetScriptForDestination(DecodeDestination(GetArg("-mineraddress", "")));
+    std::unique_ptr<CBlockTemplate> pblocktemplate(CreateSharedBlockTemplate(Params(), scriptPubKey));
+    if (!pblocktemplate)
+    {
+        return false;
+    }
+    nLastTransactionsUpdated = nTransactionsUpdated;
+
+    const CBlock &block = pblocktemplate->block;
+    CAmount nFees = pblocktemplate->vTxFees.size() ? -pblocktemplate->vTxFees[0] : 0;
+    if (!fNewTip && block.hashPrevBlock == hashLastPrevBlock)
+    {
+        // only a material change in what the template pays is worth a new message on the same tip
+        CAmount nChange = nFees > nLastFees ? nFees - nLastFees : nLastFees - nFees;
+        if (nChange == 0 || nChange * 100 < nLastFees * GetArg("-zmqtemplatefeechange", DEFAULT_ZMQ_TEMPLATE_FEE_CHANGE))
+        {
+            return true;
+        }
+    }
+
+    LogPrint("zmq", "zmq: Publish blocktemplate on %s\n", block.hashPrevBlock.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    if (!SendMessage(MSG_BLOCKTEMPLATE, &(*ss.begin()), ss.size()))
+    {
+        return false;
+    }
+    hashLastPrevBlock = block.hashPrevBlock;
+    nLastFees = nFees;
+    return true;
+}
+
+bool CZMQPublishCurrencyStateNotifier::Initialize(void *pcontext)
+{
+    if (!CZMQAbstractPublishNotifier::Initialize(pcontext))
+    {
+        return false;
+    }
+    pthread = new boost::thread(boost::bind(&CZMQPublishCurrencyStateNotifier::ThreadPublishCurrencyStates, this));
+    return true;
+}
+
+void CZMQPublishCurrencyStateNotifier::Shutdown()
+{
+    if (pthread)
+    {
+        pthread->interrupt();
+        pthread->join();
+        delete pthread;
+        pthread = NULL;
+    }
+    CZMQAbstractPublishNotifier::Shutdown();
+}
+
+bool CZMQPublishCurrencyStateNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    CCoinbaseCurrencyState currencyState = ConnectedChains.GetCurrencyState(pindex->GetHeight());
+    if (!currencyState.IsValid() || !currencyState.IsFractional())
+    {
+        return true;
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    unsigned char height[sizeof(uint32_t)];
+    WriteLE32(&height[0], pindex->GetHeight());
+    ss.write((const char *)height, sizeof(height));
+    ss << currencyState;
+
+    // a state still waiting for the interval to end is replaced by the newer one
+    {
+        boost::unique_lock<boost::mutex> lock(mtx);
+        nPendingHeight = pindex->GetHeight();
+        vPendingMessage.assign(ss.begin(), ss.end());
+        fPending = true;
+    }
+    cond.notify_one();
+    return true;
+}
+
+void CZMQPublishCurrencyStateNotifier::ThreadPublishCurrencyStates()
+{
+    RenameThread("zmq-currencystate");
+    int64_t nInterval = std::max(GetArg("-zmqpubinterval", DEFAULT_ZMQ_PUB_INTERVAL), (int64_t)1);
+
+    try
+    {
+        while (true)
+        {
+            int nHeight;
+            std::vector<char> vMessage;
+            {
+                boost::unique_lock<boost::mutex> lock(mtx);
+                while (!fPending)
+                {
+                    cond.wait(lock);
+                }
+                nHeight = nPendingHeight;
+                vMessage.swap(vPendingMessage);
+                fPending = false;
+            }
+
+            LogPrint("zmq", "zmq: Publish currencystate at height %d\n", nHeight);
+            if (!SendMessage(MSG_CURRENCYSTATE, &vMessage[0], vMessage.size()))
+            {
+                LogPrint("zmq", "zmq: Unable to publish currency state\n");
+            }
+
+            // rate limit, the newest state that arrives meanwhile is published when we wake
+            MilliSleep(nInterval);
+        }
+    }
+    catch (const boost::thread_interrupted&)
+    {
+    }
+}
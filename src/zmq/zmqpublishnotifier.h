@@ -6,9 +6,18 @@
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
 #include "zmqabstractnotifier.h"
+#include "amount.h"
+#include "uint256.h"
+
+#include <boost/thread.hpp>
 
 class CBlockIndex;
 
+/** Default for -zmqpubinterval, minimum milliseconds between two block template or currency state messages */
+static const int64_t DEFAULT_ZMQ_PUB_INTERVAL = 1000;
+/** Default for -zmqtemplatefeechange, percent change in template fees that publishes a new template on the same tip */
+static const int64_t DEFAULT_ZMQ_TEMPLATE_FEE_CHANGE = 1;
+
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
@@ -24,6 +33,8 @@ public:
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
+    CZMQAbstractPublishNotifier() : nSequence(0) {}
+
     bool Initialize(void *pcontext);
     void Shutdown();
 };
@@ -58,4 +69,58 @@ public:
     bool NotifyBlock(const CBlock &block);
 };
 
+/**
+ * Publishes a serialized block template when the tip changes, or when the mempool has changed the template's fees
+ * by at least -zmqtemplatefeechange percent. Templates are built on a thread of their own so validation never
+ * waits for them, and no more often than -zmqpubinterval.
+ */
+class CZMQPublishBlockTemplateNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    boost::thread *pthread;
+    boost::mutex mtx;
+    boost::condition_variable cond;
+    bool fTipChanged;
+
+    uint256 hashLastPrevBlock;
+    CAmount nLastFees;
+    unsigned int nLastTransactionsUpdated;
+
+    void ThreadPublishTemplates();
+    bool PublishTemplate();
+
+public:
+    CZMQPublishBlockTemplateNotifier() : pthread(NULL), fTipChanged(true), nLastFees(0), nLastTransactionsUpdated(0) {}
+
+    bool Initialize(void *pcontext);
+    void Shutdown();
+    bool NotifyBlock(const CBlockIndex *pindex);
+};
+
+/**
+ * Publishes the coinbase currency state of each new tip if this chain's currency is fractional, no more often
+ * than -zmqpubinterval. A state that arrives within the interval replaces any other one waiting, and the newest is
+ * published from a thread of its own when the interval is over. The message is the 4 byte LE height followed by
+ * the serialized currency state.
+ */
+class CZMQPublishCurrencyStateNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    boost::thread *pthread;
+    boost::mutex mtx;
+    boost::condition_variable cond;
+    bool fPending;
+    int nPendingHeight;
+    std::vector<char> vPendingMessage;
+
+    void ThreadPublishCurrencyStates();
+
+public:
+    CZMQPublishCurrencyStateNotifier() : pthread(NULL), fPending(false), nPendingHeight(0) {}
+
+    bool Initialize(void *pcontext);
+    void Shutdown();
+    bool NotifyBlock(const CBlockIndex *pindex);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H